@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "base_matrices.h"
+#include "base_vectors.h"
+
+namespace Sisyphus
+{
+namespace Base
+{
+    struct BoundingBox {
+        vec3_t min;
+        vec3_t max;
+    };
+    struct BoundingSphere {
+        vec3_t center;
+        float  radius;
+    };
+    // both volumes of the same points - sphere is cheaper to test, box is tighter
+    struct Bounds {
+        BoundingBox    box;
+        BoundingSphere sphere;
+    };
+    Bounds
+    calculate_bounds(const vec3_t* points, size_t count);
+    Bounds
+    calculate_bounds(const std::vector<vec3_t>& points);
+    Bounds
+    calculate_bounds(const std::vector<vec4_t>& points); // w is ignored
+    // m is an affine transform, sphere radius grows with the largest axis scale
+    BoundingSphere
+    transform_sphere(const BoundingSphere& sphere, const mat4_t& m);
+    BoundingBox
+    transform_box(const BoundingBox& box, const mat4_t& m);
+} // namespace Base
+} // namespace Sisyphus
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Sisyphus
+{
+namespace Base
+{
+    const size_t cache_line_size = 64;
+    const size_t page_granularity = 64 * 1024;
+    const size_t huge_page_size = 2 * 1024 * 1024;
+
+    size_t
+    align_up(size_t value, size_t alignment); // alignment should be power of two
+
+    struct AlignedBlock {
+        uint8_t* data = nullptr;
+        size_t   capacity = 0;
+        bool     huge_pages = false;           // true only if huge pages were really granted
+        bool     huge_pages_requested = false; // what the pool matches on, granted or not
+    };
+    // memory is always aligned at least to cache_line_size; if huge pages are
+    // requested but not available the block silently falls back to regular pages
+    AlignedBlock
+    allocate_aligned_block(size_t size, bool huge_pages);
+    void
+    free_aligned_block(AlignedBlock& block);
+
+    // keeps a few released blocks to hand them out again instead of going to the os
+    // every time - mostly for render targets that are recreated with similar sizes
+    class AlignedBlockPool {
+        std::vector<AlignedBlock> m_free_blocks;
+        std::mutex                m_mutex;
+        size_t                    m_max_free_blocks;
+
+      public:
+        AlignedBlockPool(size_t max_free_blocks);
+        static AlignedBlockPool*
+        instance(); // thread safe, created on first use and never destroyed
+        AlignedBlock
+        acquire(size_t size, bool huge_pages); // capacity of result is at least size
+        void
+        release(AlignedBlock& block);
+        void
+        trim(); // give every cached block back to the os
+        size_t
+        get_free_block_count();
+        ~AlignedBlockPool();
+    };
+} // namespace Base
+} // namespace Sisyphus
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "base_memory.h"
+
+namespace Sisyphus
+{
+namespace Base
+{
+    // bounded lock-free queue after Dmitry Vyukov: every slot has a sequence
+    // number telling whose turn it is, producers race for the enqueue position
+    // with CAS, the single consumer owns the dequeue position. Push and pop
+    // never block, push fails when the queue is full.
+    template <typename T>
+    class BoundedMpscQueue {
+        struct Slot {
+            std::atomic<size_t> sequence;
+            T                   value;
+        };
+        std::vector<Slot> m_slots;
+        size_t            m_mask;
+        // positions on different cache lines, producers do not disturb consumer
+        alignas(cache_line_size) std::atomic<size_t> m_enqueue_pos;
+        alignas(cache_line_size) std::atomic<size_t> m_dequeue_pos;
+
+      public:
+        BoundedMpscQueue(size_t capacity) // power of two
+            : m_slots(capacity)
+            , m_mask(capacity - 1)
+        {
+            assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+            for (size_t i = 0; i < capacity; i++)
+            {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            m_enqueue_pos.store(0, std::memory_order_relaxed);
+            m_dequeue_pos.store(0, std::memory_order_relaxed);
+        }
+        BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+        BoundedMpscQueue&
+        operator=(const BoundedMpscQueue&) = delete;
+        size_t
+        get_capacity() const
+        {
+            return m_mask + 1;
+        }
+        // any thread
+        bool
+        try_push(const T& value)
+        {
+            size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            Slot*  slot;
+            while (true)
+            {
+                slot = &m_slots[pos & m_mask];
+                size_t   sequence = slot->sequence.load(std::memory_order_acquire);
+                intptr_t dif = (intptr_t)sequence - (intptr_t)pos;
+                if (dif == 0)
+                {
+                    if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false; // full
+                }
+                else
+                {
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            slot->value = value;
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+        // consumer thread only
+        bool
+        try_pop(T& value)
+        {
+            size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            Slot*  slot = &m_slots[pos & m_mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence != pos + 1)
+            {
+                return false; // empty or producer has not finished writing yet
+            }
+            value = slot->value;
+            m_dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+            slot->sequence.store(pos + m_mask + 1, std::memory_order_release);
+            return true;
+        }
+        // consumer thread only, true if the next pop would succeed
+        bool
+        is_ready() const
+        {
+            size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            return m_slots[pos & m_mask].sequence.load(std::memory_order_acquire) == pos + 1;
+        }
+        // any thread, every position below was claimed by a push and pops go in
+        // position order
+        size_t
+        get_enqueue_position() const
+        {
+            return m_enqueue_pos.load(std::memory_order_acquire);
+        }
+        // approximate, for statistics only
+        size_t
+        get_size() const
+        {
+            size_t enqueued = m_enqueue_pos.load(std::memory_order_relaxed);
+            size_t dequeued = m_dequeue_pos.load(std::memory_order_relaxed);
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+    };
+} // namespace Base
+} // namespace Sisyphus
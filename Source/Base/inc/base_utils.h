@@ -1,6 +1,8 @@
 #pragma once
 
 #include "base_constants.h"
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <cassert>
 
@@ -36,5 +38,15 @@ namespace Base
     replace_data(
         std::vector<uint8_t>& v, const uint8_t* data_ptr, const int dest_offset, const int src_size,
         const int src_offset);
+    // FNV-1a, chain calls to hash several values; not for hash tables of untrusted keys
+    const uint64_t hash_seed = 0xcbf29ce484222325ull;
+    uint64_t
+    hash_bytes(uint64_t hash, const void* data, size_t size);
+    template <typename T>
+    uint64_t
+    hash_value(uint64_t hash, const T& value)
+    {
+        return hash_bytes(hash, &value, sizeof(T));
+    }
 } // namespace Base
-} // namespace Sisyphus
\ No newline at end of file
+} // namespace Sisyphus
\ No newline at end of file
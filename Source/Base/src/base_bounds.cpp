@@ -0,0 +1,91 @@
+#include "base_bounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+Sisyphus::Base::Bounds
+Sisyphus::Base::calculate_bounds(const vec3_t* points, size_t count)
+{
+    Bounds bounds;
+    if (count == 0)
+    {
+        bounds.box.min = vec3_t {0.0f, 0.0f, 0.0f};
+        bounds.box.max = vec3_t {0.0f, 0.0f, 0.0f};
+        bounds.sphere.center = vec3_t {0.0f, 0.0f, 0.0f};
+        bounds.sphere.radius = 0.0f;
+        return bounds;
+    }
+    vec3_t min_point = points[0];
+    vec3_t max_point = points[0];
+    for (size_t i = 1; i < count; i++)
+    {
+        min_point.x = std::min(min_point.x, points[i].x);
+        min_point.y = std::min(min_point.y, points[i].y);
+        min_point.z = std::min(min_point.z, points[i].z);
+        max_point.x = std::max(max_point.x, points[i].x);
+        max_point.y = std::max(max_point.y, points[i].y);
+        max_point.z = std::max(max_point.z, points[i].z);
+    }
+    bounds.box.min = min_point;
+    bounds.box.max = max_point;
+    // sphere around box center, the farthest point defines radius
+    vec3_t center = (min_point + max_point) * 0.5f;
+    float  radius_sq = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        vec3_t d = points[i] - center;
+        radius_sq = std::max(radius_sq, d.calculate_dot_product(d));
+    }
+    bounds.sphere.center = center;
+    bounds.sphere.radius = sqrtf(radius_sq);
+    return bounds;
+}
+
+Sisyphus::Base::Bounds
+Sisyphus::Base::calculate_bounds(const std::vector<vec3_t>& points)
+{
+    return calculate_bounds(points.data(), points.size());
+}
+
+Sisyphus::Base::Bounds
+Sisyphus::Base::calculate_bounds(const std::vector<vec4_t>& points)
+{
+    std::vector<vec3_t> points3(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        points3[i] = points[i].xyz;
+    }
+    return calculate_bounds(points3.data(), points3.size());
+}
+
+Sisyphus::Base::BoundingSphere
+Sisyphus::Base::transform_sphere(const BoundingSphere& sphere, const mat4_t& m)
+{
+    BoundingSphere result;
+    vec4_t         center = m * vec4_t {sphere.center.x, sphere.center.y, sphere.center.z, 1.0f};
+    result.center = center.xyz;
+    // length of every basis vector, columns of the upper 3x3
+    float sx = m.r0.x * m.r0.x + m.r1.x * m.r1.x + m.r2.x * m.r2.x;
+    float sy = m.r0.y * m.r0.y + m.r1.y * m.r1.y + m.r2.y * m.r2.y;
+    float sz = m.r0.z * m.r0.z + m.r1.z * m.r1.z + m.r2.z * m.r2.z;
+    result.radius = sphere.radius * sqrtf(std::max(sx, std::max(sy, sz)));
+    return result;
+}
+
+Sisyphus::Base::BoundingBox
+Sisyphus::Base::transform_box(const BoundingBox& box, const mat4_t& m)
+{
+    // center is transformed, extents go through the absolute matrix (Arvo)
+    vec3_t      center = (box.min + box.max) * 0.5f;
+    vec3_t      extent = (box.max - box.min) * 0.5f;
+    vec4_t      new_center = m * vec4_t {center.x, center.y, center.z, 1.0f};
+    vec3_t      new_extent;
+    BoundingBox result;
+    new_extent.x = fabs(m.r0.x) * extent.x + fabs(m.r0.y) * extent.y + fabs(m.r0.z) * extent.z;
+    new_extent.y = fabs(m.r1.x) * extent.x + fabs(m.r1.y) * extent.y + fabs(m.r1.z) * extent.z;
+    new_extent.z = fabs(m.r2.x) * extent.x + fabs(m.r2.y) * extent.y + fabs(m.r2.z) * extent.z;
+    result.min = new_center.xyz - new_extent;
+    result.max = new_center.xyz + new_extent;
+    return result;
+}
@@ -0,0 +1,181 @@
+#include "base_memory.h"
+
+#include <cassert>
+#include <cstdlib>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+size_t
+Sisyphus::Base::align_up(size_t value, size_t alignment)
+{
+    assert((alignment & (alignment - 1)) == 0);
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Sisyphus::Base::AlignedBlock
+Sisyphus::Base::allocate_aligned_block(size_t size, bool huge_pages)
+{
+    AlignedBlock block;
+    if (size == 0)
+    {
+        return block;
+    }
+    block.huge_pages_requested = huge_pages;
+#if _WIN32
+    if (huge_pages)
+    {
+        // works only with SeLockMemoryPrivilege, otherwise regular allocation is used
+        size_t large_page = GetLargePageMinimum();
+        if (large_page > 0)
+        {
+            size_t large_size = align_up(size, large_page);
+            void*  ptr = VirtualAlloc(nullptr, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (ptr != nullptr)
+            {
+                block.data = reinterpret_cast<uint8_t*>(ptr);
+                block.capacity = large_size;
+                block.huge_pages = true;
+                return block;
+            }
+        }
+    }
+    size = align_up(size, cache_line_size);
+    block.data = reinterpret_cast<uint8_t*>(_aligned_malloc(size, cache_line_size));
+#else
+    size_t alignment = cache_line_size;
+    if (huge_pages)
+    {
+        // transparent huge pages need the whole range aligned to the huge page
+        alignment = huge_page_size;
+    }
+    size = align_up(size, alignment);
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size) != 0)
+    {
+        ptr = nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    if (ptr != nullptr && huge_pages)
+    {
+        block.huge_pages = madvise(ptr, size, MADV_HUGEPAGE) == 0;
+    }
+#endif
+    block.data = reinterpret_cast<uint8_t*>(ptr);
+#endif
+    block.capacity = block.data != nullptr ? size : 0;
+    return block;
+}
+
+void
+Sisyphus::Base::free_aligned_block(AlignedBlock& block)
+{
+    if (block.data != nullptr)
+    {
+#if _WIN32
+        if (block.huge_pages)
+        {
+            VirtualFree(block.data, 0, MEM_RELEASE);
+        }
+        else
+        {
+            _aligned_free(block.data);
+        }
+#else
+        free(block.data);
+#endif
+    }
+    block = AlignedBlock();
+}
+
+Sisyphus::Base::AlignedBlockPool::AlignedBlockPool(size_t max_free_blocks)
+    : m_max_free_blocks(max_free_blocks)
+{}
+
+Sisyphus::Base::AlignedBlockPool*
+Sisyphus::Base::AlignedBlockPool::instance()
+{
+    // initialization of a local static is thread safe; it is never destroyed, so
+    // render targets of other static objects can still be released at exit
+    static AlignedBlockPool* pool = new AlignedBlockPool(8);
+    return pool;
+}
+
+Sisyphus::Base::AlignedBlock
+Sisyphus::Base::AlignedBlockPool::acquire(size_t size, bool huge_pages)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // best fit, but do not hand out blocks that are way too big for the request
+        size_t best_idx = m_free_blocks.size();
+        for (size_t i = 0; i < m_free_blocks.size(); i++)
+        {
+            const AlignedBlock& block = m_free_blocks[i];
+            if (block.capacity >= size && block.capacity <= size * 2 && block.huge_pages_requested == huge_pages &&
+                (best_idx == m_free_blocks.size() || block.capacity < m_free_blocks[best_idx].capacity))
+            {
+                best_idx = i;
+            }
+        }
+        if (best_idx < m_free_blocks.size())
+        {
+            AlignedBlock block = m_free_blocks[best_idx];
+            m_free_blocks.erase(m_free_blocks.begin() + best_idx);
+            return block;
+        }
+    }
+    return allocate_aligned_block(size, huge_pages);
+}
+
+void
+Sisyphus::Base::AlignedBlockPool::release(AlignedBlock& block)
+{
+    if (block.data == nullptr)
+    {
+        return;
+    }
+    AlignedBlock evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free_blocks.push_back(block);
+        if (m_free_blocks.size() > m_max_free_blocks)
+        {
+            // the oldest block is the least likely to be requested again
+            evicted = m_free_blocks.front();
+            m_free_blocks.erase(m_free_blocks.begin());
+        }
+    }
+    free_aligned_block(evicted);
+    block = AlignedBlock();
+}
+
+void
+Sisyphus::Base::AlignedBlockPool::trim()
+{
+    std::vector<AlignedBlock> blocks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(blocks, m_free_blocks);
+    }
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        free_aligned_block(blocks[i]);
+    }
+}
+
+size_t
+Sisyphus::Base::AlignedBlockPool::get_free_block_count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_free_blocks.size();
+}
+
+Sisyphus::Base::AlignedBlockPool::~AlignedBlockPool()
+{
+    trim();
+}
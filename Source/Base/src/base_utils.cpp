@@ -37,3 +37,14 @@ Sisyphus::Base::replace_data(
     assert(dest_offset + src_size <= v.size());
     memcpy(&v[dest_offset], data_ptr + src_offset, src_size);
 }
+
+uint64_t
+Sisyphus::Base::hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
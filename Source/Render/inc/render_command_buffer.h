@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    enum class ECommandType : uint32_t {
+        SetViewport,
+        SetDescriptorSet,
+        SetVertexShader,
+        SetPixelShader,
+        SetModelMatrix,
+        SetViewMatrix,
+        SetPerspectiveMatrix,
+        SetPerspective,
+        SetDepthTest,
+        SetDepthWrite,
+        SetBackfaceCulling,
+        SetBlendMode,
+        SetWireframe,
+        SetPipelineState,
+        SetObjectId,
+        ClearDepth,
+        Fill,
+        DrawLines,
+        DrawTriangles,
+    };
+    struct CommandHeader {
+        ECommandType type;
+        uint32_t     size; // payload size, payload follows the header
+    };
+    struct PerspectiveCommand {
+        Base::mat4_t matrix;
+        Frustum      frustum;
+    };
+    struct WireframeCommand {
+        Base::vec4_t color;
+        float        width;
+        bool         enabled;
+    };
+    struct DrawCommand {
+        const std::vector<Base::vec4_t>* coords;
+        const std::vector<int>*          indices;
+        const uint8_t*                   vertex_data;
+        const VertexFormat*              v_in_format;
+        const VertexFormat*              v_out_format;
+        const Base::Bounds*              bounds; // nullptr - never culled as a whole
+        float                            depth_key;
+        bool                             sorted;
+    };
+    // state every recorded draw is executed with, resolved at submit
+    struct CommandState {
+        VertexShaderFunc     vsf;
+        PixelShaderFunc      psf;
+        bool                 depth_test;
+        bool                 depth_write;
+        ECullingMode         backface_culling;
+        EBlendMode           blend;
+        bool                 wireframe;
+        Base::vec4_t         wire_color;
+        float                wire_width;
+        const PipelineState* pipeline; // nullptr - pipeline built from the fields above
+        Base::mat4_t         model_matrix;
+        Base::mat4_t         view_matrix;
+        Base::mat4_t         perspective_matrix;
+        Frustum              frustum;
+        uint32_t             object_id;
+        const uint8_t*       descriptor_set; // nullptr - context keeps its own
+        uint32_t             descriptor_set_size;
+    };
+    // records state changes, clears and draws into one linear buffer without
+    // touching any context, so several buffers can be recorded on different
+    // threads and then submitted in order with Context::submit. Geometry is not
+    // copied - it should stay alive until submit returns.
+    class CommandBuffer {
+        std::vector<uint8_t> m_data;
+        uint32_t             m_command_count = 0;
+        //
+        uint8_t*
+        allocate_command(ECommandType type, uint32_t size);
+        template <typename T>
+        void
+        add_command(ECommandType type, const T& payload)
+        {
+            memcpy(allocate_command(type, sizeof(T)), &payload, sizeof(T));
+        }
+
+      public:
+        void
+        reset(); // keeps memory for the next recording
+        const uint8_t*
+        get_data() const;
+        size_t
+        get_size() const;
+        uint32_t
+        get_command_count() const;
+        //
+        void
+        set_viewport(float x_min, float y_min, float z_min, float x_max, float y_max, float z_max);
+        void
+        set_descriptor_set(const std::vector<uint8_t>& descriptor_set); // copied into the buffer
+        void
+        set_vertex_shader(VertexShaderFunc vsf);
+        void
+        set_pixel_shader(PixelShaderFunc psf);
+        void
+        set_model_matrix(const Base::mat4_t& m);
+        void
+        set_view_matrix(const Base::mat4_t& m);
+        void
+        set_perspective_matrix(const Base::mat4_t& m);
+        void
+        set_perspective(float fov, float aspect, float znear, float zfar);
+        void
+        set_depth_test(bool flag);
+        void
+        set_depth_write(bool flag);
+        void
+        set_backface_culling(ECullingMode mode);
+        void
+        set_blend_mode(EBlendMode mode);
+        void
+        set_wireframe(bool flag, const Base::vec4_t& color, float width);
+        // like on the context, any set_* call of the state above unbinds it again
+        void
+        set_pipeline_state(const PipelineState* pipeline);
+        void
+        set_object_id(uint32_t id);
+        void
+        clear_depth(float val);
+        void
+        fill(const col4u_t& color);
+        void
+        draw_lines(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds = nullptr);
+        // opaque draw that may be reordered at submit - grouped by state and then
+        // sorted front-to-back by depth_key (for example view space distance);
+        // bounds of the whole sorted run are frustum tested in one batch
+        void
+        draw_triangles_sorted(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const VertexFormat& v_in_format, const VertexFormat& v_out_format, float depth_key,
+            const Base::Bounds* bounds = nullptr);
+    };
+} // namespace Render
+} // namespace Sisyphus
@@ -2,6 +2,9 @@
 
 #include <cstdint>
 #include "render_color.h"
+#include "render_frame_storage.h"
+#include "render_swapchain.h"
+#include "base_bounds.h"
 #include "base_vectors.h"
 #include "base_matrices.h"
 
@@ -12,6 +15,9 @@ namespace Render
     enum class EPrimitiveType {
         LINE,
         TRIANGLE,
+        LINE_STRIP,
+        TRIANGLE_STRIP, // every next index makes a triangle with the previous two
+        TRIANGLE_FAN, // every next index makes a triangle with the previous and the first one
     };
     enum class EVertexAttribType {
         FLOAT32,
@@ -27,6 +33,58 @@ namespace Render
         ClockWise,
         CounterClockWise
     };
+    enum class EBlendMode {
+        Opaque,
+        Alpha, // src * src.a + dst * (1 - src.a)
+    };
+    enum class EIndexType {
+        UINT16,
+        UINT32,
+    };
+    // non-owning geometry, e.g. straight from a mapped asset file or a pool;
+    // index i of the draw is indices[index_offset + i] + base_vertex. Strips and
+    // fans start over after the restart index - all ones of the index type
+    struct GeometryView {
+        EPrimitiveType      topology = EPrimitiveType::TRIANGLE; // LINE or LINE_STRIP for line draws
+        const Base::vec4_t* coords = nullptr;
+        uint32_t            vertex_count = 0; // 0 - found from the indices, every index must be below it
+        const void*         indices = nullptr;
+        EIndexType          index_type = EIndexType::UINT32;
+        uint32_t            index_offset = 0;
+        uint32_t            index_count = 0;
+        int32_t             base_vertex = 0;
+        const uint8_t*      vertex_data = nullptr; // vertex_count elements of the input format
+        GeometryView() = default;
+        GeometryView(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data);
+        GeometryView(
+            const std::vector<Base::vec4_t>& coords, const std::vector<uint16_t>& indices,
+            const uint8_t* vertex_data);
+    };
+    inline uint32_t
+    get_geometry_raw_index(const GeometryView& geometry, uint32_t i)
+    {
+        // predictable branch, cheaper than a loop variant per index type
+        return geometry.index_type == EIndexType::UINT16
+                   ? static_cast<const uint16_t*>(geometry.indices)[geometry.index_offset + i]
+                   : static_cast<const uint32_t*>(geometry.indices)[geometry.index_offset + i];
+    }
+    inline int
+    get_geometry_index(const GeometryView& geometry, uint32_t i)
+    {
+        return (int)get_geometry_raw_index(geometry, i) + geometry.base_vertex;
+    }
+    inline bool
+    is_restart_index(const GeometryView& geometry, uint32_t raw_index)
+    {
+        return raw_index == (geometry.index_type == EIndexType::UINT16 ? 0xffffu : 0xffffffffu);
+    }
+    // index of the specialized raster loop for the given fixed function state
+    int
+    get_pipeline_variant(
+        ECullingMode backface_culling, bool depth_test, bool depth_write, EBlendMode blend, bool wireframe);
+    const int pipeline_variant_count = 3 * 2 * 2 * 2 * 2;
+    const int line_pipeline_variant_count = 2 * 2 * 2; // lines ignore culling and wireframe
     struct VertexFormat {
         size_t                         size;
         std::vector<EVertexAttribType> attributes; // position is always in the beginning
@@ -46,6 +104,37 @@ namespace Render
     using PixelShaderFunc = Base::vec4_t (*)(
         const Base::vec4_t& input, const uint8_t* per_pixel_np, const std::vector<uint8_t>& builtins,
         const std::vector<uint8_t>& descriptor_set); // over single pixel
+    // builtins hold model, view, perspective, model view and transform matrices;
+    // instanced and indirect draws append this block after them, followed by
+    // the data of the instance and then the constants of the draw
+    struct InstanceBlock {
+        int32_t  instance;
+        int32_t  draw;
+        uint32_t instance_data_size;
+        uint32_t draw_data_size;
+    };
+    const uint32_t builtin_instance_offset = sizeof(Base::mat4_t) * 5;
+    const uint32_t builtin_instance_data_offset = builtin_instance_offset + sizeof(InstanceBlock);
+    int
+    get_instance_index(const std::vector<uint8_t>& builtins); // 0 outside of instanced draws
+    const uint8_t*
+    get_instance_data(const std::vector<uint8_t>& builtins); // nullptr outside of instanced draws
+    int
+    get_draw_index(const std::vector<uint8_t>& builtins); // record of the indirect draw, 0 otherwise
+    const uint8_t*
+    get_draw_constants(const std::vector<uint8_t>& builtins); // nullptr outside of indirect draws
+    // du/dx, dv/dx, du/dy, dv/dy in pixels of the uv of the pixel being shaded on
+    // this thread, for Texture::sample; see Context::set_texture_gradients
+    const Base::vec4_t&
+    get_texture_gradients();
+    // one record of a multi-draw, like the indexed indirect arguments of graphics APIs
+    struct DrawIndirectCommand {
+        uint32_t index_offset;
+        uint32_t index_count;
+        uint32_t instance_count; // 0 - skipped, so culling can drop records in place
+        int32_t  base_vertex; // added to every index of the draw
+        uint32_t first_instance; // instance data of the draw starts here
+    };
     //
     using LogFunc = void (*)(const char* msg, unsigned int msg_length);
     //
@@ -58,10 +147,42 @@ namespace Render
     struct Frustum {
         Plane bounds[6];
     };
+    Frustum
+    calculate_frustum(float fov, float aspect, float znear, float zfar); // fov in radians, view space planes
+    //
+    class CommandBuffer;
+    struct CommandState;
+    class DirtyTiles;
+    struct DrawCommand;
+    struct MeshletMesh;
+    class Mesh;
+    class OcclusionBuffer;
+    class OcclusionQuery;
+    class PipelineState;
+    struct ReadbackDesc;
+    class TransformCache;
+    // top-most object of a pixel, see Context::pick
+    struct PickResult {
+        uint32_t object_id = 0;
+        uint32_t primitive_id = 0; // triangle or segment of the draw, if primitive ids are kept
+        float    depth = 0.0f;
+        int      x = -1;
+        int      y = -1;
+    };
+    // independent line lists drawn with the same state in one call
+    struct LineBatch {
+        const std::vector<Base::vec4_t>* coords;
+        const std::vector<int>*          indices; // pairs
+        const uint8_t*                   vertex_data;
+        const Base::Bounds*              bounds = nullptr; // nullptr - never culled as a whole
+    };
     //
     class Context {
       private:
-        uint8_t*             m_data = nullptr;
+        Swapchain            m_swapchain;
+        FrameStorage         m_frame_storage; // depth only, color lives in swapchain buffers
+        uint8_t*             m_data = nullptr; // current back buffer
+        FrameBuffer*         m_back_buffer = nullptr;
         float*               m_depth = nullptr;
         int                  m_width = 0;
         int                  m_height = 0;
@@ -74,6 +195,11 @@ namespace Render
         bool                 m_depth_write = true;
         bool                 m_depth_test = true;
         ECullingMode         m_backface_culling = ECullingMode::None;
+        EBlendMode           m_blend = EBlendMode::Opaque;
+        bool                 m_wireframe = false;
+        Base::vec4_t         m_wire_color = {0.0f, 0.0f, 0.0f, 1.0f};
+        float                m_wire_width = 1.0f;
+        VertexFormat         m_wire_format = VertexFormat({}); // output format with barycentrics appended
         Base::mat4_t         m_model_matrix = Base::mat4_t::get_identity_matrix();
         Base::mat4_t         m_view_matrix = Base::mat4_t::get_identity_matrix();
         Base::mat4_t         m_perspective_matrix = Base::mat4_t::get_identity_matrix();
@@ -81,19 +207,143 @@ namespace Render
         Base::mat4_t         m_transform_matrix = Base::mat4_t::get_identity_matrix();
         std::vector<uint8_t> m_builtins; // default matrices - immediate mode
         //
-        Frustum m_frustum;
+        Frustum                m_frustum;
+        const OcclusionBuffer* m_occlusion = nullptr;
+        OcclusionQuery*        m_active_query = nullptr;
+        uint64_t               m_query_samples = 0; // counted always, read by end_query
+        uint64_t               m_frame_index = 0; // presents so far
+        TransformCache*        m_transform_capture = nullptr; // capture loops fill it instead of rasterizing
+        int                    m_texture_gradient_offset = -1; // uv of vertex outputs, in bytes
+        //
+        ScreenRect              m_scissor = {0, 0, 0, 0};
+        DirtyTiles*             m_dirty_tiles = nullptr; // incremental submit in progress
+        bool                    m_dirty_recording = false; // draws are only listed, nothing is rendered
+        uint32_t                m_dirty_draw = 0; // draws of the current incremental pass
+        bool                    m_incremental_frame = false; // the whole frame is dirty otherwise
+        std::vector<ScreenRect> m_dirty_rects; // of the frame being rendered
+        //
+        std::vector<uint32_t> m_object_ids;
+        std::vector<uint32_t> m_primitive_ids;
+        uint32_t*             m_object_id_data = nullptr; // nullptr - ids are not written
+        uint32_t*             m_primitive_id_data = nullptr;
+        bool                  m_keep_object_ids = false;
+        bool                  m_keep_primitive_ids = false;
+        uint32_t              m_object_id = 0;
+        uint32_t              m_pixel_object_id = 0; // object id plus the instance index of instanced draws
+        uint32_t              m_primitive_id = 0;
         //
         LogFunc m_log = nullptr;
+        // bound pipeline - explicit state object or the one built from set_* calls
+        using TriangleLoop = void (Context::*)(const GeometryView&, const VertexFormat&, const VertexFormat&);
+        using LineLoop = void (Context::*)(const GeometryView&, const VertexFormat&, const VertexFormat&);
+        using CachedTriangleLoop = void (Context::*)(TransformCache&);
+        static const TriangleLoop       s_triangle_loops[pipeline_variant_count];
+        static const LineLoop           s_line_loops[line_pipeline_variant_count];
+        static const CachedTriangleLoop s_cached_triangle_loops[pipeline_variant_count / 3]; // culling is baked in
+        static const TriangleLoop       s_capture_triangle_loops[pipeline_variant_count / line_pipeline_variant_count];
+        const PipelineState*            m_pipeline = nullptr;
+        bool                            m_legacy_pipeline_dirty = true;
+        int                             m_pipeline_variant = 0;
+        TriangleLoop                    m_triangle_loop = nullptr;
+        LineLoop                        m_line_loop = nullptr;
+        VertexShaderFunc                m_bound_vsf = nullptr;
+        PixelShaderFunc                 m_bound_psf = nullptr;
+        // post-transform vertices of the last triangle, strips and fans reuse two of them
+        std::vector<uint8_t>      m_triangle_vertex_out[3];
+        // line scratch, grows and is reused between draws
+        std::vector<uint8_t>      m_vertex_out;
+        std::vector<uint32_t>     m_line_vertex_stamps;
+        uint32_t                  m_line_stamp = 0;
+        std::vector<Base::vec4_t> m_line_vertices;
+        std::vector<uint8_t>      m_line_vertex_data;
+        std::vector<uint8_t>      m_line_scratch;
+        //
+        void
+        bind_back_buffer();
+        void
+        bind_pipeline_loops(int variant, VertexShaderFunc vsf, PixelShaderFunc psf);
+        void
+        invalidate_pipeline(); // set_* call - back to the state built from set_* calls
+        void
+        update_pipeline();
+        template <EBlendMode Blend>
+        void
+        write_pixel(int x, int y, const Base::vec4_t& color);
+        void
+        write_ids(int pix_flat_idx);
+        void
+        update_id_buffers(); // sized to the frame or released
+        template <bool DepthTest, bool DepthWrite, EBlendMode Blend, bool Wire = false>
+        void
+        render_pixel(const Base::vec4_t& p, const uint8_t* data, float wire_distance = 0.0f);
+        template <bool DepthTest, bool DepthWrite, EBlendMode Blend, bool Wire>
+        bool
+        rasterize_triangle(
+            const Base::vec4_t& a_visible, const Base::vec4_t& b_visible, const Base::vec4_t& c_visible,
+            uint8_t* vertex_out_a_ptr, uint8_t* vertex_out_b_ptr, uint8_t* vertex_out_c_ptr,
+            const VertexFormat& v_out_format);
+        template <bool DepthTest, bool DepthWrite, EBlendMode Blend>
+        void
+        rasterize_line(
+            const Base::vec4_t& a_visible, const Base::vec4_t& b_visible, const uint8_t* a_data,
+            const uint8_t* b_data, const VertexFormat& v_out_format, bool float_format, bool last_pixel);
+        template <ECullingMode Cull, bool DepthTest, bool DepthWrite, EBlendMode Blend, bool Wire, bool Capture = false>
+        void
+        draw_triangles_loop(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format);
+        template <bool DepthTest, bool DepthWrite, EBlendMode Blend>
+        void
+        draw_lines_loop(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format);
+        template <bool DepthTest, bool DepthWrite, EBlendMode Blend, bool Wire>
+        void
+        draw_cached_triangles_loop(TransformCache& cache);
+        void
+        capture_command_state(CommandState& state) const; // descriptor set is left to the context
+        void
+        apply_command_state(const CommandState& state, bool with_descriptor_set);
+        void
+        execute_draw(const DrawCommand& draw, bool triangles, bool test_bounds);
+        // true if an incremental submit skips the draw - it is listed or misses the scissor;
+        // instance_signature is a hash of instance inputs, not 0 for instanced draws whose
+        // vertices move with them, without bounds such draws cover the whole frame
+        bool
+        skip_dirty_draw(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            const Base::Bounds* bounds, uint64_t instance_signature = 0);
+        // bounds or, without them, vertex shader outputs of [first_vertex, last_vertex] projected to screen
+        ScreenRect
+        calculate_screen_rect(
+            const GeometryView& geometry, uint32_t first_vertex, uint32_t last_vertex, const VertexFormat& v_in_format,
+            const VertexFormat& v_out_format, const Base::Bounds* bounds);
+        // builtins are sized by the caller, only the instance part of the block is written
+        void
+        draw_triangle_instances(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            int first_instance, int instance_count, const uint8_t* instance_data, uint32_t instance_size);
 
       public:
         Context(int width, int height, int bytes_per_pixel);
         const uint8_t*
-        get_frame() const;
+        get_frame() const; // last presented frame
         const unsigned int
         get_frame_size() const;
         void
         resize(int width, int height, int bytes_per_pixel);
         void
+        set_huge_pages(bool flag);
+        void
+        set_buffer_count(int buffer_count);
+        uint64_t
+        present(); // finish the frame, next draws go to another buffer
+        const FrameBuffer*
+        acquire_frame(); // read in place, then release
+        void
+        release_frame(const FrameBuffer* frame);
+        // rect of the last presented frame in another format or size, see read_frame_region
+        bool
+        read_frame(const ReadbackDesc& desc, uint8_t* dst, size_t dst_size);
+        void
         set_viewport(float x_min, float y_min, float z_min, float x_max, float y_max, float z_max);
         void
         set_descriptor_set(const std::vector<uint8_t>& descriptor_set);
@@ -111,6 +361,44 @@ namespace Render
         set_perspective(float fov, float aspect, float znear, float zfar);
         void
         set_frustum(float fov, float aspect, float znear, float zfar);
+        const Frustum&
+        get_frustum() const;
+        const Base::mat4_t&
+        get_model_view_matrix() const;
+        // hidden draws and clusters are skipped by their bounds, nullptr disables
+        void
+        set_occlusion_buffer(const OcclusionBuffer* occlusion);
+        const OcclusionBuffer*
+        get_occlusion_buffer() const;
+        // whole draw test with the current model view matrix against the frustum
+        // and the occlusion buffer, see render_culling.h
+        bool
+        is_visible(const Base::Bounds& bounds) const;
+        // samples passing the depth test of every draw in between are counted
+        // into the query, the result is written at end_query
+        void
+        begin_query(OcclusionQuery* query);
+        void
+        end_query();
+        // faces of the box turned to the camera are tested against the depth
+        // buffer without writing anything, a box crossing the near plane counts
+        void
+        draw_query_proxy(const Base::BoundingBox& box);
+        // 32 bit object id, and optionally primitive id, written with the color of
+        // every pixel; fill resets them to 0 - background. Disabled costs a branch
+        // per pixel. Ids stay until the next fill, depth until the next clear
+        void
+        set_id_buffer(bool object_ids, bool primitive_ids = false);
+        void
+        set_object_id(uint32_t id); // for next draws, instanced draws add the instance index
+        uint32_t
+        get_object_id() const;
+        // false for background or with ids disabled; a rect gives the nearest
+        // object pixel by depth, so draws without depth write may lose
+        bool
+        pick(int x, int y, PickResult& result) const;
+        bool
+        pick(const ScreenRect& rect, PickResult& result) const;
         void
         put_pixel(int x, int y, const Base::vec4_t& color);
         void
@@ -135,15 +423,153 @@ namespace Render
         void
         set_backface_culling(ECullingMode mode);
         void
+        set_blend_mode(EBlendMode mode);
+        // triangle edges are blended over the shaded result in the same pass
+        void
+        set_wireframe(bool flag);
+        void
+        set_wireframe_style(const Base::vec4_t& color, float width); // width in pixels, also for pipeline states
+        // triangles find screen space derivatives of the vec2 at uv_offset bytes into
+        // vertex outputs for get_texture_gradients, exact for perspective; -1 - off
+        void
+        set_texture_gradients(int uv_offset);
+        // binds immutable state, shaders and formats at once; nullptr or any
+        // set_* call above switches back to the state built from set_* calls
+        void
+        set_pipeline_state(const PipelineState* pipeline);
+        const PipelineState*
+        get_pipeline_state() const;
+        // pixels outside are left untouched by draws, fills and depth clears
+        void
+        set_scissor(const ScreenRect& rect);
+        void
+        reset_scissor(); // whole frame
+        const ScreenRect&
+        get_scissor() const;
+        void
         clear_depth(float val);
+        // draws with bounds outside of the frustum return before any vertex work
         void
         draw_lines(
             const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
-            const VertexFormat& v_in_format, const VertexFormat& v_out_Format);
+            const VertexFormat& v_in_format, const VertexFormat& v_out_Format, const Base::Bounds* bounds = nullptr);
         void
         draw_triangles(
             const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds = nullptr);
+        // same as above without copying geometry into vectors, indices may be 16 bit
+        void
+        draw_lines(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            const Base::Bounds* bounds = nullptr);
+        void
+        draw_line_batches(
+            const LineBatch* batches, int batch_count, const VertexFormat& v_in_format,
+            const VertexFormat& v_out_format);
+        // clusters outside of the frustum or facing away are skipped before their vertices are shaded
+        void
+        draw_meshlets(
+            const std::vector<Base::vec4_t>& coords, const MeshletMesh& mesh, const uint8_t* vertex_data,
             const VertexFormat& v_in_format, const VertexFormat& v_out_format);
+        // skipped when the query, usually a proxy of the previous frame, finished
+        // with zero samples; never waits for the query
+        void
+        draw_lines_conditional(
+            const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+            const uint8_t* vertex_data, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles_conditional(
+            const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+            const uint8_t* vertex_data, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            const Base::Bounds* bounds = nullptr);
+        // draws with vertex formats of the bound pipeline state
+        void
+        draw_lines(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const Base::Bounds* bounds = nullptr);
+        void
+        draw_lines(const GeometryView& geometry, const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles(const GeometryView& geometry, const Base::Bounds* bounds = nullptr);
+        void
+        draw_lines_conditional(
+            const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+            const uint8_t* vertex_data, const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles_conditional(
+            const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+            const uint8_t* vertex_data, const Base::Bounds* bounds = nullptr);
+        // the same mesh instance_count times with one setup, the vertex shader
+        // reads the instance from builtins; bounds cover all instances at once
+        void
+        draw_triangles_instanced(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const VertexFormat& v_in_format, const VertexFormat& v_out_format, int instance_count,
+            const uint8_t* instance_data, const VertexFormat& instance_format, const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles_instanced(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            int instance_count, const uint8_t* instance_data, const VertexFormat& instance_format,
+            const Base::Bounds* bounds = nullptr);
+        void
+        draw_triangles_instanced(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            int instance_count, const uint8_t* instance_data, const VertexFormat& instance_format,
+            const Base::Bounds* bounds = nullptr);
+        // many draws of one buffer set with one setup, records usually come from a
+        // culling pass; the vertex shader reads the record index and its
+        // constants, draw_constants_size bytes per record, from builtins
+        void
+        draw_triangles_indirect(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const VertexFormat& v_in_format, const VertexFormat& v_out_format, const DrawIndirectCommand* draws,
+            int draw_count, const uint8_t* instance_data, const VertexFormat& instance_format,
+            const uint8_t* draw_constants, uint32_t draw_constants_size);
+        void
+        draw_triangles_indirect(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+            const DrawIndirectCommand* draws, int draw_count, const uint8_t* instance_data,
+            const VertexFormat& instance_format, const uint8_t* draw_constants, uint32_t draw_constants_size);
+        // record ranges are relative to the index offset of the view, base vertices add up
+        void
+        draw_triangles_indirect(
+            const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+            const DrawIndirectCommand* draws, int draw_count, const uint8_t* instance_data,
+            const VertexFormat& instance_format, const uint8_t* draw_constants, uint32_t draw_constants_size);
+        // static mesh with bounds tested every draw; the vertex shader, culling and
+        // clipping run only when the cache key changes, see render_transform_cache.h
+        void
+        draw_triangles_cached(
+            TransformCache& cache, const Mesh& mesh, const VertexFormat& v_in_format,
+            const VertexFormat& v_out_format);
+        void
+        draw_triangles_cached(TransformCache& cache, const Mesh& mesh);
+        // executes recorded buffers in order, sorted draws of each run between
+        // clears are reordered by state and depth unless sort_draws is false
+        void
+        submit(const CommandBuffer* const* buffers, int buffer_count, bool sort_draws = true);
+        void
+        submit(const CommandBuffer& buffer, bool sort_draws = true);
+        // buffers are executed twice - first draws are only listed with their
+        // screen rects to find dirty tiles, then everything touching them is
+        // rendered again with the scissor around them; the rest of the back
+        // buffer keeps its previous contents. Buffers should fill and clear the
+        // whole frame, as for a regular submit. Rects changed against the previous
+        // frame are passed to the consumer in FrameBuffer::dirty_rects
+        void
+        submit_incremental(
+            const CommandBuffer* const* buffers, int buffer_count, DirtyTiles& tiles, bool sort_draws = true);
+        void
+        submit_incremental(const CommandBuffer& buffer, DirtyTiles& tiles, bool sort_draws = true);
         //
         void
         set_log_func(LogFunc log);
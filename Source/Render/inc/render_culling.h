@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include "base_bounds.h"
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    // whole draw tests in view space against the frustum planes, so the vertex
+    // shader is expected to output model_view * position like the sample one
+    bool
+    is_sphere_visible(const Base::BoundingSphere& view_sphere, const Frustum& frustum);
+    bool
+    is_box_visible(const Base::BoundingBox& view_box, const Frustum& frustum);
+    bool
+    is_visible(const Base::Bounds& bounds, const Base::mat4_t& model_view, const Frustum& frustum);
+    // planes of the frustum in the space m maps from, m is affine - for example
+    // the view matrix gives world space planes for tests without model view
+    Frustum
+    transform_frustum(const Frustum& frustum, const Base::mat4_t& m);
+    // view space spheres packed as xyz - center, w - radius; visible gets 1 or 0 per sphere
+    void
+    cull_spheres(const Base::vec4_t* view_spheres, int count, const Frustum& frustum, uint8_t* visible);
+    // many draws at once - spheres first, survivors are refined with the box;
+    // nullptr bounds are always visible. Returns the number of visible draws
+    int
+    cull_bounds(
+        const Base::Bounds* const* bounds, const Base::mat4_t* model_views, int count, const Frustum& frustum,
+        uint8_t* visible);
+} // namespace Render
+} // namespace Sisyphus
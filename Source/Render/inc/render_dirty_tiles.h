@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    // screen split into square tiles; every frame the draws are listed with a
+    // signature of everything they depend on and the screen rect they cover.
+    // Rects of draws that appeared or disappeared against the previous frame
+    // are dirty, the rest of the frame is left as it was. Draws with the same
+    // signatures in another order count as unchanged, so blended draws that
+    // swap places should change their signatures, e.g. by a descriptor set.
+    // Used by Context::submit_incremental
+    class DirtyTiles {
+      public:
+        static const int history_size = Swapchain::max_buffer_count;
+
+      private:
+        struct DrawRecord {
+            uint64_t   signature;
+            ScreenRect rect;
+        };
+        int                     m_tile_size;
+        int                     m_width = 0;
+        int                     m_height = 0;
+        int                     m_tiles_x = 0;
+        int                     m_tiles_y = 0;
+        std::vector<DrawRecord> m_previous;
+        std::vector<DrawRecord> m_current; // in submit order
+        std::vector<DrawRecord> m_sorted;
+        std::vector<uint8_t>    m_changed; // tiles changed against the previous frame
+        std::vector<uint8_t>    m_redraw; // tiles to render into the back buffer
+        // changed tiles of the last frames, the back buffer may be a few frames behind
+        std::vector<uint8_t> m_history[history_size];
+        uint64_t             m_history_frame[history_size] = {};
+        bool                 m_invalid = true;
+        //
+        void
+        mark_rect(std::vector<uint8_t>& tiles, const ScreenRect& rect);
+        void
+        append_rects(const std::vector<uint8_t>& tiles, std::vector<ScreenRect>& rects) const;
+
+      public:
+        DirtyTiles(int tile_size = 32);
+        void
+        invalidate(); // next frame is rendered in full, e.g. after a change nothing is signed for
+        void
+        begin_frame(int width, int height); // a new size invalidates
+        void
+        add_draw(uint64_t signature, const ScreenRect& rect);
+        // frame_index - the frame being rendered, content_frame_index - the one
+        // left in its back buffer, 0 if the buffer never was presented
+        void
+        end_frame(uint64_t frame_index, uint64_t content_frame_index);
+        const ScreenRect&
+        get_draw_rect(uint32_t draw) const; // draws of the current frame in submit order
+        uint32_t
+        get_draw_count() const;
+        bool
+        is_redraw_tile(int x, int y) const;
+        void
+        get_changed_rects(std::vector<ScreenRect>& rects) const; // against the previous frame
+        void
+        get_redraw_rects(std::vector<ScreenRect>& rects) const;
+    };
+} // namespace Render
+} // namespace Sisyphus
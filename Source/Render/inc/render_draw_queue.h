@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "base_mpsc_queue.h"
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    const uint32_t max_packet_descriptor_size = 256;
+    enum class EDrawPacketType {
+        Commands, // recorded frame setup - viewport, camera, clears
+        DrawTriangles,
+        DrawLines,
+        QueryProxy, // bounds box into query with the model matrix, pipeline is not needed
+        Resize,
+        Present,
+    };
+    // everything is referenced except the descriptor set and the model matrix,
+    // referenced data should stay alive until the packet is executed
+    struct DrawPacket {
+        EDrawPacketType                  type = EDrawPacketType::DrawTriangles;
+        const CommandBuffer*             commands = nullptr;
+        const PipelineState*             pipeline = nullptr; // required for draws
+        const std::vector<Base::vec4_t>* coords = nullptr;
+        const std::vector<int>*          indices = nullptr;
+        const uint8_t*                   vertex_data = nullptr;
+        const Base::Bounds*              bounds = nullptr; // optional, tested before any vertex work
+        OcclusionQuery*                  query = nullptr; // samples of the draw are counted into it
+        const OcclusionQuery*            condition = nullptr; // skipped while it reports zero samples
+        Base::mat4_t                     model_matrix = Base::mat4_t::get_identity_matrix();
+        uint32_t                         descriptor_set_size = 0; // 0 - keep the current one
+        uint8_t                          descriptor_set[max_packet_descriptor_size];
+        int                              width = 0; // resize only
+        int                              height = 0;
+        int                              bytes_per_pixel = 0;
+        int64_t                          submit_time = 0; // set by the queue
+    };
+    void
+    set_packet_descriptor_set(DrawPacket& packet, const std::vector<uint8_t>& descriptor_set);
+    struct DrawQueueStats {
+        uint64_t submitted = 0;
+        uint64_t executed = 0;
+        uint64_t stalled_submits = 0; // submits that waited for a free slot
+        uint64_t stall_time_ns = 0;
+        uint64_t total_latency_ns = 0; // from submit to execution start
+        uint64_t max_latency_ns = 0;
+        uint64_t max_queue_size = 0;
+    };
+    // render thread that owns a context and executes draw packets pushed by any
+    // number of threads through a bounded lock-free queue. Packets of one
+    // producer keep their order, packets of different producers interleave, so
+    // the frame owner submits Present once the other producers are done.
+    class DrawQueue {
+        Context                            m_context;
+        Base::BoundedMpscQueue<DrawPacket> m_queue;
+        std::vector<uint8_t>               m_descriptor_set;
+        std::thread                        m_thread;
+        std::mutex                         m_mutex; // only for sleeping, never taken per packet
+        std::condition_variable            m_wake;
+        std::condition_variable            m_idle;
+        std::atomic<bool>                  m_sleeping;
+        std::atomic<bool>                  m_stop;
+        std::atomic<int>                   m_flush_waiters;
+        std::atomic<uint64_t>              m_executed;
+        std::atomic<uint64_t>              m_stalled_submits;
+        std::atomic<uint64_t>              m_stall_time;
+        std::atomic<uint64_t>              m_total_latency;
+        std::atomic<uint64_t>              m_max_latency;
+        std::atomic<uint64_t>              m_max_queue_size;
+        //
+        void
+        run();
+        void
+        execute(const DrawPacket& packet);
+
+      public:
+        DrawQueue(int width, int height, int bytes_per_pixel, size_t capacity); // capacity is power of two
+        DrawQueue(const DrawQueue&) = delete;
+        DrawQueue&
+        operator=(const DrawQueue&) = delete;
+        bool
+        try_submit(const DrawPacket& packet); // false if the queue is full
+        void
+        submit(const DrawPacket& packet); // waits for a free slot
+        void
+        flush(); // wait until every packet submitted before is executed
+        DrawQueueStats
+        get_stats() const;
+        void
+        reset_stats();
+        const FrameBuffer*
+        acquire_frame(); // any thread
+        void
+        release_frame(const FrameBuffer* frame);
+        Context&
+        get_context(); // only after flush while nobody submits
+        ~DrawQueue();
+    };
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Sisyphus
+{
+namespace Render
+{
+    using FrameJob = std::function<void()>;
+    // runs frame jobs in submission order on a dedicated render thread. Submit
+    // returns right away unless max_frames_in_flight jobs are still unfinished,
+    // consumers wait only for the frame they need. Zero frames in flight means
+    // jobs run inline on the submitting thread.
+    class FrameQueue {
+        std::deque<FrameJob>    m_jobs;
+        std::thread             m_thread;
+        std::mutex              m_mutex;
+        std::condition_variable m_job_added;
+        std::condition_variable m_job_completed;
+        uint64_t                m_submitted = 0;
+        uint64_t                m_completed = 0;
+        int                     m_max_frames_in_flight = 0;
+        bool                    m_stop = false;
+        //
+        void
+        run();
+
+      public:
+        FrameQueue(int max_frames_in_flight);
+        FrameQueue(const FrameQueue&) = delete;
+        FrameQueue&
+        operator=(const FrameQueue&) = delete;
+        void
+        set_max_frames_in_flight(int count);
+        int
+        get_max_frames_in_flight() const;
+        uint64_t
+        submit(FrameJob job); // returns frame id, ids start from 1
+        void
+        wait_frame(uint64_t frame_id);
+        bool
+        is_frame_completed(uint64_t frame_id);
+        void
+        flush(); // wait for every submitted frame
+        ~FrameQueue();
+    };
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include "base_memory.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    // color and depth memory of a render target. Capacity grows with headroom and
+    // shrinks only after the target stayed much smaller for a while, so interactive
+    // window resizing does not reallocate on every step. Blocks come from and
+    // return to Base::AlignedBlockPool.
+    class FrameStorage {
+        Base::AlignedBlock m_color;
+        Base::AlignedBlock m_depth;
+        int                m_shrink_requests = 0;
+        bool               m_huge_pages = false;
+        //
+        void
+        reserve_block(Base::AlignedBlock& block, size_t size, bool allow_shrink);
+
+      public:
+        static const int shrink_delay = 120; // reserve calls in a row with small size before shrinking
+        FrameStorage() = default;
+        FrameStorage(const FrameStorage&) = delete;
+        FrameStorage&
+        operator=(const FrameStorage&) = delete;
+        void
+        set_huge_pages(bool flag);
+        void
+        reserve(size_t color_size, size_t depth_size); // both in bytes
+        uint8_t*
+        get_color() const;
+        float*
+        get_depth() const;
+        size_t
+        get_color_capacity() const; // in bytes
+        size_t
+        get_depth_capacity() const; // in bytes
+        void
+        release();
+        ~FrameStorage();
+    };
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "base_bounds.h"
+#include "render_context.h"
+#include "render_meshlet.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    // positions and input attributes of one vertex format. Every buffer gets
+    // a unique id and a version that grows with each update, so work derived
+    // from the contents can be cached across frames by (id, version)
+    class VertexBuffer {
+        uint64_t                  m_id;
+        uint64_t                  m_version = 0;
+        VertexFormat              m_format;
+        std::vector<Base::vec4_t> m_coords;
+        std::vector<uint8_t>      m_data;
+
+      public:
+        VertexBuffer(const VertexFormat& format);
+        // false and nothing changes if data does not hold vertex_count vertices of the format
+        bool
+        update(const Base::vec4_t* coords, uint32_t vertex_count, const uint8_t* data, size_t data_size);
+        uint64_t
+        get_id() const;
+        uint64_t
+        get_version() const;
+        const VertexFormat&
+        get_format() const;
+        uint32_t
+        get_vertex_count() const;
+        const std::vector<Base::vec4_t>&
+        get_coords() const;
+        const std::vector<uint8_t>&
+        get_data() const;
+    };
+    // indices are stored in 16 bits when every one of them fits
+    class IndexBuffer {
+        uint64_t              m_id;
+        uint64_t              m_version = 0;
+        EPrimitiveType        m_topology;
+        EIndexType            m_type = EIndexType::UINT32;
+        uint32_t              m_count = 0;
+        std::vector<uint16_t> m_indices16;
+        std::vector<uint32_t> m_indices32;
+
+      public:
+        IndexBuffer(EPrimitiveType topology = EPrimitiveType::TRIANGLE);
+        // false and nothing changes if an index is out of [0, vertex_count), restart
+        // indices (-1) are allowed for strips and fans
+        bool
+        update(const int* indices, uint32_t count, uint32_t vertex_count);
+        uint64_t
+        get_id() const;
+        uint64_t
+        get_version() const;
+        EPrimitiveType
+        get_topology() const;
+        EIndexType
+        get_type() const;
+        uint32_t
+        get_count() const;
+        const void*
+        get_data() const;
+    };
+    GeometryView
+    get_geometry_view(const VertexBuffer& vertices, const IndexBuffer& indices);
+    // indexed triangle list with everything that depends only on its contents
+    // calculated once on creation - bounds, meshlets, triangle adjacency and an
+    // index order where consecutive triangles share edges, so the vertex reuse
+    // of the raster loop shades about one vertex per triangle
+    class Mesh {
+        VertexBuffer     m_vertices;
+        IndexBuffer      m_indices;
+        Base::Bounds     m_bounds;
+        MeshletMesh      m_meshlets;
+        int              m_max_meshlet_triangles = default_meshlet_triangles;
+        std::vector<int> m_adjacency;
+        uint64_t         m_version = 0;
+
+        friend std::shared_ptr<Mesh>
+        create_mesh(
+            const Base::vec4_t* coords, uint32_t vertex_count, const uint8_t* data, size_t data_size,
+            const VertexFormat& format, const int* indices, uint32_t index_count, int max_meshlet_triangles);
+
+      public:
+        Mesh(const VertexFormat& format);
+        // positions changed, indices are kept - bounds and meshlet volumes are recalculated
+        bool
+        update_vertices(const Base::vec4_t* coords, const uint8_t* data, size_t data_size);
+        const VertexBuffer&
+        get_vertex_buffer() const;
+        const IndexBuffer&
+        get_index_buffer() const;
+        GeometryView
+        get_geometry_view() const;
+        const Base::Bounds&
+        get_bounds() const;
+        const MeshletMesh&
+        get_meshlets() const;
+        // 3 per triangle, the triangle across edge (i, i + 1), -1 - open edge
+        const std::vector<int>&
+        get_adjacency() const;
+        uint64_t
+        get_version() const; // grows with every update of the mesh
+    };
+    // nullptr if the data does not match the format or an index is out of range
+    std::shared_ptr<Mesh>
+    create_mesh(
+        const Base::vec4_t* coords, uint32_t vertex_count, const uint8_t* data, size_t data_size,
+        const VertexFormat& format, const int* indices, uint32_t index_count,
+        int max_meshlet_triangles = default_meshlet_triangles);
+    std::vector<int>
+    calculate_triangle_adjacency(const int* indices, uint32_t index_count);
+    // greedy walk over shared edges, the triangle set and the winding stay the same
+    std::vector<int>
+    optimize_triangle_order(const int* indices, uint32_t index_count, const std::vector<int>& adjacency);
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include "base_bounds.h"
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    const int default_meshlet_triangles = 96;
+    // cluster of nearby triangles, culled as a whole before its vertices are processed
+    struct Meshlet {
+        int                  index_offset; // into MeshletMesh::indices
+        int                  triangle_count;
+        Base::BoundingSphere sphere;
+        Base::vec3_t         cone_axis;   // average of normalized cross(b - a, c - a)
+        float                cone_cutoff; // cos of the cone half angle, <= 0 - never back facing
+    };
+    // indices are reordered so that every meshlet is a contiguous range
+    struct MeshletMesh {
+        std::vector<int>     indices;
+        std::vector<Meshlet> meshlets;
+        Base::Bounds         bounds;
+    };
+    // greedy clustering over shared positions, not indices, so unwelded meshes
+    // like the ones read from obj files still get connected clusters
+    MeshletMesh
+    build_meshlets(
+        const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+        int max_triangles = default_meshlet_triangles);
+    // frustum and normal cone tests in view space, model_view should be rigid
+    // with uniform scale; culling mode is the one the triangles are drawn with
+    bool
+    is_meshlet_visible(
+        const Meshlet& meshlet, const Base::mat4_t& model_view, const Frustum& frustum, ECullingMode culling);
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "base_bounds.h"
+#include "base_matrices.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    const int occlusion_tile_width = 8;
+    const int occlusion_tile_height = 4;
+    // depth is 1/w - bigger is closer like in the color pass, 0 is infinitely far.
+    // z0 holds for every pixel of the tile, z1 only for the pixels in mask; a
+    // working layer is merged into z0 once the mask is full
+    struct OcclusionTile {
+        uint32_t mask;
+        float    z0;
+        float    z1;
+    };
+    // low resolution conservative depth in the spirit of masked occlusion culling:
+    // occluders only write coverage masks and farthest depths per tile, so an
+    // object is reported hidden only if it is behind them everywhere it covers
+    class OcclusionBuffer {
+        int                        m_width;
+        int                        m_height;
+        int                        m_tiles_x;
+        int                        m_tiles_y;
+        std::vector<OcclusionTile> m_tiles;
+        //
+        void
+        update_tile(OcclusionTile& tile, uint32_t coverage, float z);
+
+      public:
+        OcclusionBuffer(int width, int height); // rounded up to whole tiles
+        void
+        resize(int width, int height);
+        void
+        clear();
+        int
+        get_width() const;
+        int
+        get_height() const;
+        // transform maps to clip space, perspective * model view; triangles
+        // crossing the near plane are skipped, both sides are written
+        void
+        render_occluder(
+            const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const Base::mat4_t& transform);
+        bool
+        is_visible(const Base::BoundingBox& box, const Base::mat4_t& transform) const;
+        bool
+        is_visible(const Base::BoundingSphere& sphere, const Base::mat4_t& transform) const;
+    };
+} // namespace Render
+} // namespace Sisyphus
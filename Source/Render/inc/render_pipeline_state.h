@@ -0,0 +1,46 @@
+#pragma once
+
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    struct RasterState {
+        bool         depth_test = true;
+        bool         depth_write = true;
+        ECullingMode backface_culling = ECullingMode::None;
+        EBlendMode   blend = EBlendMode::Opaque;
+        bool         wireframe = false; // color and width are set on the context
+    };
+    // immutable set of shaders, vertex formats and fixed function state. The
+    // specialized raster loop is picked once here, so binding it to a context is
+    // a pointer swap and per-pixel loops do not check depth, culling or blend
+    // state. Should stay alive while bound.
+    class PipelineState {
+        VertexShaderFunc m_vsf;
+        PixelShaderFunc  m_psf;
+        VertexFormat     m_v_in_format;
+        VertexFormat     m_v_out_format;
+        RasterState      m_raster;
+        int              m_variant;
+
+      public:
+        PipelineState(
+            VertexShaderFunc vsf, PixelShaderFunc psf, const VertexFormat& v_in_format,
+            const VertexFormat& v_out_format, const RasterState& raster);
+        VertexShaderFunc
+        get_vertex_shader() const;
+        PixelShaderFunc
+        get_pixel_shader() const;
+        const VertexFormat&
+        get_vertex_input_format() const;
+        const VertexFormat&
+        get_vertex_output_format() const;
+        const RasterState&
+        get_raster_state() const;
+        int
+        get_variant() const;
+    };
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Sisyphus
+{
+namespace Render
+{
+    // counts samples that passed the depth test between Context::begin_query
+    // and Context::end_query. Owned by the caller and reused every frame; the
+    // result of the last finished query can be polled from any thread, so the
+    // frame owner never waits for a render thread to get it
+    class OcclusionQuery {
+        std::atomic<uint64_t> m_samples;
+        std::atomic<uint64_t> m_frame;
+        std::atomic<bool>     m_ready;
+
+        friend class Context;
+
+      public:
+        OcclusionQuery();
+        OcclusionQuery(const OcclusionQuery&) = delete;
+        OcclusionQuery&
+        operator=(const OcclusionQuery&) = delete;
+        // non-blocking, false until the query is finished for the first time
+        bool
+        get_result(uint64_t& samples) const;
+        uint64_t
+        get_frame() const; // presents of the context before the result was written
+        // finished with zero samples - draws conditional on the query are skipped
+        bool
+        is_hidden() const;
+        void
+        reset(); // forget the result, e.g. after a camera cut
+    };
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "render_swapchain.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    enum class EReadbackFormat {
+        BGRA8, // as stored in frames
+        RGBA8,
+        RGB8,
+        GRAY8, // luma of BT.601
+    };
+    struct ReadbackDesc {
+        ScreenRect      rect = {0, 0, 0, 0}; // empty - the whole frame
+        EReadbackFormat format = EReadbackFormat::BGRA8;
+        int             stride = 0; // bytes between destination rows, 0 - tightly packed
+        int             downscale = 1; // 1, 2 or 4 - box filter, a partial block at the right or bottom is dropped
+        int             thread_count = 1; // rows are split between threads, the calling one included
+    };
+    int
+    get_readback_pixel_size(EReadbackFormat format);
+    // destination size for a frame of width x height, false if the desc does not fit it
+    bool
+    get_readback_size(const ReadbackDesc& desc, int frame_width, int frame_height, int& width, int& height);
+    // rect of a 4 bytes per pixel frame into dst of dst_size bytes, false and nothing written on a bad desc
+    bool
+    read_frame_region(
+        const uint8_t* frame, int frame_width, int frame_height, const ReadbackDesc& desc, uint8_t* dst,
+        size_t dst_size);
+    bool
+    read_frame_region(const FrameBuffer& frame, const ReadbackDesc& desc, uint8_t* dst, size_t dst_size);
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Sisyphus
+{
+namespace Render
+{
+    struct ResolutionGovernorSettings {
+        float target_frame_ms = 16.0f;
+        float min_scale = 0.5f; // of the output size along each axis
+        float max_scale = 1.0f;
+        float scale_step = 0.0625f; // scales are multiples of it, so the context is not resized every frame
+        float headroom = 0.9f; // grows only if the time predicted for the next step is under this part of the target
+        float smoothing = 0.2f; // weight of the newest frame time in the running average
+        int   settle_frames = 4; // frames measured after a change before the next one
+        float max_lod_bias = 2.0f;
+    };
+    // keeps the frame time under a budget by the internal resolution - render
+    // into a context of get_render_size, then upscale_frame into the output.
+    // Pixel work is taken as proportional to the area, so an overrun of k
+    // shrinks both axes by sqrt(k) at once, while growth goes step by step.
+    // The context has no variable shading rate, the scale is the only knob
+    class ResolutionGovernor {
+        ResolutionGovernorSettings m_settings;
+        float                      m_scale;
+        float                      m_average_ms = 0.0f;
+        int                        m_measured_frames = 0; // since the last change
+        int64_t                    m_frame_start = 0;
+        uint64_t                   m_changes = 0;
+
+      public:
+        ResolutionGovernor(const ResolutionGovernorSettings& settings = ResolutionGovernorSettings());
+        void
+        begin_frame(); // time between begin and end is the frame time, e.g. around submit
+        void
+        end_frame();
+        void
+        add_frame_time(float ms); // for times measured by the caller
+        float
+        get_scale() const;
+        void
+        get_render_size(int output_width, int output_height, int& width, int& height) const;
+        // log2 of the scale, negative below the full resolution so textures keep
+        // the detail of the output size; not below -max_lod_bias
+        float
+        get_lod_bias() const;
+        float
+        get_average_frame_time() const;
+        uint64_t
+        get_change_count() const;
+    };
+    // bilinear resize of 8 bit per channel pixels with pixel centers aligned;
+    // rows are tightly packed. 4 bytes per pixel goes through SSE2
+    void
+    upscale_frame(
+        const uint8_t* src, int src_width, int src_height, uint8_t* dst, int dst_width, int dst_height,
+        int bytes_per_pixel);
+} // namespace Render
+} // namespace Sisyphus
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "render_frame_storage.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    enum class EFrameState {
+        Free,
+        Rendering,
+        Ready,
+        Acquired,
+    };
+    struct ScreenRect {
+        int x_min;
+        int y_min;
+        int x_max; // exclusive
+        int y_max; // exclusive
+    };
+    inline bool
+    is_rect_overlapping(const ScreenRect& a, const ScreenRect& b)
+    {
+        return a.x_min < b.x_max && b.x_min < a.x_max && a.y_min < b.y_max && b.y_min < a.y_max;
+    }
+    struct FrameBuffer {
+        FrameStorage            storage; // only color part is used, depth is shared by context
+        int                     width = 0;
+        int                     height = 0;
+        int                     bytes_per_pixel = 0;
+        uint64_t                frame_index = 0;
+        EFrameState             state = EFrameState::Free;
+        std::vector<ScreenRect> dirty_rects; // changed against the frame presented before, copy only these
+        const uint8_t*
+        get_data() const;
+        unsigned int
+        get_size() const;
+    };
+    // 2-3 color buffers owned by the renderer. The renderer draws into the back
+    // buffer and presents it, the consumer acquires the newest presented buffer and
+    // reads it in place until release, meanwhile next frames go to other buffers.
+    class Swapchain {
+      public:
+        static const int max_buffer_count = 3;
+
+      private:
+        FrameBuffer             m_buffers[max_buffer_count];
+        int                     m_buffer_count = 2;
+        FrameBuffer*            m_back = nullptr;
+        const FrameBuffer*      m_latest = nullptr;
+        uint64_t                m_frame_counter = 0;
+        std::mutex              m_mutex;
+        std::condition_variable m_released;
+        //
+        FrameBuffer*
+        find_back_buffer();
+
+      public:
+        Swapchain(int buffer_count);
+        Swapchain(const Swapchain&) = delete;
+        Swapchain&
+        operator=(const Swapchain&) = delete;
+        void
+        set_buffer_count(int buffer_count); // from 1 to max_buffer_count
+        int
+        get_buffer_count() const;
+        void
+        set_huge_pages(bool flag);
+        FrameBuffer*
+        get_back_buffer(int width, int height, int bytes_per_pixel); // waits if consumer holds every buffer
+        uint64_t
+        present(); // returns index of presented frame
+        const FrameBuffer*
+        acquire_frame(); // newest presented frame or nullptr, never blocks
+        void
+        release_frame(const FrameBuffer* frame);
+        const FrameBuffer*
+        get_latest_frame() const; // without acquiring, only for single threaded use
+        uint64_t
+        get_frame_counter() const; // frames presented so far
+    };
+} // namespace Render
+} // namespace Sisyphus
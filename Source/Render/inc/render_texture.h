@@ -9,13 +9,40 @@ namespace Sisyphus
 {
 namespace Render
 {
+    // texels live in 4x4 tiles, z-order inside a tile and tiles row by row, so that
+    // neighbours in any direction mostly share a cache line; levels are padded to whole tiles
+    const uint32_t texture_tile_size = 4;
+    uint32_t
+    get_texel_index(uint32_t x, uint32_t y, uint32_t width); // of a texel in tiled storage
+    struct TextureLevel {
+        std::vector<uint8_t> data; // tiled
+        uint32_t             width, height;
+    };
     struct Texture {
-        std::vector<uint8_t> data;
-        uint32_t             width, height, channels;
+        std::vector<uint8_t>      data; // base level, tiled on upload
+        uint32_t                  width, height, channels;
+        std::vector<TextureLevel> mips; // levels after the base one, each half of the previous down to 1x1
         Texture();
         Texture(const uint8_t* d, uint32_t w, uint32_t h, uint32_t ch);
+        void
+        generate_mips(); // 2x2 box filter
+        // row-major texels of a level, e.g. to save the texture
+        void
+        export_linear(std::vector<uint8_t>& out, uint32_t level = 0) const;
+        uint32_t
+        get_level_count() const; // base level included
+        Sisyphus::Base::vec4_t
+        get_pixel_color(float u, float v) const; // nearest texel of the base level
+        Sisyphus::Base::vec4_t
+        sample_bilinear(float u, float v, uint32_t level) const;
+        Sisyphus::Base::vec4_t
+        sample_trilinear(float u, float v, float lod) const;
+        // log2 of the texels covered by a pixel along its longer axis;
+        // gradients are du/dx, dv/dx, du/dy, dv/dy - see get_texture_gradients
+        float
+        calculate_lod(const Sisyphus::Base::vec4_t& gradients) const;
         Sisyphus::Base::vec4_t
-        get_pixel_color(float u, float v) const;
+        sample(float u, float v, const Sisyphus::Base::vec4_t& gradients, float lod_bias = 0.0f) const;
     };
 } // namespace Render
 } // namespace Sisyphus
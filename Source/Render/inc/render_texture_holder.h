@@ -20,6 +20,9 @@ namespace Render
         add_texture(const uint8_t* pixelData, uint32_t w, uint32_t h, uint32_t ch);
         Base::vec4_t
         get_pixel(uint32_t texId, float u, float v);
+        // trilinear, gradients from get_texture_gradients
+        Base::vec4_t
+        sample(uint32_t texId, float u, float v, const Base::vec4_t& gradients, float lod_bias = 0.0f);
 #if _WIN32 && !PLATFORM_XBO
         void
         save_texture(const char* path, int texId);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Render
+{
+    // everything the clipped triangles of a draw depend on
+    struct TransformCacheKey {
+        uint64_t vertex_buffer_id = 0;
+        uint64_t vertex_buffer_version = 0;
+        uint64_t index_buffer_id = 0;
+        uint64_t index_buffer_version = 0;
+        uint64_t state_hash = 0; // shader, culling, formats, frustum, builtins and descriptor set
+        bool
+        operator==(const TransformCacheKey& other) const;
+    };
+    // shaded, culled and clipped view space triangles of one static mesh, kept
+    // between frames by Context::draw_triangles_cached. While the key stays the
+    // same only rasterization runs again. Owned by the caller, one per mesh and
+    // view; not shared between threads
+    class TransformCache {
+        TransformCacheKey         m_key;
+        bool                      m_valid = false;
+        VertexFormat              m_format = VertexFormat({}); // output format the data was written with
+        std::vector<Base::vec4_t> m_coords; // 3 per triangle
+        std::vector<uint8_t>      m_data;
+        std::vector<uint32_t>     m_primitives; // source triangle of each one, for primitive ids
+        uint64_t                  m_rebuilds = 0;
+
+        friend class Context;
+
+      public:
+        void
+        invalidate(); // e.g. a vertex shader reads something outside of builtins and the descriptor set
+        bool
+        is_valid() const;
+        const TransformCacheKey&
+        get_key() const;
+        uint32_t
+        get_triangle_count() const;
+        uint64_t
+        get_rebuild_count() const; // draws that ran the vertex shader
+    };
+} // namespace Render
+} // namespace Sisyphus
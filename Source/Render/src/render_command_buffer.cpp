@@ -0,0 +1,541 @@
+#include "render_command_buffer.h"
+#include "render_culling.h"
+#include "render_occlusion.h"
+#include "render_pipeline_state.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    struct SortedDraw {
+        uint64_t                             key;
+        uint32_t                             order;
+        uint32_t                             state;
+        const Sisyphus::Render::DrawCommand* draw;
+    };
+
+    uint32_t
+    get_sortable_depth(float depth)
+    {
+        // flip float bits so that unsigned comparison gives the same order
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(float));
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+
+    bool
+    is_same_pipeline(const Sisyphus::Render::CommandState& a, const Sisyphus::Render::CommandState& b)
+    {
+        return a.vsf == b.vsf && a.psf == b.psf && a.depth_test == b.depth_test && a.depth_write == b.depth_write &&
+               a.backface_culling == b.backface_culling && a.blend == b.blend && a.wireframe == b.wireframe &&
+               a.pipeline == b.pipeline;
+    }
+
+    template <typename T>
+    T
+    read_payload(const uint8_t* payload)
+    {
+        T value;
+        memcpy(&value, payload, sizeof(T));
+        return value;
+    }
+} // namespace
+
+uint8_t*
+Sisyphus::Render::CommandBuffer::allocate_command(ECommandType type, uint32_t size)
+{
+    // keep every header 8 bytes aligned, pointers in payloads stay aligned as well
+    uint32_t      aligned_size = (size + 7) & ~7u;
+    CommandHeader header {type, aligned_size};
+    size_t        offset = m_data.size();
+    m_data.resize(offset + sizeof(CommandHeader) + aligned_size);
+    memcpy(&m_data[offset], &header, sizeof(CommandHeader));
+    m_command_count++;
+    return &m_data[offset + sizeof(CommandHeader)];
+}
+
+void
+Sisyphus::Render::CommandBuffer::reset()
+{
+    m_data.clear();
+    m_command_count = 0;
+}
+
+const uint8_t*
+Sisyphus::Render::CommandBuffer::get_data() const
+{
+    return m_data.data();
+}
+
+size_t
+Sisyphus::Render::CommandBuffer::get_size() const
+{
+    return m_data.size();
+}
+
+uint32_t
+Sisyphus::Render::CommandBuffer::get_command_count() const
+{
+    return m_command_count;
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_viewport(
+    float x_min, float y_min, float z_min, float x_max, float y_max, float z_max)
+{
+    float viewport[6] = {x_min, y_min, z_min, x_max, y_max, z_max};
+    add_command(ECommandType::SetViewport, viewport);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_descriptor_set(const std::vector<uint8_t>& descriptor_set)
+{
+    uint8_t* payload =
+        allocate_command(ECommandType::SetDescriptorSet, (uint32_t)(sizeof(uint32_t) + descriptor_set.size()));
+    uint32_t size = (uint32_t)descriptor_set.size();
+    memcpy(payload, &size, sizeof(uint32_t));
+    if (size > 0)
+    {
+        memcpy(payload + sizeof(uint32_t), descriptor_set.data(), size);
+    }
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_vertex_shader(VertexShaderFunc vsf)
+{
+    add_command(ECommandType::SetVertexShader, vsf);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_pixel_shader(PixelShaderFunc psf)
+{
+    add_command(ECommandType::SetPixelShader, psf);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_model_matrix(const Base::mat4_t& m)
+{
+    add_command(ECommandType::SetModelMatrix, m);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_view_matrix(const Base::mat4_t& m)
+{
+    add_command(ECommandType::SetViewMatrix, m);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_perspective_matrix(const Base::mat4_t& m)
+{
+    add_command(ECommandType::SetPerspectiveMatrix, m);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_perspective(float fov, float aspect, float znear, float zfar)
+{
+    // same math as Context::set_perspective, but done on the recording thread
+    PerspectiveCommand perspective;
+    fov = fov * Sisyphus::Base::pi / 180.0f;
+    perspective.matrix = Base::mat4_t::calculate_projection_matrix(fov, aspect, znear, zfar);
+    perspective.frustum = calculate_frustum(fov, aspect, znear, zfar);
+    add_command(ECommandType::SetPerspective, perspective);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_depth_test(bool flag)
+{
+    add_command(ECommandType::SetDepthTest, flag);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_depth_write(bool flag)
+{
+    add_command(ECommandType::SetDepthWrite, flag);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_backface_culling(ECullingMode mode)
+{
+    add_command(ECommandType::SetBackfaceCulling, mode);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_blend_mode(EBlendMode mode)
+{
+    add_command(ECommandType::SetBlendMode, mode);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_wireframe(bool flag, const Base::vec4_t& color, float width)
+{
+    WireframeCommand wireframe {color, width, flag};
+    add_command(ECommandType::SetWireframe, wireframe);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_pipeline_state(const PipelineState* pipeline)
+{
+    add_command(ECommandType::SetPipelineState, pipeline);
+}
+
+void
+Sisyphus::Render::CommandBuffer::set_object_id(uint32_t id)
+{
+    add_command(ECommandType::SetObjectId, id);
+}
+
+void
+Sisyphus::Render::CommandBuffer::clear_depth(float val)
+{
+    add_command(ECommandType::ClearDepth, val);
+}
+
+void
+Sisyphus::Render::CommandBuffer::fill(const col4u_t& color)
+{
+    add_command(ECommandType::Fill, color);
+}
+
+void
+Sisyphus::Render::CommandBuffer::draw_lines(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds)
+{
+    DrawCommand draw {&coords, &indices, vertex_data, &v_in_format, &v_out_format, bounds, 0.0f, false};
+    add_command(ECommandType::DrawLines, draw);
+}
+
+void
+Sisyphus::Render::CommandBuffer::draw_triangles(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds)
+{
+    DrawCommand draw {&coords, &indices, vertex_data, &v_in_format, &v_out_format, bounds, 0.0f, false};
+    add_command(ECommandType::DrawTriangles, draw);
+}
+
+void
+Sisyphus::Render::CommandBuffer::draw_triangles_sorted(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, float depth_key, const Base::Bounds* bounds)
+{
+    DrawCommand draw {&coords, &indices, vertex_data, &v_in_format, &v_out_format, bounds, depth_key, true};
+    add_command(ECommandType::DrawTriangles, draw);
+}
+
+void
+Sisyphus::Render::Context::capture_command_state(CommandState& state) const
+{
+    state.vsf = m_vsf;
+    state.psf = m_psf;
+    state.depth_test = m_depth_test;
+    state.depth_write = m_depth_write;
+    state.backface_culling = m_backface_culling;
+    state.blend = m_blend;
+    state.wireframe = m_wireframe;
+    state.wire_color = m_wire_color;
+    state.wire_width = m_wire_width;
+    state.pipeline = m_pipeline;
+    state.model_matrix = m_model_matrix;
+    state.view_matrix = m_view_matrix;
+    state.perspective_matrix = m_perspective_matrix;
+    state.frustum = m_frustum;
+    state.object_id = m_object_id;
+    state.descriptor_set = nullptr;
+    state.descriptor_set_size = 0;
+}
+
+void
+Sisyphus::Render::Context::apply_command_state(const CommandState& state, bool with_descriptor_set)
+{
+    m_vsf = state.vsf;
+    m_psf = state.psf;
+    m_depth_test = state.depth_test;
+    m_depth_write = state.depth_write;
+    m_backface_culling = state.backface_culling;
+    m_blend = state.blend;
+    m_wireframe = state.wireframe;
+    m_wire_color = state.wire_color;
+    m_wire_width = state.wire_width;
+    m_frustum = state.frustum;
+    m_model_matrix = state.model_matrix;
+    m_view_matrix = state.view_matrix;
+    m_perspective_matrix = state.perspective_matrix;
+    m_object_id = state.object_id;
+    m_pixel_object_id = state.object_id;
+    m_model_view_matrix = m_view_matrix * m_model_matrix;
+    m_transform_matrix = m_perspective_matrix * m_model_view_matrix;
+    Base::replace_data(m_builtins, m_model_matrix, 0);
+    Base::replace_data(m_builtins, m_view_matrix, sizeof(Base::mat4_t));
+    Base::replace_data(m_builtins, m_perspective_matrix, sizeof(Base::mat4_t) * 2);
+    Base::replace_data(m_builtins, m_model_view_matrix, sizeof(Base::mat4_t) * 3);
+    Base::replace_data(m_builtins, m_transform_matrix, sizeof(Base::mat4_t) * 4);
+    if (with_descriptor_set && state.descriptor_set != nullptr)
+    {
+        m_descriptor_set.assign(state.descriptor_set, state.descriptor_set + state.descriptor_set_size);
+    }
+    // fields above may have changed under a bound pipeline, so rebuild the other one lazily either way
+    this->invalidate_pipeline();
+    if (state.pipeline != nullptr)
+    {
+        this->set_pipeline_state(state.pipeline);
+    }
+}
+
+void
+Sisyphus::Render::Context::execute_draw(const DrawCommand& draw, bool triangles, bool test_bounds)
+{
+    const Base::Bounds* bounds = test_bounds ? draw.bounds : nullptr;
+    if (triangles)
+    {
+        this->draw_triangles(
+            *draw.coords, *draw.indices, draw.vertex_data, *draw.v_in_format, *draw.v_out_format, bounds);
+    }
+    else
+    {
+        this->draw_lines(
+            *draw.coords, *draw.indices, draw.vertex_data, *draw.v_in_format, *draw.v_out_format, bounds);
+    }
+}
+
+void
+Sisyphus::Render::Context::submit(const CommandBuffer& buffer, bool sort_draws)
+{
+    const CommandBuffer* buffers[] = {&buffer};
+    this->submit(buffers, 1, sort_draws);
+}
+
+void
+Sisyphus::Render::Context::submit(const CommandBuffer* const* buffers, int buffer_count, bool sort_draws)
+{
+    // state the recorded commands start from is the current context state
+    CommandState current;
+    this->capture_command_state(current);
+    std::vector<CommandState> states;    // snapshot for every state change followed by a draw
+    std::vector<uint32_t>     pipelines; // first state of every distinct pipeline, for sort keys
+    std::vector<SortedDraw>   sorted_draws;
+    bool                      sorted_bounds = false; // any sorted draw of the run has bounds
+    bool                      state_changed = true;
+    uint32_t                  applied_state = UINT32_MAX;
+    const uint8_t*            applied_descriptor_set = nullptr;
+    //
+    auto apply_state = [&](uint32_t state_idx)
+    {
+        if (state_idx != applied_state)
+        {
+            const CommandState& state = states[state_idx];
+            this->apply_command_state(state, state.descriptor_set != applied_descriptor_set);
+            applied_descriptor_set = state.descriptor_set;
+            applied_state = state_idx;
+        }
+    };
+    std::vector<const Base::Bounds*> cull_bounds_list;
+    std::vector<Base::mat4_t>        cull_model_views;
+    std::vector<uint8_t>             cull_visible;
+    auto cull_sorted_draws = [&]()
+    {
+        // one batched test per span of draws that share the frustum, invisible draws are dropped
+        size_t kept = 0;
+        size_t first = 0;
+        while (first < sorted_draws.size())
+        {
+            const Frustum& frustum = states[sorted_draws[first].state].frustum;
+            size_t         last = first;
+            cull_bounds_list.clear();
+            cull_model_views.clear();
+            while (last < sorted_draws.size() &&
+                   memcmp(&states[sorted_draws[last].state].frustum, &frustum, sizeof(Frustum)) == 0)
+            {
+                const CommandState& state = states[sorted_draws[last].state];
+                cull_bounds_list.push_back(sorted_draws[last].draw->bounds);
+                cull_model_views.push_back(state.view_matrix * state.model_matrix);
+                last++;
+            }
+            cull_visible.resize(last - first);
+            cull_bounds(
+                cull_bounds_list.data(), cull_model_views.data(), (int)(last - first), frustum, &cull_visible[0]);
+            for (size_t i = first; i < last; i++)
+            {
+                const CommandState& state = states[sorted_draws[i].state];
+                const Base::Bounds* bounds = sorted_draws[i].draw->bounds;
+                if (cull_visible[i - first] && bounds != nullptr && m_occlusion != nullptr)
+                {
+                    Base::mat4_t transform = state.perspective_matrix * cull_model_views[i - first];
+                    cull_visible[i - first] = m_occlusion->is_visible(bounds->box, transform);
+                }
+                if (cull_visible[i - first])
+                {
+                    sorted_draws[kept++] = sorted_draws[i];
+                }
+            }
+            first = last;
+        }
+        sorted_draws.resize(kept);
+    };
+    auto flush_sorted_draws = [&]()
+    {
+        if (sorted_bounds)
+        {
+            cull_sorted_draws();
+            sorted_bounds = false;
+        }
+        std::sort(
+            sorted_draws.begin(), sorted_draws.end(),
+            [](const SortedDraw& a, const SortedDraw& b)
+            {
+                return a.key != b.key ? a.key < b.key : a.order < b.order;
+            });
+        for (size_t i = 0; i < sorted_draws.size(); i++)
+        {
+            apply_state(sorted_draws[i].state);
+            this->execute_draw(*sorted_draws[i].draw, true, false);
+        }
+        sorted_draws.clear();
+    };
+    uint32_t order = 0;
+    for (int buffer_idx = 0; buffer_idx < buffer_count; buffer_idx++)
+    {
+        const uint8_t* ptr = buffers[buffer_idx]->get_data();
+        const uint8_t* end = ptr + buffers[buffer_idx]->get_size();
+        while (ptr < end)
+        {
+            CommandHeader header = read_payload<CommandHeader>(ptr);
+            const uint8_t* payload = ptr + sizeof(CommandHeader);
+            ptr = payload + header.size;
+            switch (header.type)
+            {
+            case ECommandType::SetDescriptorSet:
+                current.descriptor_set_size = read_payload<uint32_t>(payload);
+                current.descriptor_set = payload + sizeof(uint32_t);
+                state_changed = true;
+                break;
+            case ECommandType::SetVertexShader:
+                current.vsf = read_payload<VertexShaderFunc>(payload);
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            case ECommandType::SetPixelShader:
+                current.psf = read_payload<PixelShaderFunc>(payload);
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            case ECommandType::SetModelMatrix:
+                current.model_matrix = read_payload<Base::mat4_t>(payload);
+                state_changed = true;
+                break;
+            case ECommandType::SetViewMatrix:
+                current.view_matrix = read_payload<Base::mat4_t>(payload);
+                state_changed = true;
+                break;
+            case ECommandType::SetPerspectiveMatrix:
+                current.perspective_matrix = read_payload<Base::mat4_t>(payload);
+                state_changed = true;
+                break;
+            case ECommandType::SetPerspective:
+            {
+                PerspectiveCommand perspective = read_payload<PerspectiveCommand>(payload);
+                current.perspective_matrix = perspective.matrix;
+                current.frustum = perspective.frustum;
+                state_changed = true;
+                break;
+            }
+            case ECommandType::SetDepthTest:
+                current.depth_test = read_payload<bool>(payload);
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            case ECommandType::SetDepthWrite:
+                current.depth_write = read_payload<bool>(payload);
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            case ECommandType::SetBackfaceCulling:
+                current.backface_culling = read_payload<ECullingMode>(payload);
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            case ECommandType::SetBlendMode:
+                current.blend = read_payload<EBlendMode>(payload);
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            case ECommandType::SetWireframe:
+            {
+                WireframeCommand wireframe = read_payload<WireframeCommand>(payload);
+                current.wireframe = wireframe.enabled;
+                current.wire_color = wireframe.color;
+                current.wire_width = wireframe.width;
+                current.pipeline = nullptr;
+                state_changed = true;
+                break;
+            }
+            case ECommandType::SetPipelineState:
+                current.pipeline = read_payload<const PipelineState*>(payload);
+                state_changed = true;
+                break;
+            case ECommandType::SetObjectId:
+                current.object_id = read_payload<uint32_t>(payload);
+                state_changed = true;
+                break;
+            case ECommandType::SetViewport:
+            {
+                // viewport, clears and fills are barriers - sorted draws do not cross them
+                flush_sorted_draws();
+                const float* v = reinterpret_cast<const float*>(payload);
+                this->set_viewport(v[0], v[1], v[2], v[3], v[4], v[5]);
+                break;
+            }
+            case ECommandType::ClearDepth:
+                flush_sorted_draws();
+                this->clear_depth(read_payload<float>(payload));
+                break;
+            case ECommandType::Fill:
+                flush_sorted_draws();
+                this->fill(read_payload<col4u_t>(payload));
+                break;
+            case ECommandType::DrawLines:
+            case ECommandType::DrawTriangles:
+            {
+                if (state_changed)
+                {
+                    states.push_back(current);
+                    state_changed = false;
+                }
+                uint32_t           state_idx = (uint32_t)states.size() - 1;
+                const DrawCommand* draw = reinterpret_cast<const DrawCommand*>(payload);
+                if (sort_draws && draw->sorted)
+                {
+                    uint64_t pipeline_idx = 0;
+                    while (pipeline_idx < pipelines.size() &&
+                           !is_same_pipeline(states[pipelines[pipeline_idx]], current))
+                    {
+                        pipeline_idx++;
+                    }
+                    if (pipeline_idx == pipelines.size())
+                    {
+                        pipelines.push_back(state_idx);
+                    }
+                    uint64_t key = (pipeline_idx << 32) | get_sortable_depth(draw->depth_key);
+                    sorted_draws.push_back(SortedDraw {key, order++, state_idx, draw});
+                    sorted_bounds = sorted_bounds || draw->bounds != nullptr;
+                }
+                else
+                {
+                    // draws with fixed order end the sorted run as well
+                    flush_sorted_draws();
+                    apply_state(state_idx);
+                    this->execute_draw(*draw, header.type == ECommandType::DrawTriangles, true);
+                }
+                break;
+            }
+            default:
+                assert(false);
+                break;
+            }
+        }
+    }
+    flush_sorted_draws();
+    // leave the context in the state the recording ended with, a bound pipeline state included
+    this->apply_command_state(current, current.descriptor_set != applied_descriptor_set);
+}
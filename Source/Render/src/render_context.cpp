@@ -1,9 +1,17 @@
 #include "render_context.h"
+#include "render_culling.h"
+#include "render_dirty_tiles.h"
+#include "render_occlusion.h"
+#include "render_pipeline_state.h"
+#include "render_transform_cache.h"
 #include "base_utils.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <vector>
 
@@ -126,6 +134,61 @@ Sisyphus::Render::multiply_attributes(const uint8_t* a_in, uint8_t* c_out, float
     }
 }
 
+static bool
+read_instance_block(const std::vector<uint8_t>& builtins, Sisyphus::Render::InstanceBlock& block)
+{
+    if (builtins.size() < Sisyphus::Render::builtin_instance_data_offset)
+    {
+        return false;
+    }
+    memcpy(&block, builtins.data() + Sisyphus::Render::builtin_instance_offset, sizeof(block));
+    return true;
+}
+
+int
+Sisyphus::Render::get_instance_index(const std::vector<uint8_t>& builtins)
+{
+    InstanceBlock block;
+    return read_instance_block(builtins, block) ? block.instance : 0;
+}
+
+const uint8_t*
+Sisyphus::Render::get_instance_data(const std::vector<uint8_t>& builtins)
+{
+    InstanceBlock block;
+    if (!read_instance_block(builtins, block) || block.instance_data_size == 0)
+    {
+        return nullptr;
+    }
+    return builtins.data() + builtin_instance_data_offset;
+}
+
+int
+Sisyphus::Render::get_draw_index(const std::vector<uint8_t>& builtins)
+{
+    InstanceBlock block;
+    return read_instance_block(builtins, block) ? block.draw : 0;
+}
+
+const uint8_t*
+Sisyphus::Render::get_draw_constants(const std::vector<uint8_t>& builtins)
+{
+    InstanceBlock block;
+    if (!read_instance_block(builtins, block) || block.draw_data_size == 0)
+    {
+        return nullptr;
+    }
+    return builtins.data() + builtin_instance_data_offset + block.instance_data_size;
+}
+
+static thread_local Sisyphus::Base::vec4_t s_texture_gradients = {0.0f, 0.0f, 0.0f, 0.0f};
+
+const Sisyphus::Base::vec4_t&
+Sisyphus::Render::get_texture_gradients()
+{
+    return s_texture_gradients;
+}
+
 Sisyphus::Render::Plane::Plane()
     : normal(Base::vec3_t {0.0f, 0.0f, 1.0f})
     , offset(0.0f)
@@ -137,7 +200,8 @@ Sisyphus::Render::Plane::Plane(const Base::vec3_t& _normal, float _offset)
 {}
 
 Sisyphus::Render::Context::Context(int width, int height, int bytes_per_pixel)
-    : m_width(width)
+    : m_swapchain(2)
+    , m_width(width)
     , m_height(height)
     , m_bytes_per_pixel(bytes_per_pixel)
     , m_depth_write(true)
@@ -145,15 +209,18 @@ Sisyphus::Render::Context::Context(int width, int height, int bytes_per_pixel)
 {
     size_t full_size = m_width * m_height * (size_t)m_bytes_per_pixel;
     assert(full_size > 0);
-    m_data = new uint8_t[full_size];
-    m_depth = new float[m_width * m_height];
-    m_builtins.resize(sizeof(Base::mat4_t) * 5);
+    m_frame_storage.reserve(0, m_width * m_height * sizeof(float));
+    this->bind_back_buffer();
+    m_depth = m_frame_storage.get_depth();
+    m_builtins.resize(builtin_instance_offset);
+    this->reset_scissor();
 }
 
 const uint8_t*
 Sisyphus::Render::Context::get_frame() const
 {
-    return m_data;
+    const FrameBuffer* latest = m_swapchain.get_latest_frame();
+    return latest != nullptr ? latest->get_data() : m_data;
 }
 
 const unsigned int
@@ -165,38 +232,71 @@ Sisyphus::Render::Context::get_frame_size() const
 void
 Sisyphus::Render::Context::resize(int width, int height, int bytes_per_pixel)
 {
-    size_t old_resolution = m_width * m_height;
-    size_t old_size = old_resolution * (size_t)m_bytes_per_pixel;
     m_width = width;
     m_height = height;
     m_bytes_per_pixel = bytes_per_pixel;
     size_t cur_resolution = m_width * m_height;
     size_t full_size = cur_resolution * (size_t)m_bytes_per_pixel;
     assert(full_size >= 0);
-    if (full_size != old_size)
-    {
-        if (m_data != nullptr)
-        {
-            delete[] m_data;
-            m_data = nullptr;
-        }
-        if (full_size > 0)
-        {
-            m_data = new uint8_t[full_size];
-        }
-    }
-    if (cur_resolution != old_resolution)
+    // called every frame - storage keeps its capacity unless the size changes a lot
+    m_frame_storage.reserve(0, cur_resolution * sizeof(float));
+    this->bind_back_buffer();
+    m_depth = m_frame_storage.get_depth();
+    this->update_id_buffers();
+    this->reset_scissor();
+}
+
+void
+Sisyphus::Render::Context::set_huge_pages(bool flag)
+{
+    m_frame_storage.set_huge_pages(flag);
+    m_swapchain.set_huge_pages(flag);
+    this->resize(m_width, m_height, m_bytes_per_pixel);
+}
+
+void
+Sisyphus::Render::Context::set_buffer_count(int buffer_count)
+{
+    m_swapchain.set_buffer_count(buffer_count);
+}
+
+uint64_t
+Sisyphus::Render::Context::present()
+{
+    // next back buffer is taken only when something is drawn, so the consumer
+    // still has a chance to acquire the frame presented right now
+    m_data = nullptr;
+    m_frame_index++;
+    if (m_back_buffer != nullptr)
     {
-        if (m_depth != nullptr)
+        if (!m_incremental_frame)
         {
-            delete[] m_depth;
-            m_depth = nullptr;
-        }
-        if (cur_resolution > 0)
-        {
-            m_depth = new float[cur_resolution];
+            m_dirty_rects.assign(1, ScreenRect {0, 0, m_width, m_height});
         }
+        m_back_buffer->dirty_rects.swap(m_dirty_rects);
+        m_back_buffer = nullptr;
     }
+    m_incremental_frame = false;
+    return m_swapchain.present();
+}
+
+void
+Sisyphus::Render::Context::bind_back_buffer()
+{
+    m_back_buffer = m_swapchain.get_back_buffer(m_width, m_height, m_bytes_per_pixel);
+    m_data = m_back_buffer->storage.get_color();
+}
+
+const Sisyphus::Render::FrameBuffer*
+Sisyphus::Render::Context::acquire_frame()
+{
+    return m_swapchain.acquire_frame();
+}
+
+void
+Sisyphus::Render::Context::release_frame(const FrameBuffer* frame)
+{
+    m_swapchain.release_frame(frame);
 }
 
 void
@@ -221,12 +321,14 @@ void
 Sisyphus::Render::Context::set_vertex_shader(Sisyphus::Render::VertexShaderFunc vsf)
 {
     m_vsf = vsf;
+    this->invalidate_pipeline();
 }
 
 void
 Sisyphus::Render::Context::set_pixel_shader(Sisyphus::Render::PixelShaderFunc psf)
 {
     m_psf = psf;
+    this->invalidate_pipeline();
 }
 
 void
@@ -269,22 +371,23 @@ Sisyphus::Render::Context::set_perspective(float fov, float aspect, float znear,
     this->set_perspective_matrix(perspective_matrix);
 }
 
-void
-Sisyphus::Render::Context::set_frustum(float fov, float aspect, float znear, float zfar)
+Sisyphus::Render::Frustum
+Sisyphus::Render::calculate_frustum(float fov, float aspect, float znear, float zfar)
 {
+    Frustum frustum;
     // create 6 planes that forms frustum in view coordinates
     // znear plane
-    Base::vec3_t& znerNormal = m_frustum.bounds[0].normal;
+    Base::vec3_t& znerNormal = frustum.bounds[0].normal;
     znerNormal.x = 0.0f;
     znerNormal.y = 0.0f;
     znerNormal.z = -1.0f;
-    m_frustum.bounds[0].offset = znear; // depends on direction of normal
+    frustum.bounds[0].offset = znear; // depends on direction of normal
     // zfar plane
-    Base::vec3_t& zfarNormal = m_frustum.bounds[1].normal;
+    Base::vec3_t& zfarNormal = frustum.bounds[1].normal;
     zfarNormal.x = 0.0f;
     zfarNormal.y = 0.0f;
     zfarNormal.z = 1.0f;
-    m_frustum.bounds[1].offset = -zfar;
+    frustum.bounds[1].offset = -zfar;
     // points on planes - here we have world coordinates where y is going from up
     // to down
     Base::vec3_t b {0.0f, znear * tanf(0.5f * fov), znear};
@@ -292,30 +395,71 @@ Sisyphus::Render::Context::set_frustum(float fov, float aspect, float znear, flo
     Base::vec3_t t {0.0f, -b.y, znear};
     Base::vec3_t l {-r.x, 0.0f, znear};
     // top plane
-    Base::vec3_t& topNormal = m_frustum.bounds[2].normal;
+    Base::vec3_t& topNormal = frustum.bounds[2].normal;
     topNormal.x = 0.0f;
     topNormal.y = -cosf(0.5f * fov);
     topNormal.z = -sinf(0.5f * fov);
-    m_frustum.bounds[2].offset = -topNormal.calculate_dot_product(t);
+    frustum.bounds[2].offset = -topNormal.calculate_dot_product(t);
     // bottom plane
-    Base::vec3_t& bottomNormal = m_frustum.bounds[3].normal;
+    Base::vec3_t& bottomNormal = frustum.bounds[3].normal;
     bottomNormal.x = 0.0f;
     bottomNormal.y = -topNormal.y;
     bottomNormal.z = topNormal.z;
-    m_frustum.bounds[3].offset = -bottomNormal.calculate_dot_product(b);
+    frustum.bounds[3].offset = -bottomNormal.calculate_dot_product(b);
     // left plane
     float         horHalfAngle = atanf(aspect * b.y / znear);
-    Base::vec3_t& leftNormal = m_frustum.bounds[4].normal;
+    Base::vec3_t& leftNormal = frustum.bounds[4].normal;
     leftNormal.x = -cosf(horHalfAngle);
     leftNormal.y = 0.0f;
     leftNormal.z = -sinf(horHalfAngle);
-    m_frustum.bounds[4].offset = -leftNormal.calculate_dot_product(l);
+    frustum.bounds[4].offset = -leftNormal.calculate_dot_product(l);
     // right plane
-    Base::vec3_t& rightNormal = m_frustum.bounds[5].normal;
+    Base::vec3_t& rightNormal = frustum.bounds[5].normal;
     rightNormal.x = -leftNormal.x;
     rightNormal.y = 0.0f;
     rightNormal.z = leftNormal.z;
-    m_frustum.bounds[5].offset = -rightNormal.calculate_dot_product(r);
+    frustum.bounds[5].offset = -rightNormal.calculate_dot_product(r);
+    return frustum;
+}
+
+void
+Sisyphus::Render::Context::set_frustum(float fov, float aspect, float znear, float zfar)
+{
+    m_frustum = calculate_frustum(fov, aspect, znear, zfar);
+}
+
+const Sisyphus::Render::Frustum&
+Sisyphus::Render::Context::get_frustum() const
+{
+    return m_frustum;
+}
+
+const Sisyphus::Base::mat4_t&
+Sisyphus::Render::Context::get_model_view_matrix() const
+{
+    return m_model_view_matrix;
+}
+
+void
+Sisyphus::Render::Context::set_occlusion_buffer(const OcclusionBuffer* occlusion)
+{
+    m_occlusion = occlusion;
+}
+
+const Sisyphus::Render::OcclusionBuffer*
+Sisyphus::Render::Context::get_occlusion_buffer() const
+{
+    return m_occlusion;
+}
+
+bool
+Sisyphus::Render::Context::is_visible(const Base::Bounds& bounds) const
+{
+    if (!Render::is_visible(bounds, m_model_view_matrix, m_frustum))
+    {
+        return false;
+    }
+    return m_occlusion == nullptr || m_occlusion->is_visible(bounds.box, m_transform_matrix);
 }
 
 void
@@ -326,6 +470,10 @@ Sisyphus::Render::Context::put_pixel(int x, int y, const Base::vec4_t& color)
     {
         return;
     }
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
     int pixelIndex = y * m_width * m_bytes_per_pixel + x * m_bytes_per_pixel;
     // please, take care about color content in advance - clamp if needed
     m_data[pixelIndex + 0] = (uint8_t)(color.b * 255.0f);
@@ -337,13 +485,44 @@ Sisyphus::Render::Context::put_pixel(int x, int y, const Base::vec4_t& color)
 void
 Sisyphus::Render::Context::fill(const col4u_t& color)
 {
-    uint32_t colors = m_width * m_height * m_bytes_per_pixel;
-    for (uint32_t i = 0; i < colors; i += m_bytes_per_pixel)
-    { // fake m_bytes_per_pixel - now always 4 and maybe will always be 4
-        m_data[i + 0] = color.b;
-        m_data[i + 1] = color.g;
-        m_data[i + 2] = color.r;
-        m_data[i + 3] = color.a;
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    if (m_dirty_tiles != nullptr)
+    {
+        // the whole frame, like a draw covering it
+        if (m_dirty_recording)
+        {
+            uint64_t signature = Base::hash_value(Base::hash_seed, color);
+            m_dirty_tiles->add_draw(signature, ScreenRect {0, 0, m_width, m_height});
+            return;
+        }
+        m_dirty_draw++;
+    }
+    for (int y = m_scissor.y_min; y < m_scissor.y_max; y++)
+    {
+        uint8_t* row = m_data + (y * m_width + m_scissor.x_min) * m_bytes_per_pixel;
+        uint32_t colors = (m_scissor.x_max - m_scissor.x_min) * m_bytes_per_pixel;
+        for (uint32_t i = 0; i < colors; i += m_bytes_per_pixel)
+        { // fake m_bytes_per_pixel - now always 4 and maybe will always be 4
+            row[i + 0] = color.b;
+            row[i + 1] = color.g;
+            row[i + 2] = color.r;
+            row[i + 3] = color.a;
+        }
+        if (m_object_id_data != nullptr)
+        {
+            std::fill(
+                m_object_id_data + y * m_width + m_scissor.x_min, m_object_id_data + y * m_width + m_scissor.x_max,
+                0u);
+        }
+        if (m_primitive_id_data != nullptr)
+        {
+            std::fill(
+                m_primitive_id_data + y * m_width + m_scissor.x_min,
+                m_primitive_id_data + y * m_width + m_scissor.x_max, 0u);
+        }
     }
 }
 
@@ -366,45 +545,163 @@ void
 Sisyphus::Render::Context::set_depth_test(bool flag)
 {
     m_depth_test = flag;
+    this->invalidate_pipeline();
 }
 
 void
 Sisyphus::Render::Context::set_depth_write(bool flag)
 {
     m_depth_write = flag;
+    this->invalidate_pipeline();
 }
 
 void
 Sisyphus::Render::Context::set_backface_culling(ECullingMode mode)
 {
     m_backface_culling = mode;
+    this->invalidate_pipeline();
+}
+
+void
+Sisyphus::Render::Context::set_blend_mode(EBlendMode mode)
+{
+    m_blend = mode;
+    this->invalidate_pipeline();
+}
+
+void
+Sisyphus::Render::Context::set_wireframe(bool flag)
+{
+    m_wireframe = flag;
+    this->invalidate_pipeline();
+}
+
+void
+Sisyphus::Render::Context::set_wireframe_style(const Base::vec4_t& color, float width)
+{
+    m_wire_color = color;
+    m_wire_width = width;
+}
+
+void
+Sisyphus::Render::Context::set_texture_gradients(int uv_offset)
+{
+    m_texture_gradient_offset = uv_offset;
+}
+
+void
+Sisyphus::Render::Context::set_pipeline_state(const PipelineState* pipeline)
+{
+    if (pipeline == nullptr)
+    {
+        this->invalidate_pipeline();
+        return;
+    }
+    m_pipeline = pipeline;
+    this->bind_pipeline_loops(pipeline->get_variant(), pipeline->get_vertex_shader(), pipeline->get_pixel_shader());
+}
+
+const Sisyphus::Render::PipelineState*
+Sisyphus::Render::Context::get_pipeline_state() const
+{
+    return m_pipeline;
+}
+
+void
+Sisyphus::Render::Context::bind_pipeline_loops(int variant, VertexShaderFunc vsf, PixelShaderFunc psf)
+{
+    m_pipeline_variant = variant;
+    m_triangle_loop = s_triangle_loops[variant];
+    m_line_loop = s_line_loops[variant % line_pipeline_variant_count];
+    m_bound_vsf = vsf;
+    m_bound_psf = psf;
+}
+
+void
+Sisyphus::Render::Context::invalidate_pipeline()
+{
+    m_pipeline = nullptr;
+    m_legacy_pipeline_dirty = true;
+}
+
+void
+Sisyphus::Render::Context::update_pipeline()
+{
+    // state from set_* calls is resolved lazily, once per change and not per draw
+    if (m_pipeline == nullptr && m_legacy_pipeline_dirty)
+    {
+        int variant = get_pipeline_variant(m_backface_culling, m_depth_test, m_depth_write, m_blend, m_wireframe);
+        this->bind_pipeline_loops(variant, m_vsf, m_psf);
+        m_legacy_pipeline_dirty = false;
+    }
+}
+
+void
+Sisyphus::Render::Context::set_scissor(const ScreenRect& rect)
+{
+    m_scissor.x_min = std::min(std::max(rect.x_min, 0), m_width);
+    m_scissor.y_min = std::min(std::max(rect.y_min, 0), m_height);
+    m_scissor.x_max = std::min(std::max(rect.x_max, m_scissor.x_min), m_width);
+    m_scissor.y_max = std::min(std::max(rect.y_max, m_scissor.y_min), m_height);
+}
+
+void
+Sisyphus::Render::Context::reset_scissor()
+{
+    m_scissor = ScreenRect {0, 0, m_width, m_height};
+}
+
+const Sisyphus::Render::ScreenRect&
+Sisyphus::Render::Context::get_scissor() const
+{
+    return m_scissor;
 }
 
 void
 Sisyphus::Render::Context::clear_depth(float val)
 {
-    for (int i = 0; i < m_width * m_height; i++)
+    if (m_dirty_recording)
+    {
+        return;
+    }
+    for (int y = m_scissor.y_min; y < m_scissor.y_max; y++)
     {
-        m_depth[i] = val;
+        std::fill(m_depth + y * m_width + m_scissor.x_min, m_depth + y * m_width + m_scissor.x_max, val);
     }
 }
 
 void
 Sisyphus::Render::Context::render_pixel_depth_wise(const Base::vec4_t& p, const uint8_t* data)
 {
-    int pix_flat_idx = ((int)p.y) * m_width + (int)p.x;
-    if (pix_flat_idx >= 0 && pix_flat_idx < m_width * m_height)
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    int x = (int)p.x;
+    int y = (int)p.y;
+    int pix_flat_idx = y * m_width + x;
+    if (x >= m_scissor.x_min && x < m_scissor.x_max && y >= m_scissor.y_min && y < m_scissor.y_max)
     {
         if (m_depth_test)
         {
             if (p.z > m_depth[pix_flat_idx])
             {
                 this->put_pixel(p.x, p.y, this->m_psf(p, data, this->m_builtins, this->m_descriptor_set));
+                m_query_samples++;
+                if (m_object_id_data != nullptr)
+                {
+                    this->write_ids(pix_flat_idx);
+                }
             }
         }
         else
         {
+            m_query_samples++;
             this->put_pixel(p.x, p.y, this->m_psf(p, data, this->m_builtins, this->m_descriptor_set));
+            if (m_object_id_data != nullptr)
+            {
+                this->write_ids(pix_flat_idx);
+            }
         }
         if (m_depth_write)
         {
@@ -416,6 +713,79 @@ Sisyphus::Render::Context::render_pixel_depth_wise(const Base::vec4_t& p, const
     }
 }
 
+template <Sisyphus::Render::EBlendMode Blend>
+inline void
+Sisyphus::Render::Context::write_pixel(int x, int y, const Base::vec4_t& color)
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+    {
+        return;
+    }
+    uint8_t* pixel = m_data + (y * m_width + x) * m_bytes_per_pixel;
+    if (Blend == EBlendMode::Alpha)
+    {
+        float src = color.a;
+        float dst = 1.0f - src;
+        pixel[0] = (uint8_t)(color.b * 255.0f * src + pixel[0] * dst);
+        pixel[1] = (uint8_t)(color.g * 255.0f * src + pixel[1] * dst);
+        pixel[2] = (uint8_t)(color.r * 255.0f * src + pixel[2] * dst);
+        pixel[3] = (uint8_t)(color.a * 255.0f + pixel[3] * dst);
+    }
+    else
+    {
+        pixel[0] = (uint8_t)(color.b * 255.0f);
+        pixel[1] = (uint8_t)(color.g * 255.0f);
+        pixel[2] = (uint8_t)(color.r * 255.0f);
+        pixel[3] = (uint8_t)(color.a * 255.0f);
+    }
+}
+
+inline void
+Sisyphus::Render::Context::write_ids(int pix_flat_idx)
+{
+    m_object_id_data[pix_flat_idx] = m_pixel_object_id;
+    if (m_primitive_id_data != nullptr)
+    {
+        m_primitive_id_data[pix_flat_idx] = m_primitive_id;
+    }
+}
+
+template <bool DepthTest, bool DepthWrite, Sisyphus::Render::EBlendMode Blend, bool Wire>
+inline void
+Sisyphus::Render::Context::render_pixel(const Base::vec4_t& p, const uint8_t* data, float wire_distance)
+{
+    // same as render_pixel_depth_wise, but state is known at compile time
+    int x = (int)p.x;
+    int y = (int)p.y;
+    if (x < m_scissor.x_min || x >= m_scissor.x_max || y < m_scissor.y_min || y >= m_scissor.y_max)
+    {
+        return;
+    }
+    int pix_flat_idx = y * m_width + x;
+    if (!DepthTest || p.z > m_depth[pix_flat_idx])
+    {
+        Base::vec4_t color = m_bound_psf(p, data, m_builtins, m_descriptor_set);
+        if (Wire)
+        {
+            // one pixel wide antialiased falloff at the wire border
+            float k = std::min(std::max(m_wire_width * 0.5f + 0.5f - wire_distance, 0.0f), 1.0f) * m_wire_color.a;
+            color.r += (m_wire_color.r - color.r) * k;
+            color.g += (m_wire_color.g - color.g) * k;
+            color.b += (m_wire_color.b - color.b) * k;
+        }
+        this->write_pixel<Blend>(p.x, p.y, color);
+        m_query_samples++;
+        if (m_object_id_data != nullptr)
+        {
+            this->write_ids(pix_flat_idx);
+        }
+    }
+    if (DepthWrite && p.z > m_depth[pix_flat_idx])
+    {
+        m_depth[pix_flat_idx] = p.z;
+    }
+}
+
 static inline float
 get_weight_between(float x, float y, float x0, float y0, float x1, float y1)
 {
@@ -766,389 +1136,1362 @@ Sisyphus::Render::Context::cull_segment_by_frustum(
     return true;
 }
 
-void
-Sisyphus::Render::Context::draw_lines(
-    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
-    const VertexFormat& v_in_format, const VertexFormat& v_out_format)
+// primitive assembly state of one draw
+struct PrimitiveAssembly {
+    uint32_t next = 0; // index to read
+    uint32_t run = 0; // vertices since the start or the last restart
+    int      first = 0; // center of a fan
+    int      prev[2] = {0, 0}; // two last vertices of a strip, prev[1] is the latest
+};
+
+static bool
+is_triangle_topology(Sisyphus::Render::EPrimitiveType topology)
+{
+    return topology == Sisyphus::Render::EPrimitiveType::TRIANGLE ||
+           topology == Sisyphus::Render::EPrimitiveType::TRIANGLE_STRIP ||
+           topology == Sisyphus::Render::EPrimitiveType::TRIANGLE_FAN;
+}
+
+// enough indices for at least one primitive, lists should have whole primitives only
+static bool
+has_primitives(const Sisyphus::Render::GeometryView& geometry, uint32_t vertices_per_primitive)
 {
-    if (indices.size() == 0 || indices.size() % 2 != 0)
+    if (geometry.topology == Sisyphus::Render::EPrimitiveType::LINE ||
+        geometry.topology == Sisyphus::Render::EPrimitiveType::TRIANGLE)
     {
-        return;
+        return geometry.index_count > 0 && geometry.index_count % vertices_per_primitive == 0;
     }
-    for (int i = 0; i < indices.size(); i += 2)
-    {
-        const Base::vec4_t& va = coords[indices[i]];
-        const Base::vec4_t& vb = coords[indices[i + 1]];
-        const uint8_t*      data_a_ptr = &vertex_data_ptr[indices[i] * v_in_format.size];
-        const uint8_t*      data_b_ptr = &vertex_data_ptr[indices[i + 1] * v_in_format.size];
-        // draw single line here
-        Base::vec4_t         a_world, b_world;
-        std::vector<uint8_t> a_vertex_out(v_out_format.size), b_vertex_out(v_out_format.size);
-        this->m_vsf(va, a_world, a_vertex_out, data_a_ptr, this->m_builtins, this->m_descriptor_set);
-        this->m_vsf(vb, b_world, b_vertex_out, data_b_ptr, this->m_builtins, this->m_descriptor_set);
-        // frustum culling
-        // only two possible separation cases - a outside or b outside
-        // rewrite a_world, b_world, a_vertex_out, b_vertex_out
-        bool visible = this->cull_segment_by_frustum(a_world, b_world, a_vertex_out, b_vertex_out, v_out_format);
-        if (!visible)
+    return geometry.index_count >= vertices_per_primitive;
+}
+
+// ranges of one index buffer drawn one by one, like visible meshlets, number their
+// primitives as the whole buffer would; strips and fans make about one per index
+static uint32_t
+get_first_primitive(const Sisyphus::Render::GeometryView& geometry, uint32_t vertices_per_primitive)
+{
+    if (geometry.topology == Sisyphus::Render::EPrimitiveType::LINE ||
+        geometry.topology == Sisyphus::Render::EPrimitiveType::TRIANGLE)
+    {
+        return geometry.index_offset / vertices_per_primitive;
+    }
+    return geometry.index_offset;
+}
+
+// vertex_count of the view, or one past the largest index of the draw if it is not set
+static uint32_t
+get_vertex_count(const Sisyphus::Render::GeometryView& geometry)
+{
+    if (geometry.vertex_count > 0)
+    {
+        return geometry.vertex_count;
+    }
+    uint32_t vertex_count = 0;
+    for (uint32_t i = 0; i < geometry.index_count; i++)
+    {
+        uint32_t raw_index = Sisyphus::Render::get_geometry_raw_index(geometry, i);
+        if (!Sisyphus::Render::is_restart_index(geometry, raw_index))
+        {
+            vertex_count = std::max(vertex_count, (uint32_t)(raw_index + geometry.base_vertex) + 1);
+        }
+    }
+    return vertex_count;
+}
+
+// next triangle in the order of the topology, false at the end of the indices;
+// odd triangles of a strip swap their first two vertices to keep the winding
+static inline bool
+assemble_triangle(const Sisyphus::Render::GeometryView& geometry, PrimitiveAssembly& state, int triangle[3])
+{
+    if (geometry.topology == Sisyphus::Render::EPrimitiveType::TRIANGLE)
+    {
+        if (state.next + 2 >= geometry.index_count)
+        {
+            return false;
+        }
+        triangle[0] = Sisyphus::Render::get_geometry_index(geometry, state.next);
+        triangle[1] = Sisyphus::Render::get_geometry_index(geometry, state.next + 1);
+        triangle[2] = Sisyphus::Render::get_geometry_index(geometry, state.next + 2);
+        state.next += 3;
+        return true;
+    }
+    while (state.next < geometry.index_count)
+    {
+        uint32_t raw_index = Sisyphus::Render::get_geometry_raw_index(geometry, state.next++);
+        if (Sisyphus::Render::is_restart_index(geometry, raw_index))
         {
+            state.run = 0;
             continue;
         }
-        //
-        Base::vec4_t a = this->process_vertex(a_world);
-        Base::vec4_t b = this->process_vertex(b_world);
-        // obtained vertex shader results and go to the pixel stage
-        Base::vec4_t a0(a);
-        Base::vec4_t b0(b);
-        // perspective correct interpolation part - normalize by z first
-        std::vector<uint8_t> v_depthed_a(v_out_format.size), v_depthed_b(v_out_format.size);
-        uint8_t *            depthed_a_ptr = v_depthed_a.data(), *depthed_b_ptr = v_depthed_b.data();
-        multiply_attributes(a_vertex_out.data(), depthed_a_ptr, a0.w, v_out_format);
-        multiply_attributes(b_vertex_out.data(), depthed_b_ptr, b0.w, v_out_format);
-        //
-        const uint8_t *data_a0_ptr = depthed_a_ptr, *data_b0_ptr = depthed_b_ptr;
-        if (a.y > b.y)
+        int  idx = (int)raw_index + geometry.base_vertex;
+        bool ready = ++state.run >= 3;
+        if (state.run == 1)
         {
-            std::swap(a0, b0);
-            std::swap(data_a0_ptr, data_b0_ptr);
+            state.first = idx;
         }
-        // a is bottom vertex and b is top vertex
-        float y_dif = b0.y - a0.y;
-        float x_dif = b0.x - a0.x;
-        if (fabs(y_dif) < 0.001f && fabs(x_dif) < 0.001f)
+        else if (ready && geometry.topology == Sisyphus::Render::EPrimitiveType::TRIANGLE_FAN)
         {
-            // point
-            this->render_pixel_depth_wise(a0, data_a0_ptr);
+            triangle[0] = state.first;
+            triangle[1] = state.prev[1];
+            triangle[2] = idx;
         }
-        else
+        else if (ready)
         {
-            std::vector<uint8_t> pixel_out(v_out_format.size);
-            if (fabs(y_dif) > fabs(x_dif))
-            {
-                float                slope = x_dif / y_dif;
-                std::vector<uint8_t> c_out(v_out_format.size);
-                Base::vec4_t         c;
-                for (c.y = a0.y; c.y < b0.y; c.y += 1.0f)
-                {
-                    c.x = a0.x + (c.y - a0.y) * slope;
-                    float weight = (c.y - a0.y) / (b0.y - a0.y);
-                    c.w = (b0.w - a0.w) * weight + a0.w;
-                    float pzo = 1.0f / c.w;
-                    c.z = (b0.z - a0.z) * weight + a0.z;
-                    interpolate_attributes(data_a0_ptr, data_b0_ptr, c_out.data(), weight, v_out_format);
-                    multiply_attributes(c_out.data(), pixel_out.data(), pzo, v_out_format);
-                    this->render_pixel_depth_wise(c, pixel_out.data());
-                }
-            }
-            else
-            {
-                if (a0.x > b0.x)
-                {
-                    std::swap(a0, b0);
-                    std::swap(data_a0_ptr, data_b0_ptr);
-                }
-                float                slope = y_dif / x_dif;
-                std::vector<uint8_t> c_out(v_out_format.size);
-                Base::vec4_t         c;
-                for (c.x = a0.x; c.x < b0.x; c.x += 1.0f)
-                {
-                    c.y = a0.y + (c.x - a0.x) * slope;
-                    float weight = (c.x - a0.x) / (b0.x - a0.x);
-                    c.w = (b0.w - a0.w) * weight + a0.w;
-                    float pzo = 1.0f / c.w;
-                    c.z = (b0.z - a0.z) * weight + a0.z;
-                    interpolate_attributes(data_a0_ptr, data_b0_ptr, c_out.data(), weight, v_out_format);
-                    multiply_attributes(c_out.data(), pixel_out.data(), pzo, v_out_format);
-                    this->render_pixel_depth_wise(c, pixel_out.data());
-                }
-            }
+            bool odd = (state.run & 1) == 0;
+            triangle[0] = state.prev[odd ? 1 : 0];
+            triangle[1] = state.prev[odd ? 0 : 1];
+            triangle[2] = idx;
+        }
+        state.prev[0] = state.prev[1];
+        state.prev[1] = idx;
+        if (ready)
+        {
+            return true;
         }
     }
+    return false;
 }
 
-void
-Sisyphus::Render::Context::draw_triangles(
-    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
-    const VertexFormat& v_in_format, const VertexFormat& v_out_format)
+static inline bool
+assemble_segment(const Sisyphus::Render::GeometryView& geometry, PrimitiveAssembly& state, int segment[2])
 {
-    if (indices.size() == 0 || indices.size() % 3 != 0)
+    if (geometry.topology == Sisyphus::Render::EPrimitiveType::LINE)
     {
-        return;
+        if (state.next + 1 >= geometry.index_count)
+        {
+            return false;
+        }
+        segment[0] = Sisyphus::Render::get_geometry_index(geometry, state.next);
+        segment[1] = Sisyphus::Render::get_geometry_index(geometry, state.next + 1);
+        state.next += 2;
+        return true;
     }
-    int fragments = 0;
-    for (int i = 0; i < indices.size(); i += 3)
+    while (state.next < geometry.index_count)
     {
-        const Base::vec4_t& va(coords[indices[i]]);
-        const Base::vec4_t& vb(coords[indices[i + 1]]);
-        const Base::vec4_t& vc(coords[indices[i + 2]]);
-        const uint8_t*      data_a_ptr = &vertex_data_ptr[indices[i] * v_in_format.size];
-        const uint8_t*      data_b_ptr = &vertex_data_ptr[indices[i + 1] * v_in_format.size];
-        const uint8_t*      data_c_ptr = &vertex_data_ptr[indices[i + 2] * v_in_format.size];
-        //
-        Base::vec4_t         a_world, b_world, c_world;
-        std::vector<uint8_t> a_vertex_out(v_out_format.size), b_vertex_out(v_out_format.size),
-            c_vertex_out(v_out_format.size);
-        // obtain output coordinates in view space and output vertex attributes
-        this->m_vsf(va, a_world, a_vertex_out, data_a_ptr, this->m_builtins, this->m_descriptor_set);
-        this->m_vsf(vb, b_world, b_vertex_out, data_b_ptr, this->m_builtins, this->m_descriptor_set);
-        this->m_vsf(vc, c_world, c_vertex_out, data_c_ptr, this->m_builtins, this->m_descriptor_set);
-
-        // backface culling
-        if (m_backface_culling != ECullingMode::None)
+        uint32_t raw_index = Sisyphus::Render::get_geometry_raw_index(geometry, state.next++);
+        if (Sisyphus::Render::is_restart_index(geometry, raw_index))
         {
-            Sisyphus::Base::vec4_t side0, side1, outside_normal;
-            switch (m_backface_culling)
-            {
-            case ECullingMode::ClockWise:
-                side0 = c_world - a_world;
-                side1 = b_world - c_world;
-                outside_normal = side0.calculate_cross_product(side1);
-                break;
-            case ECullingMode::CounterClockWise:
-            default:
-                side0 = b_world - a_world;
-                side1 = c_world - b_world;
-                outside_normal = side0.calculate_cross_product(side1);
-                break;
-            }
-            Base::vec4_t z = a_world + b_world + c_world;
-            float        zlength = a_world.calculate_magnitude();
-            if (zlength < Sisyphus::Base::eps)
+            state.run = 0;
+            continue;
+        }
+        int idx = (int)raw_index + geometry.base_vertex;
+        segment[0] = state.prev[1];
+        segment[1] = idx;
+        state.prev[1] = idx;
+        if (++state.run >= 2)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// list segments own both ends, a strip segment owns its last pixel only at the end of the run
+static inline bool
+is_segment_end_owned(const Sisyphus::Render::GeometryView& geometry, const PrimitiveAssembly& state)
+{
+    return geometry.topology == Sisyphus::Render::EPrimitiveType::LINE || state.next >= geometry.index_count ||
+           Sisyphus::Render::is_restart_index(
+               geometry, Sisyphus::Render::get_geometry_raw_index(geometry, state.next));
+}
+
+static bool
+is_float_format(const Sisyphus::Render::VertexFormat& vf)
+{
+    for (size_t i = 0; i < vf.attributes.size(); i++)
+    {
+        if (vf.attributes[i] == Sisyphus::Render::EVertexAttribType::INT32 ||
+            vf.attributes[i] == Sisyphus::Render::EVertexAttribType::UINT8)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline uint32_t
+get_outcode(const Sisyphus::Base::vec3_t& p, const Sisyphus::Render::Frustum& frustum)
+{
+    uint32_t code = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        if (point_plane_side(p, frustum.bounds[i]) > 0.0f)
+        {
+            code |= 1 << i;
+        }
+    }
+    return code;
+}
+
+template <bool DepthTest, bool DepthWrite, Sisyphus::Render::EBlendMode Blend>
+void
+Sisyphus::Render::Context::rasterize_line(
+    const Base::vec4_t& a_visible, const Base::vec4_t& b_visible, const uint8_t* a_data, const uint8_t* b_data,
+    const VertexFormat& v_out_format, bool float_format, bool last_pixel)
+{
+    Base::vec4_t a = this->process_vertex(a_visible);
+    Base::vec4_t b = this->process_vertex(b_visible);
+    int          x = (int)a.x;
+    int          y = (int)a.y;
+    int          dx = abs((int)b.x - x);
+    int          dy = abs((int)b.y - y);
+    int          sx = (int)b.x > x ? 1 : -1;
+    int          sy = (int)b.y > y ? 1 : -1;
+    int          steps = std::max(dx, dy);
+    if (std::max(x, (int)b.x) < m_scissor.x_min || std::min(x, (int)b.x) >= m_scissor.x_max ||
+        std::max(y, (int)b.y) < m_scissor.y_min || std::min(y, (int)b.y) >= m_scissor.y_max)
+    {
+        return;
+    }
+    if (steps == 0)
+    {
+        this->render_pixel<DepthTest, DepthWrite, Blend>(a, a_data);
+        return;
+    }
+    // perspective correct interpolation - step attributes multiplied by 1/w and divide back per pixel
+    const size_t vsize = v_out_format.size;
+    uint8_t*     depthed_a = m_line_scratch.data() + vsize * 2;
+    uint8_t*     depthed_b = depthed_a + vsize;
+    uint8_t*     current = depthed_b + vsize;
+    uint8_t*     gradient = current + vsize;
+    uint8_t*     pixel = gradient + vsize;
+    multiply_attributes(a_data, depthed_a, a.w, v_out_format);
+    multiply_attributes(b_data, depthed_b, b.w, v_out_format);
+    float     step = 1.0f / steps;
+    float     dz = (b.z - a.z) * step;
+    float     dw = (b.w - a.w) * step;
+    const int float_count = (int)(vsize / sizeof(float));
+    float*    current_floats = reinterpret_cast<float*>(current);
+    float*    gradient_floats = reinterpret_cast<float*>(gradient);
+    float*    pixel_floats = reinterpret_cast<float*>(pixel);
+    if (float_format)
+    {
+        const float* a_floats = reinterpret_cast<const float*>(depthed_a);
+        const float* b_floats = reinterpret_cast<const float*>(depthed_b);
+        for (int k = 0; k < float_count; k++)
+        {
+            current_floats[k] = a_floats[k];
+            gradient_floats[k] = (b_floats[k] - a_floats[k]) * step;
+        }
+    }
+    // bresenham, without the last pixel it belongs to the next segment of a strip
+    Base::vec4_t c {0.0f, 0.0f, a.z, a.w};
+    int          err = dx - dy;
+    int          pixels = last_pixel ? steps + 1 : steps;
+    for (int i = 0; i < pixels; i++)
+    {
+        c.x = (float)x;
+        c.y = (float)y;
+        float pzo = 1.0f / c.w;
+        if (float_format)
+        {
+            for (int k = 0; k < float_count; k++)
             {
-                continue;
+                pixel_floats[k] = current_floats[k] * pzo;
+                current_floats[k] += gradient_floats[k];
             }
-            z = z * (1.0f / zlength);
-            Base::vec3_t n {outside_normal.x, outside_normal.y, outside_normal.z};
-            n = n.calculate_normalized();
-            if (z.xyz.calculate_dot_product(n) > 0.0f)
+        }
+        else
+        {
+            interpolate_attributes(depthed_a, depthed_b, current, i * step, v_out_format);
+            multiply_attributes(current, pixel, pzo, v_out_format);
+        }
+        this->render_pixel<DepthTest, DepthWrite, Blend>(c, pixel);
+        c.z += dz;
+        c.w += dw;
+        int e2 = err * 2;
+        if (e2 > -dy)
+        {
+            err -= dy;
+            x += sx;
+        }
+        if (e2 < dx)
+        {
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+template <bool DepthTest, bool DepthWrite, Sisyphus::Render::EBlendMode Blend>
+void
+Sisyphus::Render::Context::draw_lines_loop(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format)
+{
+    const size_t   vsize = v_out_format.size;
+    const bool     float_format = is_float_format(v_out_format);
+    const uint32_t vertex_count = get_vertex_count(geometry);
+    // scratch only grows, nothing is allocated per segment
+    if (m_line_vertex_stamps.size() < vertex_count)
+    {
+        m_line_vertex_stamps.resize(vertex_count, 0);
+        m_line_vertices.resize(vertex_count);
+    }
+    if (m_line_vertex_data.size() < vertex_count * vsize)
+    {
+        m_line_vertex_data.resize(vertex_count * vsize);
+    }
+    if (m_line_scratch.size() < vsize * 7)
+    {
+        m_line_scratch.resize(vsize * 7);
+    }
+    m_vertex_out.resize(vsize);
+    if (++m_line_stamp == 0)
+    {
+        std::fill(m_line_vertex_stamps.begin(), m_line_vertex_stamps.end(), 0);
+        m_line_stamp = 1;
+    }
+    uint8_t* a_clipped = m_line_scratch.data();
+    uint8_t* b_clipped = a_clipped + vsize;
+    PrimitiveAssembly assembly;
+    int               segment[2];
+    uint32_t          primitive = get_first_primitive(geometry, 2);
+    while (assemble_segment(geometry, assembly, segment))
+    {
+        m_primitive_id = primitive++;
+        bool last_pixel = is_segment_end_owned(geometry, assembly);
+        // vertex stage - shared vertices are shaded once per call
+        for (int j = 0; j < 2; j++)
+        {
+            int idx = segment[j];
+            if (m_line_vertex_stamps[idx] != m_line_stamp)
             {
-                continue;
+                m_bound_vsf(
+                    geometry.coords[idx], m_line_vertices[idx], m_vertex_out,
+                    &geometry.vertex_data[idx * v_in_format.size], m_builtins, m_descriptor_set);
+                memcpy(&m_line_vertex_data[idx * vsize], m_vertex_out.data(), vsize);
+                m_line_vertex_stamps[idx] = m_line_stamp;
             }
         }
-        // frustum culling
-        std::vector<uint8_t>      view_passed_vertex_data = {};
-        std::vector<Base::vec4_t> view_passed_vertex_coords = {};
-        this->cull_triangle_by_frustum(
-            a_world, b_world, c_world, a_vertex_out.data(), b_vertex_out.data(), c_vertex_out.data(), v_out_format,
-            view_passed_vertex_coords, view_passed_vertex_data);
-        // rasterization
-        for (int j = 0; j < view_passed_vertex_coords.size(); j += 3)
+        const Base::vec4_t& a_world = m_line_vertices[segment[0]];
+        const Base::vec4_t& b_world = m_line_vertices[segment[1]];
+        const uint8_t*      a_data = &m_line_vertex_data[segment[0] * vsize];
+        const uint8_t*      b_data = &m_line_vertex_data[segment[1] * vsize];
+        // outcode clipping against the frustum planes
+        uint32_t a_code = get_outcode(a_world.xyz, m_frustum);
+        uint32_t b_code = get_outcode(b_world.xyz, m_frustum);
+        if ((a_code & b_code) != 0)
         {
-            const Base::vec4_t& a_visible(view_passed_vertex_coords[j]);
-            const Base::vec4_t& b_visible(view_passed_vertex_coords[j + 1]);
-            const Base::vec4_t& c_visible(view_passed_vertex_coords[j + 2]);
-            //
-            uint8_t* vertex_out_a_ptr = &view_passed_vertex_data[j * v_out_format.size];
-            uint8_t* vertex_out_b_ptr = &view_passed_vertex_data[(j + 1) * v_out_format.size];
-            uint8_t* vertex_out_c_ptr = &view_passed_vertex_data[(j + 2) * v_out_format.size];
-            //
-            Base::vec4_t a, b, c;
-            a = this->process_vertex(a_visible);
-            b = this->process_vertex(b_visible);
-            c = this->process_vertex(c_visible);
-            //
-            Base::vec4_t sa = a, sb = b, sc = c;
-            if (sa.y > sc.y)
+            continue;
+        }
+        if ((a_code | b_code) == 0)
+        {
+            this->rasterize_line<DepthTest, DepthWrite, Blend>(
+                a_world, b_world, a_data, b_data, v_out_format, float_format, last_pixel);
+            continue;
+        }
+        float t0 = 0.0f;
+        float t1 = 1.0f;
+        for (int j = 0; j < 6 && t0 <= t1; j++)
+        {
+            if (((a_code | b_code) & (1 << j)) == 0)
             {
-                std::swap(sa, sc);
-                std::swap(vertex_out_a_ptr, vertex_out_c_ptr);
+                continue;
             }
-            if (sa.y > sb.y)
+            float a_side = point_plane_side(a_world.xyz, m_frustum.bounds[j]);
+            float b_side = point_plane_side(b_world.xyz, m_frustum.bounds[j]);
+            float t = a_side / (a_side - b_side);
+            if (a_side > 0.0f)
             {
-                std::swap(sa, sb);
-                std::swap(vertex_out_a_ptr, vertex_out_b_ptr);
+                t0 = std::max(t0, t);
             }
-            if (sb.y > sc.y)
+            else
             {
-                std::swap(sb, sc);
-                std::swap(vertex_out_b_ptr, vertex_out_c_ptr);
+                t1 = std::min(t1, t);
             }
-            // get interpolated values - line coordinates, only one component
-            std::vector<float> xab = Base::interpolate(sa.y, sa.x, sb.y, sb.x);
-            std::vector<float> xbc = Base::interpolate(sb.y, sb.x, sc.y, sc.x);
-            std::vector<float> xac = Base::interpolate(sa.y, sa.x, sc.y, sc.x); // long side x
-            int                nzeros = (int)(xab.size() == 0) + (int)(xbc.size() == 0) + (int)(xac.size() == 0);
-            if (nzeros > 1)
+        }
+        if (t0 >= t1)
+        {
+            continue;
+        }
+        Base::vec4_t ab = b_world - a_world;
+        Base::vec4_t a_visible = a_world + ab * t0;
+        Base::vec4_t b_visible = a_world + ab * t1;
+        interpolate_attributes(a_data, b_data, a_clipped, t0, v_out_format);
+        interpolate_attributes(a_data, b_data, b_clipped, t1, v_out_format);
+        // a clipped end is not shared with the next segment
+        this->rasterize_line<DepthTest, DepthWrite, Blend>(
+            a_visible, b_visible, a_clipped, b_clipped, v_out_format, float_format, last_pixel || t1 < 1.0f);
+    }
+}
+
+template <Sisyphus::Render::ECullingMode Cull>
+static inline bool
+is_culled_triangle(
+    const Sisyphus::Base::vec4_t& a_world, const Sisyphus::Base::vec4_t& b_world,
+    const Sisyphus::Base::vec4_t& c_world)
+{
+    if (Cull == Sisyphus::Render::ECullingMode::None)
+    {
+        return false;
+    }
+    Sisyphus::Base::vec4_t side0, side1, outside_normal;
+    if (Cull == Sisyphus::Render::ECullingMode::ClockWise)
+    {
+        side0 = c_world - a_world;
+        side1 = b_world - c_world;
+    }
+    else
+    {
+        side0 = b_world - a_world;
+        side1 = c_world - b_world;
+    }
+    outside_normal = side0.calculate_cross_product(side1);
+    Sisyphus::Base::vec4_t z = a_world + b_world + c_world;
+    float                  zlength = a_world.calculate_magnitude();
+    if (zlength < Sisyphus::Base::eps)
+    {
+        return true;
+    }
+    z = z * (1.0f / zlength);
+    Sisyphus::Base::vec3_t n {outside_normal.x, outside_normal.y, outside_normal.z};
+    n = n.calculate_normalized();
+    return z.xyz.calculate_dot_product(n) > 0.0f;
+}
+
+struct WireEdges {
+    float a[3], b[3], c[3]; // per edge a * x + b * y + c is the distance in pixels
+};
+
+static WireEdges
+calculate_wire_edges(
+    const Sisyphus::Base::vec4_t& sa, const Sisyphus::Base::vec4_t& sb, const Sisyphus::Base::vec4_t& sc,
+    const float* a_bary, const float* b_bary, const float* c_bary)
+{
+    // every barycentric is an affine function on screen, its zero line is the
+    // original edge even if the triangle was cut by the frustum
+    WireEdges edges;
+    float     abx = sb.x - sa.x, aby = sb.y - sa.y;
+    float     acx = sc.x - sa.x, acy = sc.y - sa.y;
+    float     det = abx * acy - acx * aby;
+    for (int i = 0; i < 3; i++)
+    {
+        edges.a[i] = 0.0f;
+        edges.b[i] = 0.0f;
+        edges.c[i] = FLT_MAX;
+        if (fabs(det) < Sisyphus::Base::eps)
+        {
+            continue;
+        }
+        float db = b_bary[i] - a_bary[i];
+        float dc = c_bary[i] - a_bary[i];
+        float ga = (db * acy - dc * aby) / det;
+        float gb = (dc * abx - db * acx) / det;
+        float length = sqrtf(ga * ga + gb * gb);
+        if (length < Sisyphus::Base::eps)
+        {
+            continue;
+        }
+        edges.a[i] = ga / length;
+        edges.b[i] = gb / length;
+        edges.c[i] = (a_bary[i] - ga * sa.x - gb * sa.y) / length;
+    }
+    return edges;
+}
+
+static inline float
+get_wire_distance(const WireEdges& edges, float x, float y)
+{
+    float d0 = edges.a[0] * x + edges.b[0] * y + edges.c[0];
+    float d1 = edges.a[1] * x + edges.b[1] * y + edges.c[1];
+    float d2 = edges.a[2] * x + edges.b[2] * y + edges.c[2];
+    return std::min(d0, std::min(d1, d2));
+}
+
+struct UvGradients {
+    float ux, uy, vx, vy, wx, wy; // screen gradients of u * w, v * w and w
+};
+
+static inline void
+get_plane_gradient(
+    const Sisyphus::Base::vec4_t& sa, const Sisyphus::Base::vec4_t& sb, const Sisyphus::Base::vec4_t& sc, float a,
+    float b, float c, float& gx, float& gy)
+{
+    float abx = sb.x - sa.x, aby = sb.y - sa.y;
+    float acx = sc.x - sa.x, acy = sc.y - sa.y;
+    float det = abx * acy - acx * aby;
+    if (fabs(det) < Sisyphus::Base::eps)
+    {
+        gx = 0.0f;
+        gy = 0.0f;
+        return;
+    }
+    gx = ((b - a) * acy - (c - a) * aby) / det;
+    gy = ((c - a) * abx - (b - a) * acx) / det;
+}
+
+static UvGradients
+calculate_uv_gradients(
+    const Sisyphus::Base::vec4_t& sa, const Sisyphus::Base::vec4_t& sb, const Sisyphus::Base::vec4_t& sc,
+    const float* a_uv, const float* b_uv, const float* c_uv)
+{
+    // attributes multiplied by w are affine on screen, as well as w
+    UvGradients gradients;
+    get_plane_gradient(sa, sb, sc, a_uv[0], b_uv[0], c_uv[0], gradients.ux, gradients.uy);
+    get_plane_gradient(sa, sb, sc, a_uv[1], b_uv[1], c_uv[1], gradients.vx, gradients.vy);
+    get_plane_gradient(sa, sb, sc, sa.w, sb.w, sc.w, gradients.wx, gradients.wy);
+    return gradients;
+}
+
+static inline void
+store_texture_gradients(const UvGradients& gradients, const uint8_t* uv_data, float w)
+{
+    // d(f / w) = (df - f / w * dw) / w
+    const float* uv = reinterpret_cast<const float*>(uv_data);
+    float        w_inv = 1.0f / w;
+    s_texture_gradients.x = (gradients.ux - uv[0] * gradients.wx) * w_inv;
+    s_texture_gradients.y = (gradients.vx - uv[1] * gradients.wx) * w_inv;
+    s_texture_gradients.z = (gradients.uy - uv[0] * gradients.wy) * w_inv;
+    s_texture_gradients.w = (gradients.vy - uv[1] * gradients.wy) * w_inv;
+}
+
+template <bool DepthTest, bool DepthWrite, Sisyphus::Render::EBlendMode Blend, bool Wire>
+bool
+Sisyphus::Render::Context::rasterize_triangle(
+    const Base::vec4_t& a_visible, const Base::vec4_t& b_visible, const Base::vec4_t& c_visible,
+    uint8_t* vertex_out_a_ptr, uint8_t* vertex_out_b_ptr, uint8_t* vertex_out_c_ptr, const VertexFormat& v_out_format)
+{
+    // scanline rasterization of a clipped triangle, false if it degenerates
+    Base::vec4_t a, b, c;
+    a = this->process_vertex(a_visible);
+    b = this->process_vertex(b_visible);
+    c = this->process_vertex(c_visible);
+    //
+    Base::vec4_t sa = a, sb = b, sc = c;
+    if (sa.y > sc.y)
+    {
+        std::swap(sa, sc);
+        std::swap(vertex_out_a_ptr, vertex_out_c_ptr);
+    }
+    if (sa.y > sb.y)
+    {
+        std::swap(sa, sb);
+        std::swap(vertex_out_a_ptr, vertex_out_b_ptr);
+    }
+    if (sb.y > sc.y)
+    {
+        std::swap(sb, sc);
+        std::swap(vertex_out_b_ptr, vertex_out_c_ptr);
+    }
+    // nothing to do outside of the scissor, rows above and below it are skipped as well
+    if ((int)sc.y < m_scissor.y_min || (int)sa.y >= m_scissor.y_max ||
+        (int)std::max(sa.x, std::max(sb.x, sc.x)) < m_scissor.x_min ||
+        (int)std::min(sa.x, std::min(sb.x, sc.x)) >= m_scissor.x_max)
+    {
+        return true;
+    }
+    // distances in pixels to the edges of the original triangle
+    WireEdges wire;
+    if (Wire)
+    {
+        size_t barycentric_offset = v_out_format.size - sizeof(Base::vec3_t);
+        wire = calculate_wire_edges(
+            sa, sb, sc, reinterpret_cast<const float*>(vertex_out_a_ptr + barycentric_offset),
+            reinterpret_cast<const float*>(vertex_out_b_ptr + barycentric_offset),
+            reinterpret_cast<const float*>(vertex_out_c_ptr + barycentric_offset));
+    }
+    // get interpolated values - line coordinates, only one component
+    std::vector<float> xab = Base::interpolate(sa.y, sa.x, sb.y, sb.x);
+    std::vector<float> xbc = Base::interpolate(sb.y, sb.x, sc.y, sc.x);
+    std::vector<float> xac = Base::interpolate(sa.y, sa.x, sc.y, sc.x); // long side x
+    int                nzeros = (int)(xab.size() == 0) + (int)(xbc.size() == 0) + (int)(xac.size() == 0);
+    if (nzeros > 1)
+    {
+        return false;
+    }
+    // here is the diffrence - we don't want to merge xab and xbc
+    size_t n = std::min(xac.size(), xab.size() + xbc.size());
+    size_t middle = n / 2;
+    bool   leftToRight = true;
+    if (middle >= xab.size())
+    {
+        if (xac[middle] < xbc[middle - xab.size()])
+        {
+            leftToRight = false;
+        }
+    }
+    else
+    {
+        if (xac[middle] < xab[middle])
+        {
+            leftToRight = false;
+        }
+    }
+    float                bottomy = sa.y;
+    size_t               idx = 0;
+    std::vector<uint8_t> v_interpolated_ac(v_out_format.size), v_interpolated_ab(v_out_format.size),
+        v_interpolated_bc(v_out_format.size), v_interpolated_lr(v_out_format.size);
+    std::vector<uint8_t> v_depthed_a(v_out_format.size), v_depthed_b(v_out_format.size),
+        v_depthed_c(v_out_format.size), v_depthed_p(v_out_format.size);
+    // divide attributes by original z - lesser attributes, that are located
+    // further
+    multiply_attributes(vertex_out_a_ptr, v_depthed_a.data(), sa.w, v_out_format);
+    multiply_attributes(vertex_out_b_ptr, v_depthed_b.data(), sb.w, v_out_format);
+    multiply_attributes(vertex_out_c_ptr, v_depthed_c.data(), sc.w, v_out_format);
+    UvGradients uv_gradients = {};
+    if (m_texture_gradient_offset >= 0)
+    {
+        uv_gradients = calculate_uv_gradients(
+            sa, sb, sc, reinterpret_cast<const float*>(v_depthed_a.data() + m_texture_gradient_offset),
+            reinterpret_cast<const float*>(v_depthed_b.data() + m_texture_gradient_offset),
+            reinterpret_cast<const float*>(v_depthed_c.data() + m_texture_gradient_offset));
+    }
+    //
+    if (leftToRight)
+    {
+        Base::vec4_t c;
+        for (idx = 0; idx < xab.size() % (n + 1); idx++)
+        {
+            if ((int)bottomy < m_scissor.y_min || (int)bottomy >= m_scissor.y_max)
             {
-                return;
+                bottomy += 1.0f;
+                continue;
             }
-            // here is the diffrence - we don't want to merge xab and xbc
-            int  n = std::min(xac.size(), xab.size() + xbc.size());
-            int  middle = n / 2;
-            bool leftToRight = true;
-            if (middle >= xab.size())
+            float leftx = xab[idx];
+            float rightx = xac[idx];
+            float v_weight_ab = get_weight_between(leftx, bottomy, sa.x, sa.y, sb.x, sb.y);
+            float v_weight_ac = get_weight_between(rightx, bottomy, sa.x, sa.y, sc.x, sc.y);
+            interpolate_attributes(
+                v_depthed_a.data(), v_depthed_b.data(), v_interpolated_ab.data(), v_weight_ab, v_out_format);
+            interpolate_attributes(
+                v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
+            float lz = sa.z + (sb.z - sa.z) * v_weight_ab;
+            float rz = sa.z + (sc.z - sa.z) * v_weight_ac;
+            float lwo = sa.w + (sb.w - sa.w) * v_weight_ab;
+            float rwo = sa.w + (sc.w - sa.w) * v_weight_ac;
+            while (leftx < rightx)
             {
-                if (xac[middle] < xbc[middle - xab.size()])
+                float h_weight = (leftx - xab[idx]) / (xac[idx] - xab[idx]);
+                interpolate_attributes(
+                    v_interpolated_ab.data(), v_interpolated_ac.data(), v_interpolated_lr.data(), h_weight,
+                    v_out_format);
+                c.x = leftx;
+                c.y = bottomy;
+                c.z = lz + (rz - lz) * h_weight;
+                float pwo = lwo + (rwo - lwo) * h_weight;
+                float pzo = 1.0f / pwo;
+                c.w = pwo;
+                multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
+                if (m_texture_gradient_offset >= 0)
                 {
-                    leftToRight = false;
+                    store_texture_gradients(uv_gradients, v_depthed_p.data() + m_texture_gradient_offset, pwo);
                 }
+                this->render_pixel<DepthTest, DepthWrite, Blend, Wire>(
+                    c, v_depthed_p.data(), Wire ? get_wire_distance(wire, c.x, c.y) : 0.0f);
+                leftx += 1.0f;
             }
-            else
+            bottomy += 1.0f;
+        }
+        for (; idx < n; idx++)
+        {
+            if ((int)bottomy < m_scissor.y_min || (int)bottomy >= m_scissor.y_max)
             {
-                if (xac[middle] < xab[middle])
-                {
-                    leftToRight = false;
-                }
+                bottomy += 1.0f;
+                continue;
             }
-            float                bottomy = sa.y;
-            int                  idx = 0;
-            std::vector<uint8_t> v_interpolated_ac(v_out_format.size), v_interpolated_ab(v_out_format.size),
-                v_interpolated_bc(v_out_format.size), v_interpolated_lr(v_out_format.size);
-            std::vector<uint8_t> v_depthed_a(v_out_format.size), v_depthed_b(v_out_format.size),
-                v_depthed_c(v_out_format.size), v_depthed_p(v_out_format.size);
-            // divide attributes by original z - lesser attributes, that are located
-            // further
-            multiply_attributes(vertex_out_a_ptr, v_depthed_a.data(), sa.w, v_out_format);
-            multiply_attributes(vertex_out_b_ptr, v_depthed_b.data(), sb.w, v_out_format);
-            multiply_attributes(vertex_out_c_ptr, v_depthed_c.data(), sc.w, v_out_format);
-            //
-            if (leftToRight)
+            float leftx = xbc[idx - xab.size()];
+            float rightx = xac[idx];
+            float v_weight_bc = get_weight_between(leftx, bottomy, sb.x, sb.y, sc.x, sc.y);
+            float v_weight_ac = get_weight_between(rightx, bottomy, sa.x, sa.y, sc.x, sc.y);
+            interpolate_attributes(
+                v_depthed_b.data(), v_depthed_c.data(), v_interpolated_bc.data(), v_weight_bc, v_out_format);
+            interpolate_attributes(
+                v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
+            float lz = sb.z + (sc.z - sb.z) * v_weight_bc;
+            float rz = sa.z + (sc.z - sa.z) * v_weight_ac;
+            float lwo = sb.w + (sc.w - sb.w) * v_weight_bc;
+            float rwo = sa.w + (sc.w - sa.w) * v_weight_ac;
+            while (leftx < rightx)
             {
-                Base::vec4_t c;
-                for (idx = 0; idx < xab.size() % (n + 1); idx++)
+                float h_weight = (leftx - xbc[idx - xab.size()]) / (xac[idx] - xbc[idx - xab.size()]);
+                interpolate_attributes(
+                    v_interpolated_bc.data(), v_interpolated_ac.data(), v_interpolated_lr.data(), h_weight,
+                    v_out_format);
+                c.x = leftx;
+                c.y = bottomy;
+                c.z = lz + (rz - lz) * h_weight;
+                float pwo = lwo + (rwo - lwo) * h_weight;
+                float pzo = 1.0f / pwo;
+                c.w = pwo;
+                multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
+                if (m_texture_gradient_offset >= 0)
                 {
-                    float leftx = xab[idx];
-                    float rightx = xac[idx];
-                    float v_weight_ab = get_weight_between(leftx, bottomy, sa.x, sa.y, sb.x, sb.y);
-                    float v_weight_ac = get_weight_between(rightx, bottomy, sa.x, sa.y, sc.x, sc.y);
-                    interpolate_attributes(
-                        v_depthed_a.data(), v_depthed_b.data(), v_interpolated_ab.data(), v_weight_ab, v_out_format);
-                    interpolate_attributes(
-                        v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
-                    float lz = sa.z + (sb.z - sa.z) * v_weight_ab;
-                    float rz = sa.z + (sc.z - sa.z) * v_weight_ac;
-                    float lwo = sa.w + (sb.w - sa.w) * v_weight_ab;
-                    float rwo = sa.w + (sc.w - sa.w) * v_weight_ac;
-                    while (leftx < rightx)
-                    {
-                        float h_weight = (leftx - xab[idx]) / (xac[idx] - xab[idx]);
-                        interpolate_attributes(
-                            v_interpolated_ab.data(), v_interpolated_ac.data(), v_interpolated_lr.data(), h_weight,
-                            v_out_format);
-                        c.x = leftx;
-                        c.y = bottomy;
-                        c.z = lz + (rz - lz) * h_weight;
-                        float pwo = lwo + (rwo - lwo) * h_weight;
-                        float pzo = 1.0f / pwo;
-                        c.w = pwo;
-                        multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
-                        this->render_pixel_depth_wise(c, v_depthed_p.data());
-                        leftx += 1.0f;
-                    }
-                    bottomy += 1.0f;
+                    store_texture_gradients(uv_gradients, v_depthed_p.data() + m_texture_gradient_offset, pwo);
                 }
-                for (; idx < n; idx++)
+                this->render_pixel<DepthTest, DepthWrite, Blend, Wire>(
+                    c, v_depthed_p.data(), Wire ? get_wire_distance(wire, c.x, c.y) : 0.0f);
+                leftx += 1.0f;
+            }
+            bottomy += 1.0f;
+        }
+    }
+    else
+    {
+        Base::vec4_t c;
+        for (idx = 0; idx < xab.size() % (n + 1); idx++)
+        {
+            if ((int)bottomy < m_scissor.y_min || (int)bottomy >= m_scissor.y_max)
+            {
+                bottomy += 1.0f;
+                continue;
+            }
+            float leftx = xac[idx];
+            float rightx = xab[idx];
+            float v_weight_ac = get_weight_between(leftx, bottomy, sa.x, sa.y, sc.x, sc.y);
+            float v_weight_ab = get_weight_between(rightx, bottomy, sa.x, sa.y, sb.x, sb.y);
+            interpolate_attributes(
+                v_depthed_a.data(), v_depthed_b.data(), v_interpolated_ab.data(), v_weight_ab, v_out_format);
+            interpolate_attributes(
+                v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
+            float lz = sa.z + (sc.z - sa.z) * v_weight_ac;
+            float rz = sa.z + (sb.z - sa.z) * v_weight_ab;
+            float lwo = sa.w + (sc.w - sa.w) * v_weight_ac;
+            float rwo = sa.w + (sb.w - sa.w) * v_weight_ab;
+            while (leftx < rightx)
+            {
+                float h_weight = (leftx - xac[idx]) / (xab[idx] - xac[idx]);
+                interpolate_attributes(
+                    v_interpolated_ac.data(), v_interpolated_ab.data(), v_interpolated_lr.data(), h_weight,
+                    v_out_format);
+                c.x = leftx;
+                c.y = bottomy;
+                c.z = lz + (rz - lz) * h_weight;
+                float pwo = lwo + (rwo - lwo) * h_weight;
+                float pzo = 1.0f / pwo;
+                c.w = pwo;
+                multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
+                if (m_texture_gradient_offset >= 0)
                 {
-                    float leftx = xbc[idx - xab.size()];
-                    float rightx = xac[idx];
-                    float v_weight_bc = get_weight_between(leftx, bottomy, sb.x, sb.y, sc.x, sc.y);
-                    float v_weight_ac = get_weight_between(rightx, bottomy, sa.x, sa.y, sc.x, sc.y);
-                    interpolate_attributes(
-                        v_depthed_b.data(), v_depthed_c.data(), v_interpolated_bc.data(), v_weight_bc, v_out_format);
-                    interpolate_attributes(
-                        v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
-                    float lz = sb.z + (sc.z - sb.z) * v_weight_bc;
-                    float rz = sa.z + (sc.z - sa.z) * v_weight_ac;
-                    float lwo = sb.w + (sc.w - sb.w) * v_weight_bc;
-                    float rwo = sa.w + (sc.w - sa.w) * v_weight_ac;
-                    while (leftx < rightx)
-                    {
-                        float h_weight = (leftx - xbc[idx - xab.size()]) / (xac[idx] - xbc[idx - xab.size()]);
-                        interpolate_attributes(
-                            v_interpolated_bc.data(), v_interpolated_ac.data(), v_interpolated_lr.data(), h_weight,
-                            v_out_format);
-                        c.x = leftx;
-                        c.y = bottomy;
-                        c.z = lz + (rz - lz) * h_weight;
-                        float pwo = lwo + (rwo - lwo) * h_weight;
-                        float pzo = 1.0f / pwo;
-                        c.w = pwo;
-                        multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
-                        this->render_pixel_depth_wise(c, v_depthed_p.data());
-                        leftx += 1.0f;
-                    }
-                    bottomy += 1.0f;
+                    store_texture_gradients(uv_gradients, v_depthed_p.data() + m_texture_gradient_offset, pwo);
                 }
+                this->render_pixel<DepthTest, DepthWrite, Blend, Wire>(
+                    c, v_depthed_p.data(), Wire ? get_wire_distance(wire, c.x, c.y) : 0.0f);
+                leftx += 1.0f;
             }
-            else
+            bottomy += 1.0f;
+        }
+        for (; idx < n; idx++)
+        {
+            if ((int)bottomy < m_scissor.y_min || (int)bottomy >= m_scissor.y_max)
+            {
+                bottomy += 1.0f;
+                continue;
+            }
+            float leftx = xac[idx];
+            float rightx = xbc[idx - xab.size()];
+            float v_weight_ac = get_weight_between(leftx, bottomy, sa.x, sa.y, sc.x, sc.y);
+            float v_weight_bc = get_weight_between(rightx, bottomy, sb.x, sb.y, sc.x, sc.y);
+            interpolate_attributes(
+                v_depthed_b.data(), v_depthed_c.data(), v_interpolated_bc.data(), v_weight_bc, v_out_format);
+            interpolate_attributes(
+                v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
+            float lz = sa.z + (sc.z - sa.z) * v_weight_ac;
+            float rz = sb.z + (sc.z - sb.z) * v_weight_bc;
+            float lwo = sa.w + (sc.w - sa.w) * v_weight_ac;
+            float rwo = sb.w + (sc.w - sb.w) * v_weight_bc;
+            while (leftx < rightx)
             {
-                Base::vec4_t c;
-                for (idx = 0; idx < xab.size() % (n + 1); idx++)
+                float h_weight = (leftx - xac[idx]) / (xbc[idx - xab.size()] - xac[idx]);
+                interpolate_attributes(
+                    v_interpolated_ac.data(), v_interpolated_bc.data(), v_interpolated_lr.data(), h_weight,
+                    v_out_format);
+                c.x = leftx;
+                c.y = bottomy;
+                c.z = lz + (rz - lz) * h_weight;
+                float pwo = lwo + (rwo - lwo) * h_weight;
+                float pzo = 1.0f / pwo;
+                c.w = pwo;
+                multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
+                if (m_texture_gradient_offset >= 0)
                 {
-                    float leftx = xac[idx];
-                    float rightx = xab[idx];
-                    float v_weight_ac = get_weight_between(leftx, bottomy, sa.x, sa.y, sc.x, sc.y);
-                    float v_weight_ab = get_weight_between(rightx, bottomy, sa.x, sa.y, sb.x, sb.y);
-                    interpolate_attributes(
-                        v_depthed_a.data(), v_depthed_b.data(), v_interpolated_ab.data(), v_weight_ab, v_out_format);
-                    interpolate_attributes(
-                        v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
-                    float lz = sa.z + (sc.z - sa.z) * v_weight_ac;
-                    float rz = sa.z + (sb.z - sa.z) * v_weight_ab;
-                    float lwo = sa.w + (sc.w - sa.w) * v_weight_ac;
-                    float rwo = sa.w + (sb.w - sa.w) * v_weight_ab;
-                    while (leftx < rightx)
-                    {
-                        float h_weight = (leftx - xac[idx]) / (xab[idx] - xac[idx]);
-                        interpolate_attributes(
-                            v_interpolated_ac.data(), v_interpolated_ab.data(), v_interpolated_lr.data(), h_weight,
-                            v_out_format);
-                        c.x = leftx;
-                        c.y = bottomy;
-                        c.z = lz + (rz - lz) * h_weight;
-                        float pwo = lwo + (rwo - lwo) * h_weight;
-                        float pzo = 1.0f / pwo;
-                        c.w = pwo;
-                        multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
-                        this->render_pixel_depth_wise(c, v_depthed_p.data());
-                        leftx += 1.0f;
-                    }
-                    bottomy += 1.0f;
+                    store_texture_gradients(uv_gradients, v_depthed_p.data() + m_texture_gradient_offset, pwo);
                 }
-                for (; idx < n; idx++)
+                this->render_pixel<DepthTest, DepthWrite, Blend, Wire>(
+                    c, v_depthed_p.data(), Wire ? get_wire_distance(wire, c.x, c.y) : 0.0f);
+                leftx += 1.0f;
+            }
+            bottomy += 1.0f;
+        }
+    }
+    return true;
+}
+
+template <
+    Sisyphus::Render::ECullingMode Cull, bool DepthTest, bool DepthWrite, Sisyphus::Render::EBlendMode Blend,
+    bool Wire, bool Capture>
+void
+Sisyphus::Render::Context::draw_triangles_loop(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_shader_format)
+{
+    // wireframe carries barycentrics of the original triangle through clipping
+    if (Wire && (m_wire_format.attributes.size() != v_shader_format.attributes.size() + 1 ||
+                 !std::equal(
+                     v_shader_format.attributes.begin(), v_shader_format.attributes.end(),
+                     m_wire_format.attributes.begin())))
+    {
+        std::vector<EVertexAttribType> attributes = v_shader_format.attributes;
+        attributes.push_back(EVertexAttribType::VEC3);
+        m_wire_format = VertexFormat(attributes);
+    }
+    const VertexFormat& v_out_format = Wire ? m_wire_format : v_shader_format;
+    int                 fragments = 0;
+    // vertices of the previous triangle stay in their slots - a strip or a fan
+    // shades one new vertex per triangle, lists reuse shared edges
+    Base::vec4_t slot_world[3];
+    int          slot_index[3] = {-1, -1, -1};
+    for (int s = 0; s < 3; s++)
+    {
+        m_triangle_vertex_out[s].resize(v_out_format.size);
+    }
+    PrimitiveAssembly assembly;
+    int               triangle[3];
+    uint32_t          primitive = get_first_primitive(geometry, 3);
+    while (assemble_triangle(geometry, assembly, triangle))
+    {
+        m_primitive_id = primitive++;
+        // stitched strips repeat indices, such triangles have no area but would rasterize a line
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+        {
+            continue;
+        }
+        int  corner_slot[3] = {-1, -1, -1};
+        bool slot_used[3] = {false, false, false};
+        for (int c = 0; c < 3; c++)
+        {
+            for (int s = 0; s < 3; s++)
+            {
+                if (slot_index[s] == triangle[c])
                 {
-                    float leftx = xac[idx];
-                    float rightx = xbc[idx - xab.size()];
-                    float v_weight_ac = get_weight_between(leftx, bottomy, sa.x, sa.y, sc.x, sc.y);
-                    float v_weight_bc = get_weight_between(rightx, bottomy, sb.x, sb.y, sc.x, sc.y);
-                    interpolate_attributes(
-                        v_depthed_b.data(), v_depthed_c.data(), v_interpolated_bc.data(), v_weight_bc, v_out_format);
-                    interpolate_attributes(
-                        v_depthed_a.data(), v_depthed_c.data(), v_interpolated_ac.data(), v_weight_ac, v_out_format);
-                    float lz = sa.z + (sc.z - sa.z) * v_weight_ac;
-                    float rz = sb.z + (sc.z - sb.z) * v_weight_bc;
-                    float lwo = sa.w + (sc.w - sa.w) * v_weight_ac;
-                    float rwo = sb.w + (sc.w - sb.w) * v_weight_bc;
-                    while (leftx < rightx)
-                    {
-                        float h_weight = (leftx - xac[idx]) / (xbc[idx - xab.size()] - xac[idx]);
-                        interpolate_attributes(
-                            v_interpolated_ac.data(), v_interpolated_bc.data(), v_interpolated_lr.data(), h_weight,
-                            v_out_format);
-                        c.x = leftx;
-                        c.y = bottomy;
-                        c.z = lz + (rz - lz) * h_weight;
-                        float pwo = lwo + (rwo - lwo) * h_weight;
-                        float pzo = 1.0f / pwo;
-                        c.w = pwo;
-                        multiply_attributes(v_interpolated_lr.data(), v_depthed_p.data(), pzo, v_out_format);
-                        this->render_pixel_depth_wise(c, v_depthed_p.data());
-                        leftx += 1.0f;
-                    }
-                    bottomy += 1.0f;
+                    corner_slot[c] = s;
+                    slot_used[s] = true;
+                    break;
                 }
             }
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            if (corner_slot[c] >= 0)
+            {
+                continue;
+            }
+            int s = 0;
+            while (slot_used[s])
+            {
+                s++;
+            }
+            corner_slot[c] = s;
+            slot_used[s] = true;
+            slot_index[s] = triangle[c];
+            // obtain output coordinates in view space and output vertex attributes
+            this->m_bound_vsf(
+                geometry.coords[triangle[c]], slot_world[s], m_triangle_vertex_out[s],
+                &geometry.vertex_data[triangle[c] * v_in_format.size], this->m_builtins, this->m_descriptor_set);
+        }
+        const Base::vec4_t&   a_world = slot_world[corner_slot[0]];
+        const Base::vec4_t&   b_world = slot_world[corner_slot[1]];
+        const Base::vec4_t&   c_world = slot_world[corner_slot[2]];
+        std::vector<uint8_t>& a_vertex_out = m_triangle_vertex_out[corner_slot[0]];
+        std::vector<uint8_t>& b_vertex_out = m_triangle_vertex_out[corner_slot[1]];
+        std::vector<uint8_t>& c_vertex_out = m_triangle_vertex_out[corner_slot[2]];
+        if (Wire)
+        {
+            Base::replace_data(a_vertex_out, Base::vec3_t {1.0f, 0.0f, 0.0f}, (uint32_t)v_shader_format.size);
+            Base::replace_data(b_vertex_out, Base::vec3_t {0.0f, 1.0f, 0.0f}, (uint32_t)v_shader_format.size);
+            Base::replace_data(c_vertex_out, Base::vec3_t {0.0f, 0.0f, 1.0f}, (uint32_t)v_shader_format.size);
+        }
+
+        // backface culling
+        if (is_culled_triangle<Cull>(a_world, b_world, c_world))
+        {
+            continue;
+        }
+        // frustum culling
+        std::vector<uint8_t>      view_passed_vertex_data = {};
+        std::vector<Base::vec4_t> view_passed_vertex_coords = {};
+        this->cull_triangle_by_frustum(
+            a_world, b_world, c_world, a_vertex_out.data(), b_vertex_out.data(), c_vertex_out.data(), v_out_format,
+            view_passed_vertex_coords, view_passed_vertex_data);
+        if (Capture)
+        {
+            m_transform_capture->m_coords.insert(
+                m_transform_capture->m_coords.end(), view_passed_vertex_coords.begin(),
+                view_passed_vertex_coords.end());
+            m_transform_capture->m_data.insert(
+                m_transform_capture->m_data.end(), view_passed_vertex_data.begin(), view_passed_vertex_data.end());
+            m_transform_capture->m_primitives.insert(
+                m_transform_capture->m_primitives.end(), view_passed_vertex_coords.size() / 3, m_primitive_id);
+            continue;
+        }
+        // rasterization
+        for (size_t j = 0; j < view_passed_vertex_coords.size(); j += 3)
+        {
+            const Base::vec4_t& a_visible(view_passed_vertex_coords[j]);
+            const Base::vec4_t& b_visible(view_passed_vertex_coords[j + 1]);
+            const Base::vec4_t& c_visible(view_passed_vertex_coords[j + 2]);
+            //
+            uint8_t* vertex_out_a_ptr = &view_passed_vertex_data[j * v_out_format.size];
+            uint8_t* vertex_out_b_ptr = &view_passed_vertex_data[(j + 1) * v_out_format.size];
+            uint8_t* vertex_out_c_ptr = &view_passed_vertex_data[(j + 2) * v_out_format.size];
+            //
+            if (!this->rasterize_triangle<DepthTest, DepthWrite, Blend, Wire>(
+                    a_visible, b_visible, c_visible, vertex_out_a_ptr, vertex_out_b_ptr, vertex_out_c_ptr,
+                    v_out_format))
+            {
+                continue;
+            }
             fragments++;
         }
     }
     if (m_log != nullptr)
     {
-        static char msg[128];
-        int         iwr = snprintf(msg, 128, "triangles drawn: %d \n", fragments);
+        char msg[128];
+        int  iwr = snprintf(msg, 128, "triangles drawn: %d \n", fragments);
         m_log(msg, iwr);
     }
 }
 
+template <bool DepthTest, bool DepthWrite, Sisyphus::Render::EBlendMode Blend, bool Wire>
+void
+Sisyphus::Render::Context::draw_cached_triangles_loop(TransformCache& cache)
+{
+    size_t vertex_size = cache.m_format.size;
+    for (size_t j = 0; j < cache.m_coords.size(); j += 3)
+    {
+        m_primitive_id = cache.m_primitives[j / 3];
+        this->rasterize_triangle<DepthTest, DepthWrite, Blend, Wire>(
+            cache.m_coords[j], cache.m_coords[j + 1], cache.m_coords[j + 2], &cache.m_data[j * vertex_size],
+            &cache.m_data[(j + 1) * vertex_size], &cache.m_data[(j + 2) * vertex_size], cache.m_format);
+    }
+}
+
+// indexed by get_pipeline_variant - wireframe, culling, depth test, depth write, blend
+namespace Sisyphus
+{
+namespace Render
+{
+    const Context::TriangleLoop Context::s_triangle_loops[pipeline_variant_count] = {
+        &Context::draw_triangles_loop<ECullingMode::None, false, false, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, false, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, true, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, true, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, false, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, false, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, true, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, true, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, false, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, false, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, true, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, true, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, false, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, false, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, true, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, true, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, false, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, false, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, true, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, true, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, false, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, false, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, true, EBlendMode::Opaque, false>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, true, EBlendMode::Alpha, false>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, false, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, false, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, true, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, true, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, false, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, false, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, true, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, true, true, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, false, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, false, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, true, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, true, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, false, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, false, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, true, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, true, true, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, false, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, false, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, true, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, true, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, false, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, false, EBlendMode::Alpha, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, true, EBlendMode::Opaque, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, true, true, EBlendMode::Alpha, true>,
+    };
+    const Context::LineLoop Context::s_line_loops[line_pipeline_variant_count] = {
+        &Context::draw_lines_loop<false, false, EBlendMode::Opaque>,
+        &Context::draw_lines_loop<false, false, EBlendMode::Alpha>,
+        &Context::draw_lines_loop<false, true, EBlendMode::Opaque>,
+        &Context::draw_lines_loop<false, true, EBlendMode::Alpha>,
+        &Context::draw_lines_loop<true, false, EBlendMode::Opaque>,
+        &Context::draw_lines_loop<true, false, EBlendMode::Alpha>,
+        &Context::draw_lines_loop<true, true, EBlendMode::Opaque>,
+        &Context::draw_lines_loop<true, true, EBlendMode::Alpha>,
+    };
+    // wireframe, depth test, depth write, blend - culled triangles are not cached
+    const Context::CachedTriangleLoop Context::s_cached_triangle_loops[pipeline_variant_count / 3] = {
+        &Context::draw_cached_triangles_loop<false, false, EBlendMode::Opaque, false>,
+        &Context::draw_cached_triangles_loop<false, false, EBlendMode::Alpha, false>,
+        &Context::draw_cached_triangles_loop<false, true, EBlendMode::Opaque, false>,
+        &Context::draw_cached_triangles_loop<false, true, EBlendMode::Alpha, false>,
+        &Context::draw_cached_triangles_loop<true, false, EBlendMode::Opaque, false>,
+        &Context::draw_cached_triangles_loop<true, false, EBlendMode::Alpha, false>,
+        &Context::draw_cached_triangles_loop<true, true, EBlendMode::Opaque, false>,
+        &Context::draw_cached_triangles_loop<true, true, EBlendMode::Alpha, false>,
+        &Context::draw_cached_triangles_loop<false, false, EBlendMode::Opaque, true>,
+        &Context::draw_cached_triangles_loop<false, false, EBlendMode::Alpha, true>,
+        &Context::draw_cached_triangles_loop<false, true, EBlendMode::Opaque, true>,
+        &Context::draw_cached_triangles_loop<false, true, EBlendMode::Alpha, true>,
+        &Context::draw_cached_triangles_loop<true, false, EBlendMode::Opaque, true>,
+        &Context::draw_cached_triangles_loop<true, false, EBlendMode::Alpha, true>,
+        &Context::draw_cached_triangles_loop<true, true, EBlendMode::Opaque, true>,
+        &Context::draw_cached_triangles_loop<true, true, EBlendMode::Alpha, true>,
+    };
+    // wireframe, culling - clipped triangles go into the transform cache, nothing is rasterized
+    const Context::TriangleLoop
+        Context::s_capture_triangle_loops[pipeline_variant_count / line_pipeline_variant_count] = {
+        &Context::draw_triangles_loop<ECullingMode::None, false, false, EBlendMode::Opaque, false, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, false, EBlendMode::Opaque, false, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, false, EBlendMode::Opaque, false, true>,
+        &Context::draw_triangles_loop<ECullingMode::None, false, false, EBlendMode::Opaque, true, true>,
+        &Context::draw_triangles_loop<ECullingMode::ClockWise, false, false, EBlendMode::Opaque, true, true>,
+        &Context::draw_triangles_loop<ECullingMode::CounterClockWise, false, false, EBlendMode::Opaque, true, true>,
+    };
+} // namespace Render
+} // namespace Sisyphus
+
+Sisyphus::Render::GeometryView::GeometryView(
+    const std::vector<Base::vec4_t>& _coords, const std::vector<int>& _indices, const uint8_t* _vertex_data)
+    : coords(_coords.data())
+    , vertex_count((uint32_t)_coords.size())
+    , indices(_indices.data()) // negative indices are invalid anyway, so int reads as uint32_t
+    , index_type(EIndexType::UINT32)
+    , index_count((uint32_t)_indices.size())
+    , vertex_data(_vertex_data)
+{}
+
+Sisyphus::Render::GeometryView::GeometryView(
+    const std::vector<Base::vec4_t>& _coords, const std::vector<uint16_t>& _indices, const uint8_t* _vertex_data)
+    : coords(_coords.data())
+    , vertex_count((uint32_t)_coords.size())
+    , indices(_indices.data())
+    , index_type(EIndexType::UINT16)
+    , index_count((uint32_t)_indices.size())
+    , vertex_data(_vertex_data)
+{}
+
+void
+Sisyphus::Render::Context::draw_lines(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds)
+{
+    GeometryView geometry(coords, indices, vertex_data_ptr);
+    geometry.topology = EPrimitiveType::LINE;
+    this->draw_lines(geometry, v_in_format, v_out_format, bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, const Base::Bounds* bounds)
+{
+    this->draw_triangles(GeometryView(coords, indices, vertex_data_ptr), v_in_format, v_out_format, bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_lines(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const Base::Bounds* bounds)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    assert(!is_triangle_topology(geometry.topology));
+    if (!has_primitives(geometry, 2))
+    {
+        return;
+    }
+    if (bounds != nullptr && !this->is_visible(*bounds))
+    {
+        return;
+    }
+    this->update_pipeline();
+    if (m_dirty_tiles != nullptr && this->skip_dirty_draw(geometry, v_in_format, v_out_format, bounds))
+    {
+        return;
+    }
+    (this->*m_line_loop)(geometry, v_in_format, v_out_format);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const Base::Bounds* bounds)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    assert(is_triangle_topology(geometry.topology));
+    if (!has_primitives(geometry, 3))
+    {
+        return;
+    }
+    if (bounds != nullptr && !this->is_visible(*bounds))
+    {
+        return;
+    }
+    this->update_pipeline();
+    if (m_dirty_tiles != nullptr && this->skip_dirty_draw(geometry, v_in_format, v_out_format, bounds))
+    {
+        return;
+    }
+    (this->*m_triangle_loop)(geometry, v_in_format, v_out_format);
+}
+
+void
+Sisyphus::Render::Context::draw_line_batches(
+    const LineBatch* batches, int batch_count, const VertexFormat& v_in_format, const VertexFormat& v_out_format)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    this->update_pipeline();
+    for (int i = 0; i < batch_count; i++)
+    {
+        const LineBatch& batch = batches[i];
+        if (batch.indices->size() == 0 || batch.indices->size() % 2 != 0)
+        {
+            continue;
+        }
+        if (batch.bounds != nullptr && !this->is_visible(*batch.bounds))
+        {
+            continue;
+        }
+        GeometryView geometry(*batch.coords, *batch.indices, batch.vertex_data);
+        geometry.topology = EPrimitiveType::LINE;
+        // every batch is a draw of its own for incremental submits
+        if (m_dirty_tiles != nullptr && this->skip_dirty_draw(geometry, v_in_format, v_out_format, batch.bounds))
+        {
+            continue;
+        }
+        (this->*m_line_loop)(geometry, v_in_format, v_out_format);
+    }
+}
+
+void
+Sisyphus::Render::Context::draw_lines(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const Base::Bounds* bounds)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_lines(
+        coords, indices, vertex_data_ptr, m_pipeline->get_vertex_input_format(),
+        m_pipeline->get_vertex_output_format(), bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const Base::Bounds* bounds)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_triangles(
+        coords, indices, vertex_data_ptr, m_pipeline->get_vertex_input_format(),
+        m_pipeline->get_vertex_output_format(), bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_lines(const GeometryView& geometry, const Base::Bounds* bounds)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_lines(geometry, m_pipeline->get_vertex_input_format(), m_pipeline->get_vertex_output_format(), bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles(const GeometryView& geometry, const Base::Bounds* bounds)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_triangles(
+        geometry, m_pipeline->get_vertex_input_format(), m_pipeline->get_vertex_output_format(), bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_triangle_instances(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    int first_instance, int instance_count, const uint8_t* instance_data, uint32_t instance_size)
+{
+    // matrices stay as they are, every instance rewrites only its own part of the block
+    uint8_t* block = m_builtins.data() + builtin_instance_offset;
+    for (int32_t i = first_instance; i < first_instance + instance_count; i++)
+    {
+        memcpy(block + offsetof(InstanceBlock, instance), &i, sizeof(i));
+        if (instance_size > 0)
+        {
+            memcpy(block + sizeof(InstanceBlock), instance_data + (size_t)i * instance_size, instance_size);
+        }
+        m_pixel_object_id = m_object_id + (uint32_t)i;
+        (this->*m_triangle_loop)(geometry, v_in_format, v_out_format);
+    }
+    m_pixel_object_id = m_object_id;
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_instanced(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, int instance_count,
+    const uint8_t* instance_data, const VertexFormat& instance_format, const Base::Bounds* bounds)
+{
+    this->draw_triangles_instanced(
+        GeometryView(coords, indices, vertex_data_ptr), v_in_format, v_out_format, instance_count, instance_data,
+        instance_format, bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_instanced(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    int instance_count, const uint8_t* instance_data, const VertexFormat& instance_format,
+    const Base::Bounds* bounds)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    assert(is_triangle_topology(geometry.topology));
+    if (!has_primitives(geometry, 3) || instance_count <= 0)
+    {
+        return;
+    }
+    if (bounds != nullptr && !this->is_visible(*bounds))
+    {
+        return;
+    }
+    this->update_pipeline();
+    InstanceBlock block {0, 0, instance_data != nullptr ? (uint32_t)instance_format.size : 0, 0};
+    if (m_dirty_tiles != nullptr)
+    {
+        uint64_t instance_signature = Base::hash_value(Base::hash_seed, instance_count);
+        instance_signature =
+            Base::hash_bytes(instance_signature, instance_data, (size_t)instance_count * block.instance_data_size);
+        if (this->skip_dirty_draw(geometry, v_in_format, v_out_format, bounds, instance_signature))
+        {
+            return;
+        }
+    }
+    m_builtins.resize(builtin_instance_data_offset + block.instance_data_size);
+    memcpy(m_builtins.data() + builtin_instance_offset, &block, sizeof(block));
+    this->draw_triangle_instances(
+        geometry, v_in_format, v_out_format, 0, instance_count, instance_data, block.instance_data_size);
+    // capacity is kept, the next instanced draw does not allocate
+    m_builtins.resize(builtin_instance_offset);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_indirect(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format, const DrawIndirectCommand* draws,
+    int draw_count, const uint8_t* instance_data, const VertexFormat& instance_format,
+    const uint8_t* draw_constants, uint32_t draw_constants_size)
+{
+    this->draw_triangles_indirect(
+        GeometryView(coords, indices, vertex_data_ptr), v_in_format, v_out_format, draws, draw_count,
+        instance_data, instance_format, draw_constants, draw_constants_size);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_indirect(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const DrawIndirectCommand* draws, int draw_count, const uint8_t* instance_data,
+    const VertexFormat& instance_format, const uint8_t* draw_constants, uint32_t draw_constants_size)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    if (draw_count <= 0)
+    {
+        return;
+    }
+    this->update_pipeline();
+    InstanceBlock block {
+        0, 0, instance_data != nullptr ? (uint32_t)instance_format.size : 0,
+        draw_constants != nullptr ? draw_constants_size : 0};
+    m_builtins.resize(builtin_instance_data_offset + block.instance_data_size + block.draw_data_size);
+    uint8_t*     constants_ptr = m_builtins.data() + builtin_instance_data_offset + block.instance_data_size;
+    GeometryView range = geometry; // records are only views into the shared buffers
+    for (int32_t d = 0; d < draw_count; d++)
+    {
+        const DrawIndirectCommand& draw = draws[d];
+        // records may come from other code, ranges outside the view are skipped without overflowing
+        if (draw.index_count > geometry.index_count || draw.index_offset > geometry.index_count - draw.index_count)
+        {
+            if (m_log != nullptr)
+            {
+                char msg[128];
+                int  iwr = snprintf(msg, 128, "indirect draw %d is out of the index range, skipped \n", d);
+                m_log(msg, iwr);
+            }
+            continue;
+        }
+        range.index_offset = geometry.index_offset + draw.index_offset;
+        range.index_count = draw.index_count;
+        range.base_vertex = geometry.base_vertex + draw.base_vertex;
+        if (draw.instance_count == 0 || !has_primitives(range, 3))
+        {
+            continue;
+        }
+        block.draw = d;
+        memcpy(m_builtins.data() + builtin_instance_offset, &block, sizeof(block));
+        if (block.draw_data_size > 0)
+        {
+            memcpy(constants_ptr, draw_constants + (size_t)d * block.draw_data_size, block.draw_data_size);
+        }
+        if (m_dirty_tiles != nullptr)
+        {
+            // every record is a draw of its own, its constants are in the builtins by now
+            uint64_t instance_signature = Base::hash_value(Base::hash_seed, draw.first_instance);
+            instance_signature = Base::hash_value(instance_signature, draw.instance_count);
+            instance_signature = Base::hash_bytes(
+                instance_signature, instance_data + (size_t)draw.first_instance * block.instance_data_size,
+                (size_t)draw.instance_count * block.instance_data_size);
+            if (this->skip_dirty_draw(range, v_in_format, v_out_format, nullptr, instance_signature))
+            {
+                continue;
+            }
+        }
+        this->draw_triangle_instances(
+            range, v_in_format, v_out_format, draw.first_instance, draw.instance_count, instance_data,
+            block.instance_data_size);
+    }
+    m_builtins.resize(builtin_instance_offset);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_instanced(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    int instance_count, const uint8_t* instance_data, const VertexFormat& instance_format, const Base::Bounds* bounds)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_triangles_instanced(
+        coords, indices, vertex_data_ptr, m_pipeline->get_vertex_input_format(),
+        m_pipeline->get_vertex_output_format(), instance_count, instance_data, instance_format, bounds);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_indirect(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const uint8_t* vertex_data_ptr,
+    const DrawIndirectCommand* draws, int draw_count, const uint8_t* instance_data,
+    const VertexFormat& instance_format, const uint8_t* draw_constants, uint32_t draw_constants_size)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_triangles_indirect(
+        coords, indices, vertex_data_ptr, m_pipeline->get_vertex_input_format(),
+        m_pipeline->get_vertex_output_format(), draws, draw_count, instance_data, instance_format, draw_constants,
+        draw_constants_size);
+}
+
 void
 Sisyphus::Render::Context::set_log_func(LogFunc log)
 {
@@ -1157,6 +2500,7 @@ Sisyphus::Render::Context::set_log_func(LogFunc log)
 
 Sisyphus::Render::Context::~Context()
 {
-    delete[] m_data;
+    m_frame_storage.release();
     m_data = nullptr;
+    m_depth = nullptr;
 }
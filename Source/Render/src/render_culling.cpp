@@ -0,0 +1,147 @@
+#include "render_culling.h"
+
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SISYPHUS_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+Sisyphus::Render::Frustum
+Sisyphus::Render::transform_frustum(const Frustum& frustum, const Base::mat4_t& m)
+{
+    // n * (R * p + t) + d = (R^T * n) * p + (n * t + d)
+    Frustum result;
+    for (int i = 0; i < 6; i++)
+    {
+        const Plane& p = frustum.bounds[i];
+        Base::vec3_t normal {
+            m.r0.x * p.normal.x + m.r1.x * p.normal.y + m.r2.x * p.normal.z,
+            m.r0.y * p.normal.x + m.r1.y * p.normal.y + m.r2.y * p.normal.z,
+            m.r0.z * p.normal.x + m.r1.z * p.normal.y + m.r2.z * p.normal.z,
+        };
+        float offset = p.normal.x * m.r0.w + p.normal.y * m.r1.w + p.normal.z * m.r2.w + p.offset;
+        // scale in m changes the length of the normal, distances to the plane need it unit
+        float length = normal.calculate_magnitude();
+        result.bounds[i] = Plane(normal * (1.0f / length), offset / length);
+    }
+    return result;
+}
+
+bool
+Sisyphus::Render::is_sphere_visible(const Base::BoundingSphere& view_sphere, const Frustum& frustum)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        const Plane& p = frustum.bounds[i];
+        // normals look outside, whole sphere above any plane is invisible
+        if (p.normal.calculate_dot_product(view_sphere.center) + p.offset > view_sphere.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Sisyphus::Render::is_box_visible(const Base::BoundingBox& view_box, const Frustum& frustum)
+{
+    Base::vec3_t center = (view_box.min + view_box.max) * 0.5f;
+    Base::vec3_t extent = (view_box.max - view_box.min) * 0.5f;
+    for (int i = 0; i < 6; i++)
+    {
+        const Plane& p = frustum.bounds[i];
+        // projected half size of the box onto the plane normal
+        float radius = fabs(p.normal.x) * extent.x + fabs(p.normal.y) * extent.y + fabs(p.normal.z) * extent.z;
+        if (p.normal.calculate_dot_product(center) + p.offset > radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Sisyphus::Render::is_visible(const Base::Bounds& bounds, const Base::mat4_t& model_view, const Frustum& frustum)
+{
+    if (!is_sphere_visible(Base::transform_sphere(bounds.sphere, model_view), frustum))
+    {
+        return false;
+    }
+    return is_box_visible(Base::transform_box(bounds.box, model_view), frustum);
+}
+
+void
+Sisyphus::Render::cull_spheres(const Base::vec4_t* view_spheres, int count, const Frustum& frustum, uint8_t* visible)
+{
+    int i = 0;
+#if SISYPHUS_CULLING_SSE
+    // 4 spheres against one plane at a time, planes are splatted once
+    __m128 nx[6], ny[6], nz[6], offset[6];
+    for (int j = 0; j < 6; j++)
+    {
+        nx[j] = _mm_set1_ps(frustum.bounds[j].normal.x);
+        ny[j] = _mm_set1_ps(frustum.bounds[j].normal.y);
+        nz[j] = _mm_set1_ps(frustum.bounds[j].normal.z);
+        offset[j] = _mm_set1_ps(frustum.bounds[j].offset);
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(view_spheres[i].data);
+        __m128 cy = _mm_loadu_ps(view_spheres[i + 1].data);
+        __m128 cz = _mm_loadu_ps(view_spheres[i + 2].data);
+        __m128 r = _mm_loadu_ps(view_spheres[i + 3].data);
+        _MM_TRANSPOSE4_PS(cx, cy, cz, r);
+        __m128 outside = _mm_setzero_ps();
+        for (int j = 0; j < 6; j++)
+        {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx[j], cx), _mm_mul_ps(ny[j], cy)),
+                _mm_add_ps(_mm_mul_ps(nz[j], cz), offset[j]));
+            outside = _mm_or_ps(outside, _mm_cmpgt_ps(d, r));
+        }
+        int mask = _mm_movemask_ps(outside);
+        visible[i] = (mask & 1) == 0;
+        visible[i + 1] = (mask & 2) == 0;
+        visible[i + 2] = (mask & 4) == 0;
+        visible[i + 3] = (mask & 8) == 0;
+    }
+#endif
+    for (; i < count; i++)
+    {
+        Base::BoundingSphere sphere {view_spheres[i].xyz, view_spheres[i].w};
+        visible[i] = is_sphere_visible(sphere, frustum);
+    }
+}
+
+int
+Sisyphus::Render::cull_bounds(
+    const Base::Bounds* const* bounds, const Base::mat4_t* model_views, int count, const Frustum& frustum,
+    uint8_t* visible)
+{
+    static thread_local std::vector<Base::vec4_t> view_spheres;
+    view_spheres.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        if (bounds[i] == nullptr)
+        {
+            // infinite radius is never above a plane
+            view_spheres[i] = Base::vec4_t {0.0f, 0.0f, 0.0f, INFINITY};
+            continue;
+        }
+        Base::BoundingSphere sphere = Base::transform_sphere(bounds[i]->sphere, model_views[i]);
+        view_spheres[i] = Base::vec4_t {sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius};
+    }
+    cull_spheres(view_spheres.data(), count, frustum, visible);
+    int visible_count = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (visible[i] && bounds[i] != nullptr)
+        {
+            visible[i] = is_box_visible(Base::transform_box(bounds[i]->box, model_views[i]), frustum);
+        }
+        visible_count += visible[i];
+    }
+    return visible_count;
+}
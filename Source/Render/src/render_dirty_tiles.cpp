@@ -0,0 +1,434 @@
+#include "render_dirty_tiles.h"
+#include "render_command_buffer.h"
+#include "base_utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    // more dirty rects than this are rendered as their bounding rect, every pass walks all commands
+    const int max_dirty_rect_passes = 8;
+
+    // DirtyTiles::DrawRecord, by signature and then by rect
+    template <typename T>
+    bool
+    is_draw_less(const T& a, const T& b)
+    {
+        if (a.signature != b.signature)
+        {
+            return a.signature < b.signature;
+        }
+        if (a.rect.x_min != b.rect.x_min)
+        {
+            return a.rect.x_min < b.rect.x_min;
+        }
+        if (a.rect.y_min != b.rect.y_min)
+        {
+            return a.rect.y_min < b.rect.y_min;
+        }
+        if (a.rect.x_max != b.rect.x_max)
+        {
+            return a.rect.x_max < b.rect.x_max;
+        }
+        return a.rect.y_max < b.rect.y_max;
+    }
+
+    bool
+    get_index_range(const Sisyphus::Render::GeometryView& geometry, uint32_t& first_vertex, uint32_t& last_vertex)
+    {
+        bool restart = geometry.topology == Sisyphus::Render::EPrimitiveType::LINE_STRIP ||
+                       geometry.topology == Sisyphus::Render::EPrimitiveType::TRIANGLE_STRIP ||
+                       geometry.topology == Sisyphus::Render::EPrimitiveType::TRIANGLE_FAN;
+        first_vertex = UINT32_MAX;
+        last_vertex = 0;
+        for (uint32_t i = 0; i < geometry.index_count; i++)
+        {
+            uint32_t raw_index = Sisyphus::Render::get_geometry_raw_index(geometry, i);
+            if (restart && Sisyphus::Render::is_restart_index(geometry, raw_index))
+            {
+                continue;
+            }
+            uint32_t index = (uint32_t)((int)raw_index + geometry.base_vertex);
+            first_vertex = std::min(first_vertex, index);
+            last_vertex = std::max(last_vertex, index);
+        }
+        return first_vertex <= last_vertex;
+    }
+} // namespace
+
+Sisyphus::Render::DirtyTiles::DirtyTiles(int tile_size)
+    : m_tile_size(tile_size)
+{
+    assert(m_tile_size > 0);
+}
+
+void
+Sisyphus::Render::DirtyTiles::invalidate()
+{
+    m_invalid = true;
+}
+
+void
+Sisyphus::Render::DirtyTiles::begin_frame(int width, int height)
+{
+    if (width != m_width || height != m_height)
+    {
+        m_width = width;
+        m_height = height;
+        m_tiles_x = (width + m_tile_size - 1) / m_tile_size;
+        m_tiles_y = (height + m_tile_size - 1) / m_tile_size;
+        m_invalid = true;
+    }
+    m_current.clear();
+}
+
+void
+Sisyphus::Render::DirtyTiles::add_draw(uint64_t signature, const ScreenRect& rect)
+{
+    m_current.push_back(DrawRecord {signature, rect});
+}
+
+void
+Sisyphus::Render::DirtyTiles::mark_rect(std::vector<uint8_t>& tiles, const ScreenRect& rect)
+{
+    if (rect.x_min >= rect.x_max || rect.y_min >= rect.y_max)
+    {
+        return;
+    }
+    int tx_min = std::max(rect.x_min, 0) / m_tile_size;
+    int ty_min = std::max(rect.y_min, 0) / m_tile_size;
+    int tx_max = std::min((rect.x_max - 1) / m_tile_size, m_tiles_x - 1);
+    int ty_max = std::min((rect.y_max - 1) / m_tile_size, m_tiles_y - 1);
+    for (int ty = ty_min; ty <= ty_max; ty++)
+    {
+        for (int tx = tx_min; tx <= tx_max; tx++)
+        {
+            tiles[ty * m_tiles_x + tx] = 1;
+        }
+    }
+}
+
+void
+Sisyphus::Render::DirtyTiles::end_frame(uint64_t frame_index, uint64_t content_frame_index)
+{
+    size_t tile_count = (size_t)m_tiles_x * m_tiles_y;
+    m_sorted = m_current;
+    std::sort(m_sorted.begin(), m_sorted.end(), is_draw_less<DrawRecord>);
+    // the previous list belongs to the frame right before this one only if no frame was skipped
+    int last_slot = (int)((frame_index - 1) % history_size);
+    if (frame_index < 2 || m_history_frame[last_slot] != frame_index - 1)
+    {
+        m_invalid = true;
+    }
+    m_changed.assign(tile_count, m_invalid ? 1 : 0);
+    if (!m_invalid)
+    {
+        // both lists are sorted, draws found in only one of them are dirty
+        size_t i = 0;
+        size_t j = 0;
+        while (i < m_previous.size() && j < m_sorted.size())
+        {
+            if (is_draw_less(m_previous[i], m_sorted[j]))
+            {
+                this->mark_rect(m_changed, m_previous[i++].rect);
+            }
+            else if (is_draw_less(m_sorted[j], m_previous[i]))
+            {
+                this->mark_rect(m_changed, m_sorted[j++].rect);
+            }
+            else
+            {
+                i++;
+                j++;
+            }
+        }
+        for (; i < m_previous.size(); i++)
+        {
+            this->mark_rect(m_changed, m_previous[i].rect);
+        }
+        for (; j < m_sorted.size(); j++)
+        {
+            this->mark_rect(m_changed, m_sorted[j].rect);
+        }
+    }
+    m_previous.swap(m_sorted);
+    int slot = (int)(frame_index % history_size);
+    m_history[slot] = m_changed;
+    m_history_frame[slot] = frame_index;
+    // the back buffer misses every change since the frame it holds
+    m_redraw = m_changed;
+    bool full = content_frame_index == 0 || content_frame_index >= frame_index ||
+                frame_index - content_frame_index > (uint64_t)history_size;
+    for (uint64_t f = content_frame_index + 1; !full && f < frame_index; f++)
+    {
+        const std::vector<uint8_t>& older = m_history[f % history_size];
+        if (m_history_frame[f % history_size] != f || older.size() != tile_count)
+        {
+            full = true;
+            break;
+        }
+        for (size_t t = 0; t < tile_count; t++)
+        {
+            m_redraw[t] |= older[t];
+        }
+    }
+    if (full)
+    {
+        m_redraw.assign(tile_count, 1);
+    }
+    m_invalid = false;
+}
+
+const Sisyphus::Render::ScreenRect&
+Sisyphus::Render::DirtyTiles::get_draw_rect(uint32_t draw) const
+{
+    assert(draw < m_current.size());
+    return m_current[draw].rect;
+}
+
+uint32_t
+Sisyphus::Render::DirtyTiles::get_draw_count() const
+{
+    return (uint32_t)m_current.size();
+}
+
+bool
+Sisyphus::Render::DirtyTiles::is_redraw_tile(int x, int y) const
+{
+    return m_redraw[y * m_tiles_x + x] != 0;
+}
+
+void
+Sisyphus::Render::DirtyTiles::append_rects(const std::vector<uint8_t>& tiles, std::vector<ScreenRect>& rects) const
+{
+    // runs of tiles in a row, a run with the same columns in the row above is extended down
+    std::vector<size_t> above;
+    std::vector<size_t> row;
+    for (int ty = 0; ty < m_tiles_y; ty++)
+    {
+        int tx = 0;
+        row.clear();
+        while (tx < m_tiles_x)
+        {
+            if (!tiles[ty * m_tiles_x + tx])
+            {
+                tx++;
+                continue;
+            }
+            int run = tx;
+            while (tx < m_tiles_x && tiles[ty * m_tiles_x + tx])
+            {
+                tx++;
+            }
+            ScreenRect rect {
+                run * m_tile_size, ty * m_tile_size, std::min(tx * m_tile_size, m_width),
+                std::min((ty + 1) * m_tile_size, m_height)};
+            size_t merged = rects.size();
+            for (size_t r : above)
+            {
+                if (rects[r].x_min == rect.x_min && rects[r].x_max == rect.x_max)
+                {
+                    rects[r].y_max = rect.y_max;
+                    merged = r;
+                    break;
+                }
+            }
+            if (merged == rects.size())
+            {
+                rects.push_back(rect);
+            }
+            row.push_back(merged);
+        }
+        above.swap(row);
+    }
+}
+
+void
+Sisyphus::Render::DirtyTiles::get_changed_rects(std::vector<ScreenRect>& rects) const
+{
+    rects.clear();
+    this->append_rects(m_changed, rects);
+}
+
+void
+Sisyphus::Render::DirtyTiles::get_redraw_rects(std::vector<ScreenRect>& rects) const
+{
+    rects.clear();
+    this->append_rects(m_redraw, rects);
+}
+
+Sisyphus::Render::ScreenRect
+Sisyphus::Render::Context::calculate_screen_rect(
+    const GeometryView& geometry, uint32_t first_vertex, uint32_t last_vertex, const VertexFormat& v_in_format,
+    const VertexFormat& v_out_format, const Base::Bounds* bounds)
+{
+    const ScreenRect full {0, 0, m_width, m_height};
+    const Plane&     znear = m_frustum.bounds[0];
+    float            x_min = FLT_MAX;
+    float            y_min = FLT_MAX;
+    float            x_max = -FLT_MAX;
+    float            y_max = -FLT_MAX;
+    auto             add_point = [&](const Base::vec4_t& view)
+    {
+        // behind the camera the projection flips, such draws are taken as the whole frame
+        if (znear.normal.calculate_dot_product(view.xyz) + znear.offset > 0.0f)
+        {
+            return false;
+        }
+        Base::vec4_t p = this->process_vertex(view);
+        x_min = std::min(x_min, p.x);
+        y_min = std::min(y_min, p.y);
+        x_max = std::max(x_max, p.x);
+        y_max = std::max(y_max, p.y);
+        return true;
+    };
+    if (bounds != nullptr)
+    {
+        const Base::BoundingBox& box = bounds->box;
+        for (int i = 0; i < 8; i++)
+        {
+            Base::vec4_t corner {
+                (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z,
+                1.0f};
+            if (!add_point(m_model_view_matrix * corner))
+            {
+                return full;
+            }
+        }
+    }
+    else
+    {
+        m_vertex_out.resize(v_out_format.size);
+        for (uint32_t v = first_vertex; v <= last_vertex; v++)
+        {
+            Base::vec4_t view;
+            m_bound_vsf(
+                geometry.coords[v], view, m_vertex_out, &geometry.vertex_data[v * v_in_format.size], m_builtins,
+                m_descriptor_set);
+            if (!add_point(view))
+            {
+                return full;
+            }
+        }
+    }
+    // a pixel of margin for rounding of the rasterizer
+    ScreenRect rect {
+        (int)floorf(x_min) - 1, (int)floorf(y_min) - 1, (int)ceilf(x_max) + 1, (int)ceilf(y_max) + 1};
+    rect.x_min = std::max(rect.x_min, 0);
+    rect.y_min = std::max(rect.y_min, 0);
+    rect.x_max = std::min(rect.x_max, m_width);
+    rect.y_max = std::min(rect.y_max, m_height);
+    return rect;
+}
+
+bool
+Sisyphus::Render::Context::skip_dirty_draw(
+    const GeometryView& geometry, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const Base::Bounds* bounds, uint64_t instance_signature)
+{
+    if (!m_dirty_recording)
+    {
+        // draws come in the same order as they were listed
+        return !is_rect_overlapping(m_dirty_tiles->get_draw_rect(m_dirty_draw++), m_scissor);
+    }
+    uint32_t first_vertex = 0;
+    uint32_t last_vertex = 0;
+    if (!get_index_range(geometry, first_vertex, last_vertex))
+    {
+        m_dirty_tiles->add_draw(0, ScreenRect {0, 0, 0, 0});
+        return true;
+    }
+    // contents of the geometry and everything shaders can read
+    uint32_t index_size = geometry.index_type == EIndexType::UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    uint32_t vertex_count = last_vertex - first_vertex + 1;
+    uint64_t signature = Base::hash_value(Base::hash_seed, geometry.topology);
+    signature = Base::hash_value(signature, geometry.base_vertex);
+    signature = Base::hash_bytes(
+        signature, static_cast<const uint8_t*>(geometry.indices) + (size_t)geometry.index_offset * index_size,
+        (size_t)geometry.index_count * index_size);
+    signature = Base::hash_bytes(signature, geometry.coords + first_vertex, vertex_count * sizeof(Base::vec4_t));
+    signature = Base::hash_bytes(
+        signature, geometry.vertex_data + (size_t)first_vertex * v_in_format.size, vertex_count * v_in_format.size);
+    signature = Base::hash_bytes(
+        signature, v_out_format.attributes.data(), v_out_format.attributes.size() * sizeof(EVertexAttribType));
+    signature = Base::hash_value(signature, m_bound_vsf);
+    signature = Base::hash_value(signature, m_bound_psf);
+    signature = Base::hash_value(signature, m_pipeline_variant);
+    signature = Base::hash_value(signature, m_wire_color);
+    signature = Base::hash_value(signature, m_wire_width);
+    signature = Base::hash_value(signature, m_pixel_object_id);
+    signature = Base::hash_value(signature, m_viewport_min);
+    signature = Base::hash_value(signature, m_viewport_max);
+    signature = Base::hash_value(signature, m_frustum);
+    signature = Base::hash_bytes(signature, m_builtins.data(), m_builtins.size());
+    signature = Base::hash_bytes(signature, m_descriptor_set.data(), m_descriptor_set.size());
+    signature = Base::hash_value(signature, instance_signature);
+    // vertices alone do not tell where instances end up
+    ScreenRect rect {0, 0, m_width, m_height};
+    if (instance_signature == 0 || bounds != nullptr)
+    {
+        rect = this->calculate_screen_rect(geometry, first_vertex, last_vertex, v_in_format, v_out_format, bounds);
+    }
+    m_dirty_tiles->add_draw(signature, rect);
+    return true;
+}
+
+void
+Sisyphus::Render::Context::submit_incremental(
+    const CommandBuffer* const* buffers, int buffer_count, DirtyTiles& tiles, bool sort_draws)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    // every pass starts from the same state
+    CommandState         state;
+    std::vector<uint8_t> descriptor_set = m_descriptor_set;
+    Base::vec3_t         viewport_min = m_viewport_min;
+    Base::vec3_t         viewport_max = m_viewport_max;
+    ScreenRect           scissor = m_scissor;
+    this->capture_command_state(state);
+    tiles.begin_frame(m_width, m_height);
+    m_dirty_tiles = &tiles;
+    m_dirty_recording = true;
+    this->submit(buffers, buffer_count, sort_draws);
+    m_dirty_recording = false;
+    tiles.end_frame(m_swapchain.get_frame_counter() + 1, m_back_buffer->frame_index);
+    tiles.get_changed_rects(m_dirty_rects);
+    m_incremental_frame = true;
+    std::vector<ScreenRect> redraw;
+    tiles.get_redraw_rects(redraw);
+    if (redraw.size() > max_dirty_rect_passes)
+    {
+        for (size_t i = 1; i < redraw.size(); i++)
+        {
+            redraw[0].x_min = std::min(redraw[0].x_min, redraw[i].x_min);
+            redraw[0].y_min = std::min(redraw[0].y_min, redraw[i].y_min);
+            redraw[0].x_max = std::max(redraw[0].x_max, redraw[i].x_max);
+            redraw[0].y_max = std::max(redraw[0].y_max, redraw[i].y_max);
+        }
+        redraw.resize(1);
+    }
+    for (const ScreenRect& rect : redraw)
+    {
+        this->apply_command_state(state, false);
+        m_descriptor_set = descriptor_set;
+        m_viewport_min = viewport_min;
+        m_viewport_max = viewport_max;
+        this->set_scissor(rect);
+        m_dirty_draw = 0;
+        this->submit(buffers, buffer_count, sort_draws);
+    }
+    m_scissor = scissor;
+    m_dirty_tiles = nullptr;
+}
+
+void
+Sisyphus::Render::Context::submit_incremental(const CommandBuffer& buffer, DirtyTiles& tiles, bool sort_draws)
+{
+    const CommandBuffer* buffers[] = {&buffer};
+    this->submit_incremental(buffers, 1, tiles, sort_draws);
+}
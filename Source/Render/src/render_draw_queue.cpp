@@ -0,0 +1,262 @@
+#include "render_draw_queue.h"
+#include "render_command_buffer.h"
+#include "render_pipeline_state.h"
+#include "render_query.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+static int64_t
+get_time_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void
+update_max(std::atomic<uint64_t>& max_value, uint64_t value)
+{
+    uint64_t current = max_value.load(std::memory_order_relaxed);
+    while (value > current && !max_value.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void
+Sisyphus::Render::set_packet_descriptor_set(DrawPacket& packet, const std::vector<uint8_t>& descriptor_set)
+{
+    assert(descriptor_set.size() <= max_packet_descriptor_size);
+    packet.descriptor_set_size = (uint32_t)descriptor_set.size();
+    memcpy(packet.descriptor_set, descriptor_set.data(), descriptor_set.size());
+}
+
+Sisyphus::Render::DrawQueue::DrawQueue(int width, int height, int bytes_per_pixel, size_t capacity)
+    : m_context(width, height, bytes_per_pixel)
+    , m_queue(capacity)
+    , m_sleeping(false)
+    , m_stop(false)
+    , m_flush_waiters(0)
+{
+    this->reset_stats();
+    m_executed.store(0);
+    m_thread = std::thread(&DrawQueue::run, this);
+}
+
+void
+Sisyphus::Render::DrawQueue::run()
+{
+    DrawPacket packet;
+    while (true)
+    {
+        if (m_queue.try_pop(packet))
+        {
+            uint64_t latency = (uint64_t)(get_time_ns() - packet.submit_time);
+            m_total_latency.fetch_add(latency, std::memory_order_relaxed);
+            update_max(m_max_latency, latency);
+            this->execute(packet);
+            // sequentially consistent like the counter of waiters - either a flush sees
+            // the packet executed or we see it waiting
+            m_executed.fetch_add(1);
+            if (m_flush_waiters.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_idle.notify_all();
+            }
+            continue;
+        }
+        // a producer may be in the middle of writing, give it a moment before sleeping
+        for (int i = 0; i < 64 && !m_queue.is_ready(); i++)
+        {
+            std::this_thread::yield();
+        }
+        if (m_queue.is_ready())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_wake.wait(
+            lock,
+            [this]()
+            {
+                return m_stop.load() || m_queue.is_ready();
+            });
+        m_sleeping.store(false);
+        if (m_stop.load() && !m_queue.is_ready())
+        {
+            return;
+        }
+    }
+}
+
+void
+Sisyphus::Render::DrawQueue::execute(const DrawPacket& packet)
+{
+    switch (packet.type)
+    {
+    case EDrawPacketType::Commands:
+        m_context.submit(*packet.commands);
+        break;
+    case EDrawPacketType::DrawTriangles:
+    case EDrawPacketType::DrawLines:
+        assert(packet.pipeline != nullptr);
+        if (packet.condition != nullptr && packet.condition->is_hidden())
+        {
+            break;
+        }
+        if (m_context.get_pipeline_state() != packet.pipeline)
+        {
+            m_context.set_pipeline_state(packet.pipeline);
+        }
+        m_context.set_model_matrix(packet.model_matrix);
+        if (packet.descriptor_set_size > 0)
+        {
+            m_descriptor_set.assign(packet.descriptor_set, packet.descriptor_set + packet.descriptor_set_size);
+            m_context.set_descriptor_set(m_descriptor_set);
+        }
+        if (packet.query != nullptr)
+        {
+            m_context.begin_query(packet.query);
+        }
+        if (packet.type == EDrawPacketType::DrawTriangles)
+        {
+            m_context.draw_triangles(*packet.coords, *packet.indices, packet.vertex_data, packet.bounds);
+        }
+        else
+        {
+            m_context.draw_lines(*packet.coords, *packet.indices, packet.vertex_data, packet.bounds);
+        }
+        if (packet.query != nullptr)
+        {
+            m_context.end_query();
+        }
+        break;
+    case EDrawPacketType::QueryProxy:
+        assert(packet.query != nullptr && packet.bounds != nullptr);
+        m_context.set_model_matrix(packet.model_matrix);
+        m_context.begin_query(packet.query);
+        m_context.draw_query_proxy(packet.bounds->box);
+        m_context.end_query();
+        break;
+    case EDrawPacketType::Resize:
+        m_context.resize(packet.width, packet.height, packet.bytes_per_pixel);
+        break;
+    case EDrawPacketType::Present:
+        m_context.present();
+        break;
+    }
+}
+
+bool
+Sisyphus::Render::DrawQueue::try_submit(const DrawPacket& packet)
+{
+    DrawPacket stamped = packet;
+    stamped.submit_time = get_time_ns();
+    if (!m_queue.try_push(stamped))
+    {
+        return false;
+    }
+    update_max(m_max_queue_size, m_queue.get_size());
+    // pairs with the store in run - either the consumer sees the packet or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+void
+Sisyphus::Render::DrawQueue::submit(const DrawPacket& packet)
+{
+    if (this->try_submit(packet))
+    {
+        return;
+    }
+    // backpressure - producers can not run ahead of the render thread too far
+    int64_t stall_start = get_time_ns();
+    while (!this->try_submit(packet))
+    {
+        std::this_thread::yield();
+    }
+    m_stalled_submits.fetch_add(1, std::memory_order_relaxed);
+    m_stall_time.fetch_add((uint64_t)(get_time_ns() - stall_start), std::memory_order_relaxed);
+}
+
+void
+Sisyphus::Render::DrawQueue::flush()
+{
+    // a ticket instead of a counter bumped after the push - the render thread may run
+    // a packet before its producer counts it. Pops go in enqueue order, so every
+    // packet claimed so far is executed once the counter reaches the enqueue position
+    uint64_t                     target = m_queue.get_enqueue_position();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flush_waiters++;
+    m_idle.wait(
+        lock,
+        [this, target]()
+        {
+            return m_executed.load() >= target;
+        });
+    m_flush_waiters--;
+}
+
+Sisyphus::Render::DrawQueueStats
+Sisyphus::Render::DrawQueue::get_stats() const
+{
+    DrawQueueStats stats;
+    stats.submitted = m_queue.get_enqueue_position();
+    stats.executed = m_executed.load(std::memory_order_relaxed);
+    stats.stalled_submits = m_stalled_submits.load(std::memory_order_relaxed);
+    stats.stall_time_ns = m_stall_time.load(std::memory_order_relaxed);
+    stats.total_latency_ns = m_total_latency.load(std::memory_order_relaxed);
+    stats.max_latency_ns = m_max_latency.load(std::memory_order_relaxed);
+    stats.max_queue_size = m_max_queue_size.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void
+Sisyphus::Render::DrawQueue::reset_stats()
+{
+    // packet counters keep going, flush depends on them
+    m_stalled_submits.store(0);
+    m_stall_time.store(0);
+    m_total_latency.store(0);
+    m_max_latency.store(0);
+    m_max_queue_size.store(0);
+}
+
+const Sisyphus::Render::FrameBuffer*
+Sisyphus::Render::DrawQueue::acquire_frame()
+{
+    return m_context.acquire_frame();
+}
+
+void
+Sisyphus::Render::DrawQueue::release_frame(const FrameBuffer* frame)
+{
+    m_context.release_frame(frame);
+}
+
+Sisyphus::Render::Context&
+Sisyphus::Render::DrawQueue::get_context()
+{
+    return m_context;
+}
+
+Sisyphus::Render::DrawQueue::~DrawQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop.store(true);
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
@@ -0,0 +1,129 @@
+#include "render_frame_queue.h"
+
+#include <cassert>
+
+Sisyphus::Render::FrameQueue::FrameQueue(int max_frames_in_flight)
+{
+    this->set_max_frames_in_flight(max_frames_in_flight);
+}
+
+void
+Sisyphus::Render::FrameQueue::run()
+{
+    while (true)
+    {
+        FrameJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job_added.wait(
+                lock,
+                [this]()
+                {
+                    return m_stop || !m_jobs.empty();
+                });
+            if (m_jobs.empty())
+            {
+                return; // stopped and nothing left to do
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completed++;
+        }
+        m_job_completed.notify_all();
+    }
+}
+
+void
+Sisyphus::Render::FrameQueue::set_max_frames_in_flight(int count)
+{
+    assert(count >= 0);
+    this->flush();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_frames_in_flight = count;
+}
+
+int
+Sisyphus::Render::FrameQueue::get_max_frames_in_flight() const
+{
+    return m_max_frames_in_flight;
+}
+
+uint64_t
+Sisyphus::Render::FrameQueue::submit(FrameJob job)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_max_frames_in_flight == 0)
+    {
+        uint64_t frame_id = ++m_submitted;
+        lock.unlock();
+        job();
+        lock.lock();
+        m_completed = frame_id;
+        return frame_id;
+    }
+    if (!m_thread.joinable())
+    {
+        m_thread = std::thread(&FrameQueue::run, this);
+    }
+    // backpressure - the caller can not run ahead of the renderer too far
+    m_job_completed.wait(
+        lock,
+        [this]()
+        {
+            return m_submitted - m_completed < (uint64_t)m_max_frames_in_flight;
+        });
+    uint64_t frame_id = ++m_submitted;
+    m_jobs.push_back(std::move(job));
+    lock.unlock();
+    m_job_added.notify_one();
+    return frame_id;
+}
+
+void
+Sisyphus::Render::FrameQueue::wait_frame(uint64_t frame_id)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    assert(frame_id <= m_submitted);
+    m_job_completed.wait(
+        lock,
+        [this, frame_id]()
+        {
+            return m_completed >= frame_id;
+        });
+}
+
+bool
+Sisyphus::Render::FrameQueue::is_frame_completed(uint64_t frame_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_completed >= frame_id;
+}
+
+void
+Sisyphus::Render::FrameQueue::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job_completed.wait(
+        lock,
+        [this]()
+        {
+            return m_completed >= m_submitted;
+        });
+}
+
+Sisyphus::Render::FrameQueue::~FrameQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_job_added.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
@@ -0,0 +1,93 @@
+#include "render_frame_storage.h"
+
+#include <algorithm>
+#include <cassert>
+
+void
+Sisyphus::Render::FrameStorage::reserve_block(Base::AlignedBlock& block, size_t size, bool allow_shrink)
+{
+    size_t old_capacity = block.capacity;
+    bool   too_big = old_capacity > size * 4;
+    if (size <= old_capacity && !(allow_shrink && too_big))
+    {
+        return;
+    }
+    Base::AlignedBlockPool* pool = Base::AlignedBlockPool::instance();
+    pool->release(block);
+    if (size == 0)
+    {
+        return;
+    }
+    // some headroom in both directions - next resize of the window most likely
+    // will be close to the current one
+    size_t new_capacity = size + size / 4;
+    if (!too_big)
+    {
+        new_capacity = std::max(new_capacity, old_capacity + old_capacity / 2);
+    }
+    new_capacity = Base::align_up(new_capacity, m_huge_pages ? Base::huge_page_size : Base::page_granularity);
+    block = pool->acquire(new_capacity, m_huge_pages);
+    assert(block.capacity >= size);
+}
+
+void
+Sisyphus::Render::FrameStorage::set_huge_pages(bool flag)
+{
+    if (m_huge_pages != flag)
+    {
+        m_huge_pages = flag;
+        this->release(); // will be allocated with new flag on next reserve
+    }
+}
+
+void
+Sisyphus::Render::FrameStorage::reserve(size_t color_size, size_t depth_size)
+{
+    bool much_smaller = color_size * 4 < m_color.capacity || depth_size * 4 < m_depth.capacity;
+    m_shrink_requests = much_smaller ? m_shrink_requests + 1 : 0;
+    bool allow_shrink = m_shrink_requests >= shrink_delay;
+    reserve_block(m_color, color_size, allow_shrink);
+    reserve_block(m_depth, depth_size, allow_shrink);
+    if (allow_shrink)
+    {
+        m_shrink_requests = 0;
+    }
+}
+
+uint8_t*
+Sisyphus::Render::FrameStorage::get_color() const
+{
+    return m_color.data;
+}
+
+float*
+Sisyphus::Render::FrameStorage::get_depth() const
+{
+    return reinterpret_cast<float*>(m_depth.data);
+}
+
+size_t
+Sisyphus::Render::FrameStorage::get_color_capacity() const
+{
+    return m_color.capacity;
+}
+
+size_t
+Sisyphus::Render::FrameStorage::get_depth_capacity() const
+{
+    return m_depth.capacity;
+}
+
+void
+Sisyphus::Render::FrameStorage::release()
+{
+    Base::AlignedBlockPool* pool = Base::AlignedBlockPool::instance();
+    pool->release(m_color);
+    pool->release(m_depth);
+    m_shrink_requests = 0;
+}
+
+Sisyphus::Render::FrameStorage::~FrameStorage()
+{
+    this->release();
+}
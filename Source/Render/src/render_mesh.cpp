@@ -0,0 +1,352 @@
+#include "render_mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+    std::atomic<uint64_t> s_next_buffer_id(1);
+
+    uint64_t
+    get_next_buffer_id()
+    {
+        return s_next_buffer_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    struct Edge {
+        uint64_t key; // smaller vertex in the high half
+        int      corner; // triangle * 3 + edge
+    };
+
+    uint64_t
+    get_edge_key(int a, int b)
+    {
+        return a < b ? ((uint64_t)(uint32_t)a << 32) | (uint32_t)b : ((uint64_t)(uint32_t)b << 32) | (uint32_t)a;
+    }
+} // namespace
+
+Sisyphus::Render::VertexBuffer::VertexBuffer(const VertexFormat& format)
+    : m_id(get_next_buffer_id())
+    , m_format(format)
+{}
+
+bool
+Sisyphus::Render::VertexBuffer::update(
+    const Base::vec4_t* coords, uint32_t vertex_count, const uint8_t* data, size_t data_size)
+{
+    if (data_size != vertex_count * m_format.size || (data == nullptr && data_size > 0) ||
+        (coords == nullptr && vertex_count > 0))
+    {
+        return false;
+    }
+    m_coords.assign(coords, coords + vertex_count);
+    m_data.assign(data, data + data_size);
+    m_version++;
+    return true;
+}
+
+uint64_t
+Sisyphus::Render::VertexBuffer::get_id() const
+{
+    return m_id;
+}
+
+uint64_t
+Sisyphus::Render::VertexBuffer::get_version() const
+{
+    return m_version;
+}
+
+const Sisyphus::Render::VertexFormat&
+Sisyphus::Render::VertexBuffer::get_format() const
+{
+    return m_format;
+}
+
+uint32_t
+Sisyphus::Render::VertexBuffer::get_vertex_count() const
+{
+    return (uint32_t)m_coords.size();
+}
+
+const std::vector<Sisyphus::Base::vec4_t>&
+Sisyphus::Render::VertexBuffer::get_coords() const
+{
+    return m_coords;
+}
+
+const std::vector<uint8_t>&
+Sisyphus::Render::VertexBuffer::get_data() const
+{
+    return m_data;
+}
+
+Sisyphus::Render::IndexBuffer::IndexBuffer(EPrimitiveType topology)
+    : m_id(get_next_buffer_id())
+    , m_topology(topology)
+{}
+
+bool
+Sisyphus::Render::IndexBuffer::update(const int* indices, uint32_t count, uint32_t vertex_count)
+{
+    bool restart_allowed = m_topology == EPrimitiveType::TRIANGLE_STRIP ||
+                           m_topology == EPrimitiveType::TRIANGLE_FAN || m_topology == EPrimitiveType::LINE_STRIP;
+    // the restart index of 16 bit storage is a valid 32 bit index, so it is kept out as well
+    bool fits_16 = true;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (indices[i] == -1 && restart_allowed)
+        {
+            continue;
+        }
+        if (indices[i] < 0 || (uint32_t)indices[i] >= vertex_count)
+        {
+            return false;
+        }
+        fits_16 = fits_16 && indices[i] < 0xffff;
+    }
+    m_count = count;
+    m_type = fits_16 ? EIndexType::UINT16 : EIndexType::UINT32;
+    m_indices16.clear();
+    m_indices32.clear();
+    if (fits_16)
+    {
+        m_indices16.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_indices16[i] = (uint16_t)indices[i]; // -1 turns into the 16 bit restart index
+        }
+    }
+    else
+    {
+        m_indices32.assign(indices, indices + count);
+    }
+    m_version++;
+    return true;
+}
+
+uint64_t
+Sisyphus::Render::IndexBuffer::get_id() const
+{
+    return m_id;
+}
+
+uint64_t
+Sisyphus::Render::IndexBuffer::get_version() const
+{
+    return m_version;
+}
+
+Sisyphus::Render::EPrimitiveType
+Sisyphus::Render::IndexBuffer::get_topology() const
+{
+    return m_topology;
+}
+
+Sisyphus::Render::EIndexType
+Sisyphus::Render::IndexBuffer::get_type() const
+{
+    return m_type;
+}
+
+uint32_t
+Sisyphus::Render::IndexBuffer::get_count() const
+{
+    return m_count;
+}
+
+const void*
+Sisyphus::Render::IndexBuffer::get_data() const
+{
+    return m_type == EIndexType::UINT16 ? (const void*)m_indices16.data() : (const void*)m_indices32.data();
+}
+
+Sisyphus::Render::GeometryView
+Sisyphus::Render::get_geometry_view(const VertexBuffer& vertices, const IndexBuffer& indices)
+{
+    GeometryView geometry;
+    geometry.topology = indices.get_topology();
+    geometry.coords = vertices.get_coords().data();
+    geometry.vertex_count = vertices.get_vertex_count();
+    geometry.indices = indices.get_data();
+    geometry.index_type = indices.get_type();
+    geometry.index_count = indices.get_count();
+    geometry.vertex_data = vertices.get_data().data();
+    return geometry;
+}
+
+std::vector<int>
+Sisyphus::Render::calculate_triangle_adjacency(const int* indices, uint32_t index_count)
+{
+    // edges sorted by their vertices, a shared edge is two neighbouring entries
+    std::vector<Edge> edges(index_count);
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        uint32_t next = i % 3 == 2 ? i - 2 : i + 1;
+        edges[i] = Edge {get_edge_key(indices[i], indices[next]), (int)i};
+    }
+    std::sort(
+        edges.begin(), edges.end(),
+        [](const Edge& a, const Edge& b)
+        {
+            return a.key < b.key || (a.key == b.key && a.corner < b.corner);
+        });
+    std::vector<int> adjacency(index_count, -1);
+    for (uint32_t i = 0; i + 1 < index_count; i++)
+    {
+        // non-manifold edges only connect their first two triangles
+        if (edges[i].key == edges[i + 1].key && (i == 0 || edges[i - 1].key != edges[i].key))
+        {
+            adjacency[edges[i].corner] = edges[i + 1].corner / 3;
+            adjacency[edges[i + 1].corner] = edges[i].corner / 3;
+        }
+    }
+    return adjacency;
+}
+
+std::vector<int>
+Sisyphus::Render::optimize_triangle_order(
+    const int* indices, uint32_t index_count, const std::vector<int>& adjacency)
+{
+    int                  triangle_count = (int)(index_count / 3);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<int>     order;
+    order.reserve(index_count);
+    auto get_open_neighbours = [&](int triangle)
+    {
+        int count = 0;
+        for (int e = 0; e < 3; e++)
+        {
+            int neighbour = adjacency[triangle * 3 + e];
+            count += neighbour >= 0 && !emitted[neighbour];
+        }
+        return count;
+    };
+    for (int seed = 0; seed < triangle_count; seed++)
+    {
+        // walk while there is a neighbour left, the one with the fewest open
+        // neighbours goes first so the walk does not leave isolated triangles
+        int triangle = seed;
+        while (triangle >= 0 && !emitted[triangle])
+        {
+            emitted[triangle] = 1;
+            order.insert(order.end(), indices + triangle * 3, indices + triangle * 3 + 3);
+            int next = -1;
+            int next_open = 4;
+            for (int e = 0; e < 3; e++)
+            {
+                int neighbour = adjacency[triangle * 3 + e];
+                if (neighbour >= 0 && !emitted[neighbour])
+                {
+                    int open = get_open_neighbours(neighbour);
+                    if (open < next_open)
+                    {
+                        next = neighbour;
+                        next_open = open;
+                    }
+                }
+            }
+            triangle = next;
+        }
+    }
+    return order;
+}
+
+Sisyphus::Render::Mesh::Mesh(const VertexFormat& format)
+    : m_vertices(format)
+{}
+
+std::shared_ptr<Sisyphus::Render::Mesh>
+Sisyphus::Render::create_mesh(
+    const Base::vec4_t* coords, uint32_t vertex_count, const uint8_t* data, size_t data_size,
+    const VertexFormat& format, const int* indices, uint32_t index_count, int max_meshlet_triangles)
+{
+    if (index_count == 0 || index_count % 3 != 0)
+    {
+        return nullptr;
+    }
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(format);
+    if (!mesh->m_vertices.update(coords, vertex_count, data, data_size))
+    {
+        return nullptr;
+    }
+    // order is optimized before the range check, so validate the input first
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        if (indices[i] < 0 || (uint32_t)indices[i] >= vertex_count)
+        {
+            return nullptr;
+        }
+    }
+    std::vector<int> adjacency = calculate_triangle_adjacency(indices, index_count);
+    std::vector<int> order = optimize_triangle_order(indices, index_count, adjacency);
+    mesh->m_indices.update(order.data(), index_count, vertex_count);
+    mesh->m_adjacency = calculate_triangle_adjacency(order.data(), index_count);
+    mesh->m_bounds = Base::calculate_bounds(mesh->m_vertices.get_coords());
+    mesh->m_max_meshlet_triangles = max_meshlet_triangles;
+    mesh->m_meshlets = build_meshlets(mesh->m_vertices.get_coords(), order, max_meshlet_triangles);
+    return mesh;
+}
+
+bool
+Sisyphus::Render::Mesh::update_vertices(const Base::vec4_t* coords, const uint8_t* data, size_t data_size)
+{
+    if (!m_vertices.update(coords, m_vertices.get_vertex_count(), data, data_size))
+    {
+        return false;
+    }
+    m_bounds = Base::calculate_bounds(m_vertices.get_coords());
+    // clusters are rebuilt from the order kept in the index buffer
+    std::vector<int> order(m_indices.get_count());
+    GeometryView     geometry = this->get_geometry_view();
+    for (uint32_t i = 0; i < geometry.index_count; i++)
+    {
+        order[i] = get_geometry_index(geometry, i);
+    }
+    m_meshlets = build_meshlets(m_vertices.get_coords(), order, m_max_meshlet_triangles);
+    m_version++;
+    return true;
+}
+
+const Sisyphus::Render::VertexBuffer&
+Sisyphus::Render::Mesh::get_vertex_buffer() const
+{
+    return m_vertices;
+}
+
+const Sisyphus::Render::IndexBuffer&
+Sisyphus::Render::Mesh::get_index_buffer() const
+{
+    return m_indices;
+}
+
+Sisyphus::Render::GeometryView
+Sisyphus::Render::Mesh::get_geometry_view() const
+{
+    return Render::get_geometry_view(m_vertices, m_indices);
+}
+
+const Sisyphus::Base::Bounds&
+Sisyphus::Render::Mesh::get_bounds() const
+{
+    return m_bounds;
+}
+
+const Sisyphus::Render::MeshletMesh&
+Sisyphus::Render::Mesh::get_meshlets() const
+{
+    return m_meshlets;
+}
+
+const std::vector<int>&
+Sisyphus::Render::Mesh::get_adjacency() const
+{
+    return m_adjacency;
+}
+
+uint64_t
+Sisyphus::Render::Mesh::get_version() const
+{
+    return m_version;
+}
@@ -0,0 +1,282 @@
+#include "render_meshlet.h"
+#include "render_culling.h"
+#include "render_occlusion.h"
+#include "render_pipeline_state.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    Sisyphus::Base::vec3_t
+    calculate_triangle_normal(
+        const Sisyphus::Base::vec4_t& a, const Sisyphus::Base::vec4_t& b, const Sisyphus::Base::vec4_t& c)
+    {
+        Sisyphus::Base::vec3_t n = (b.xyz - a.xyz).calculate_cross_product(c.xyz - a.xyz);
+        float                  length = n.calculate_magnitude();
+        if (length < Sisyphus::Base::eps)
+        {
+            return Sisyphus::Base::vec3_t {0.0f, 0.0f, 0.0f}; // degenerate, does not bend the cone
+        }
+        return n * (1.0f / length);
+    }
+
+    // appends triangles of the cluster to the reordered indices and calculates its volumes
+    void
+    add_meshlet(
+        const std::vector<Sisyphus::Base::vec4_t>& coords, const std::vector<int>& indices,
+        const std::vector<Sisyphus::Base::vec3_t>& normals, const std::vector<int>& triangles,
+        std::vector<Sisyphus::Base::vec3_t>& points, Sisyphus::Render::MeshletMesh& mesh)
+    {
+        Sisyphus::Render::Meshlet meshlet;
+        Sisyphus::Base::vec3_t    axis {0.0f, 0.0f, 0.0f};
+        meshlet.index_offset = (int)mesh.indices.size();
+        meshlet.triangle_count = (int)triangles.size();
+        points.clear();
+        for (int t : triangles)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                mesh.indices.push_back(indices[t * 3 + j]);
+                points.push_back(coords[indices[t * 3 + j]].xyz);
+            }
+            axis += normals[t];
+        }
+        meshlet.sphere = Sisyphus::Base::calculate_bounds(points).sphere;
+        float axis_length = axis.calculate_magnitude();
+        meshlet.cone_axis = Sisyphus::Base::vec3_t {0.0f, 0.0f, 1.0f};
+        meshlet.cone_cutoff = 0.0f;
+        if (axis_length > Sisyphus::Base::eps)
+        {
+            meshlet.cone_axis = axis * (1.0f / axis_length);
+            meshlet.cone_cutoff = 1.0f;
+            for (int t : triangles)
+            {
+                if (normals[t].calculate_dot_product(normals[t]) > 0.0f)
+                {
+                    float cutoff = normals[t].calculate_dot_product(meshlet.cone_axis);
+                    meshlet.cone_cutoff = std::min(meshlet.cone_cutoff, cutoff);
+                }
+            }
+        }
+        mesh.meshlets.push_back(meshlet);
+    }
+} // namespace
+
+Sisyphus::Render::MeshletMesh
+Sisyphus::Render::build_meshlets(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, int max_triangles)
+{
+    MeshletMesh mesh;
+    int         triangle_count = (int)indices.size() / 3;
+    int         vertex_count = (int)coords.size();
+    mesh.indices.reserve(triangle_count * 3);
+    mesh.bounds = Base::calculate_bounds(coords);
+    // equal positions share one id, adjacency is built over these ids
+    std::vector<int> sorted_vertices(vertex_count);
+    std::vector<int> position_ids(vertex_count);
+    for (int i = 0; i < vertex_count; i++)
+    {
+        sorted_vertices[i] = i;
+    }
+    std::sort(
+        sorted_vertices.begin(), sorted_vertices.end(),
+        [&coords](int a, int b)
+        {
+            const Base::vec4_t& u = coords[a];
+            const Base::vec4_t& v = coords[b];
+            return u.x != v.x ? u.x < v.x : (u.y != v.y ? u.y < v.y : u.z < v.z);
+        });
+    int position_count = 0;
+    for (int i = 0; i < vertex_count; i++)
+    {
+        const Base::vec4_t& u = coords[sorted_vertices[i]];
+        if (i > 0)
+        {
+            const Base::vec4_t& v = coords[sorted_vertices[i - 1]];
+            if (u.x != v.x || u.y != v.y || u.z != v.z)
+            {
+                position_count++;
+            }
+        }
+        position_ids[sorted_vertices[i]] = position_count;
+    }
+    position_count++;
+    // triangles around every position, packed into one array
+    std::vector<int> adjacency_offsets(position_count + 1, 0);
+    std::vector<int> adjacency(triangle_count * 3);
+    for (int i = 0; i < triangle_count * 3; i++)
+    {
+        adjacency_offsets[position_ids[indices[i]] + 1]++;
+    }
+    for (int i = 0; i < position_count; i++)
+    {
+        adjacency_offsets[i + 1] += adjacency_offsets[i];
+    }
+    std::vector<int> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (int i = 0; i < triangle_count * 3; i++)
+    {
+        adjacency[fill_offsets[position_ids[indices[i]]]++] = i / 3;
+    }
+    std::vector<Base::vec3_t> normals(triangle_count);
+    for (int t = 0; t < triangle_count; t++)
+    {
+        normals[t] = calculate_triangle_normal(
+            coords[indices[t * 3]], coords[indices[t * 3 + 1]], coords[indices[t * 3 + 2]]);
+    }
+    // grow every cluster from the first free triangle through shared positions,
+    // preferring triangles that add fewer new positions and keeping normals on
+    // one side so the cone stays useful
+    std::vector<bool>         used(triangle_count, false);
+    std::vector<int>          position_meshlet(position_count, -1);
+    std::vector<int>          triangles;
+    std::vector<int>          candidates;
+    std::vector<Base::vec3_t> points;
+    for (int seed = 0; seed < triangle_count; seed++)
+    {
+        if (used[seed])
+        {
+            continue;
+        }
+        int          meshlet_idx = (int)mesh.meshlets.size();
+        Base::vec3_t normal_sum {0.0f, 0.0f, 0.0f};
+        int          next = seed;
+        triangles.clear();
+        candidates.clear();
+        while (next >= 0)
+        {
+            used[next] = true;
+            triangles.push_back(next);
+            normal_sum += normals[next];
+            for (int j = 0; j < 3; j++)
+            {
+                int position = position_ids[indices[next * 3 + j]];
+                if (position_meshlet[position] == meshlet_idx)
+                {
+                    continue;
+                }
+                position_meshlet[position] = meshlet_idx;
+                for (int k = adjacency_offsets[position]; k < adjacency_offsets[position + 1]; k++)
+                {
+                    if (!used[adjacency[k]])
+                    {
+                        candidates.push_back(adjacency[k]);
+                    }
+                }
+            }
+            if ((int)triangles.size() >= max_triangles)
+            {
+                break;
+            }
+            next = -1;
+            int best_new_positions = 4;
+            int write = 0;
+            for (int i = 0; i < (int)candidates.size(); i++)
+            {
+                int t = candidates[i];
+                if (used[t])
+                {
+                    continue;
+                }
+                candidates[write++] = t;
+                if (normals[t].calculate_dot_product(normal_sum) < 0.0f)
+                {
+                    continue;
+                }
+                int new_positions = 0;
+                for (int j = 0; j < 3; j++)
+                {
+                    new_positions += position_meshlet[position_ids[indices[t * 3 + j]]] != meshlet_idx;
+                }
+                if (new_positions < best_new_positions)
+                {
+                    best_new_positions = new_positions;
+                    next = t;
+                }
+            }
+            candidates.resize(write);
+        }
+        add_meshlet(coords, indices, normals, triangles, points, mesh);
+    }
+    return mesh;
+}
+
+bool
+Sisyphus::Render::is_meshlet_visible(
+    const Meshlet& meshlet, const Base::mat4_t& model_view, const Frustum& frustum, ECullingMode culling)
+{
+    Base::BoundingSphere sphere = Base::transform_sphere(meshlet.sphere, model_view);
+    if (!is_sphere_visible(sphere, frustum))
+    {
+        return false;
+    }
+    if (culling == ECullingMode::None || meshlet.cone_cutoff <= 0.0f)
+    {
+        return true;
+    }
+    // triangles are dropped by is_culled_triangle when the normal looks away
+    // from the eye in counter clockwise mode and towards it in clockwise one
+    const Base::vec3_t& a = meshlet.cone_axis;
+    Base::vec3_t        axis {
+        model_view.r0.x * a.x + model_view.r0.y * a.y + model_view.r0.z * a.z,
+        model_view.r1.x * a.x + model_view.r1.y * a.y + model_view.r1.z * a.z,
+        model_view.r2.x * a.x + model_view.r2.y * a.y + model_view.r2.z * a.z,
+    };
+    float axis_length = axis.calculate_magnitude();
+    float distance = sphere.center.calculate_magnitude();
+    if (axis_length < Base::eps || distance <= sphere.radius)
+    {
+        return true;
+    }
+    if (culling == ECullingMode::ClockWise)
+    {
+        axis = axis * -1.0f;
+    }
+    // every normal within the cone makes an angle of at most phi + theta with the
+    // eye direction, the whole sphere is behind all planes when even the worst
+    // one keeps it farther than the radius
+    float cos_phi = sphere.center.calculate_dot_product(axis) / (axis_length * distance);
+    float sin_phi = sqrtf(std::max(0.0f, 1.0f - cos_phi * cos_phi));
+    float cos_theta = meshlet.cone_cutoff;
+    float sin_theta = sqrtf(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+    return (cos_phi * cos_theta - sin_phi * sin_theta) * distance <= sphere.radius;
+}
+
+void
+Sisyphus::Render::Context::draw_meshlets(
+    const std::vector<Base::vec4_t>& coords, const MeshletMesh& mesh, const uint8_t* vertex_data,
+    const VertexFormat& v_in_format, const VertexFormat& v_out_format)
+{
+    if (!this->is_visible(mesh.bounds))
+    {
+        return;
+    }
+    ECullingMode culling =
+        m_pipeline != nullptr ? m_pipeline->get_raster_state().backface_culling : m_backface_culling;
+    // clusters lie one after another in the index list, so neighbouring visible
+    // ones are drawn as one range in place; culled clusters are never shaded
+    GeometryView range(coords, mesh.indices, vertex_data);
+    range.index_count = 0;
+    for (const Meshlet& meshlet : mesh.meshlets)
+    {
+        if (!is_meshlet_visible(meshlet, m_model_view_matrix, m_frustum, culling) ||
+            (m_occlusion != nullptr && !m_occlusion->is_visible(meshlet.sphere, m_transform_matrix)))
+        {
+            continue;
+        }
+        if (range.index_count > 0 && range.index_offset + range.index_count != (uint32_t)meshlet.index_offset)
+        {
+            this->draw_triangles(range, v_in_format, v_out_format);
+            range.index_count = 0;
+        }
+        if (range.index_count == 0)
+        {
+            range.index_offset = (uint32_t)meshlet.index_offset;
+        }
+        range.index_count += meshlet.triangle_count * 3;
+    }
+    if (range.index_count > 0)
+    {
+        this->draw_triangles(range, v_in_format, v_out_format);
+    }
+}
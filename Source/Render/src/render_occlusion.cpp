@@ -0,0 +1,275 @@
+#include "render_occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const float    min_occlusion_w = 1e-3f; // closer to the eye is treated as crossing the near plane
+    const uint32_t full_tile_mask = 0xffffffffu;
+
+    struct ScreenVertex {
+        float x;
+        float y;
+        float z; // 1/w
+    };
+
+    bool
+    project_vertex(
+        const Sisyphus::Base::vec4_t& v, const Sisyphus::Base::mat4_t& transform, int width, int height,
+        ScreenVertex& out)
+    {
+        Sisyphus::Base::vec4_t c = transform * v;
+        if (c.w < min_occlusion_w)
+        {
+            return false;
+        }
+        // same mapping as Context::process_vertex, y goes down
+        float inv_w = 1.0f / c.w;
+        out.x = (c.x * inv_w + 1.0f) * 0.5f * width;
+        out.y = (1.0f - c.y * inv_w) * 0.5f * height;
+        out.z = inv_w;
+        return true;
+    }
+
+    // bits of the pixels in [x0, x1] x [y0, y1] of one tile, bit = row * 8 + column
+    uint32_t
+    get_rect_mask(int x0, int y0, int x1, int y1)
+    {
+        uint32_t row = ((1u << (x1 - x0 + 1)) - 1) << x0;
+        uint32_t mask = 0;
+        for (int y = y0; y <= y1; y++)
+        {
+            mask |= row << (y * Sisyphus::Render::occlusion_tile_width);
+        }
+        return mask;
+    }
+} // namespace
+
+Sisyphus::Render::OcclusionBuffer::OcclusionBuffer(int width, int height)
+{
+    this->resize(width, height);
+}
+
+void
+Sisyphus::Render::OcclusionBuffer::resize(int width, int height)
+{
+    m_tiles_x = (std::max(width, 1) + occlusion_tile_width - 1) / occlusion_tile_width;
+    m_tiles_y = (std::max(height, 1) + occlusion_tile_height - 1) / occlusion_tile_height;
+    m_width = m_tiles_x * occlusion_tile_width;
+    m_height = m_tiles_y * occlusion_tile_height;
+    m_tiles.resize(m_tiles_x * m_tiles_y);
+    this->clear();
+}
+
+void
+Sisyphus::Render::OcclusionBuffer::clear()
+{
+    std::fill(m_tiles.begin(), m_tiles.end(), OcclusionTile {0, 0.0f, 0.0f});
+}
+
+int
+Sisyphus::Render::OcclusionBuffer::get_width() const
+{
+    return m_width;
+}
+
+int
+Sisyphus::Render::OcclusionBuffer::get_height() const
+{
+    return m_height;
+}
+
+void
+Sisyphus::Render::OcclusionBuffer::update_tile(OcclusionTile& tile, uint32_t coverage, float z)
+{
+    if (z <= tile.z0)
+    {
+        return; // does not move anything closer, skipping is always safe
+    }
+    if (tile.mask == 0 || z - tile.z1 > tile.z1 - tile.z0)
+    {
+        // the triangle is far in front of the working layer, start a new one from it
+        tile.mask = coverage;
+        tile.z1 = z;
+    }
+    else
+    {
+        tile.mask |= coverage;
+        tile.z1 = std::min(tile.z1, z);
+    }
+    if (tile.mask == full_tile_mask)
+    {
+        tile.z0 = tile.z1;
+        tile.mask = 0;
+        tile.z1 = 0.0f;
+    }
+}
+
+void
+Sisyphus::Render::OcclusionBuffer::render_occluder(
+    const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices, const Base::mat4_t& transform)
+{
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        ScreenVertex v[3];
+        if (!project_vertex(coords[indices[i]], transform, m_width, m_height, v[0]) ||
+            !project_vertex(coords[indices[i + 1]], transform, m_width, m_height, v[1]) ||
+            !project_vertex(coords[indices[i + 2]], transform, m_width, m_height, v[2]))
+        {
+            continue;
+        }
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (fabs(area) < 1e-6f)
+        {
+            continue;
+        }
+        if (area < 0.0f)
+        {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+        // edge i is positive inside: a * x + b * y + c >= 0
+        float a[3], b[3], c[3];
+        for (int e = 0; e < 3; e++)
+        {
+            const ScreenVertex& p = v[e];
+            const ScreenVertex& q = v[(e + 1) % 3];
+            a[e] = p.y - q.y;
+            b[e] = q.x - p.x;
+            c[e] = p.x * q.y - p.y * q.x;
+        }
+        // 1/w is linear in screen space
+        float za = (a[1] * v[0].z + a[2] * v[1].z + a[0] * v[2].z) / area;
+        float zb = (b[1] * v[0].z + b[2] * v[1].z + b[0] * v[2].z) / area;
+        float zc = (c[1] * v[0].z + c[2] * v[1].z + c[0] * v[2].z) / area;
+        float z_min = std::min(v[0].z, std::min(v[1].z, v[2].z));
+        float z_max = std::max(v[0].z, std::max(v[1].z, v[2].z));
+        int   x_min = std::max(0, (int)floorf(std::min(v[0].x, std::min(v[1].x, v[2].x))));
+        int   y_min = std::max(0, (int)floorf(std::min(v[0].y, std::min(v[1].y, v[2].y))));
+        int   x_max = std::min(m_width - 1, (int)ceilf(std::max(v[0].x, std::max(v[1].x, v[2].x))));
+        int   y_max = std::min(m_height - 1, (int)ceilf(std::max(v[0].y, std::max(v[1].y, v[2].y))));
+        if (x_min > x_max || y_min > y_max)
+        {
+            continue;
+        }
+        for (int ty = y_min / occlusion_tile_height; ty <= y_max / occlusion_tile_height; ty++)
+        {
+            for (int tx = x_min / occlusion_tile_width; tx <= x_max / occlusion_tile_width; tx++)
+            {
+                // pixel centers of the tile corners
+                float x0 = tx * occlusion_tile_width + 0.5f;
+                float y0 = ty * occlusion_tile_height + 0.5f;
+                float x1 = x0 + occlusion_tile_width - 1;
+                float y1 = y0 + occlusion_tile_height - 1;
+                bool  outside = false;
+                bool  inside = true;
+                for (int e = 0; e < 3; e++)
+                {
+                    float e_max = c[e] + (a[e] > 0.0f ? a[e] * x1 : a[e] * x0) + (b[e] > 0.0f ? b[e] * y1 : b[e] * y0);
+                    float e_min = c[e] + (a[e] > 0.0f ? a[e] * x0 : a[e] * x1) + (b[e] > 0.0f ? b[e] * y0 : b[e] * y1);
+                    outside = outside || e_max < 0.0f;
+                    inside = inside && e_min >= 0.0f;
+                }
+                if (outside)
+                {
+                    continue;
+                }
+                uint32_t coverage = full_tile_mask;
+                if (!inside)
+                {
+                    coverage = 0;
+                    for (int row = 0; row < occlusion_tile_height; row++)
+                    {
+                        float y = y0 + row;
+                        float e0 = a[0] * x0 + b[0] * y + c[0];
+                        float e1 = a[1] * x0 + b[1] * y + c[1];
+                        float e2 = a[2] * x0 + b[2] * y + c[2];
+                        for (int column = 0; column < occlusion_tile_width; column++)
+                        {
+                            if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+                            {
+                                coverage |= 1u << (row * occlusion_tile_width + column);
+                            }
+                            e0 += a[0];
+                            e1 += a[1];
+                            e2 += a[2];
+                        }
+                    }
+                    if (coverage == 0)
+                    {
+                        continue;
+                    }
+                }
+                // farthest depth of the triangle over the tile, kept within the depths of its
+                // vertices - rounding of the plane must not put it in front of the triangle
+                float z_tile = std::min(
+                    std::min(za * x0 + zb * y0 + zc, za * x1 + zb * y0 + zc),
+                    std::min(za * x0 + zb * y1 + zc, za * x1 + zb * y1 + zc));
+                this->update_tile(m_tiles[ty * m_tiles_x + tx], coverage, std::min(std::max(z_tile, z_min), z_max));
+            }
+        }
+    }
+}
+
+bool
+Sisyphus::Render::OcclusionBuffer::is_visible(const Base::BoundingBox& box, const Base::mat4_t& transform) const
+{
+    float x_min = INFINITY, y_min = INFINITY, x_max = -INFINITY, y_max = -INFINITY;
+    float z_max = 0.0f; // nearest point of the box
+    for (int i = 0; i < 8; i++)
+    {
+        Base::vec4_t corner {
+            (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z, 1.0f};
+        ScreenVertex v;
+        if (!project_vertex(corner, transform, m_width, m_height, v))
+        {
+            return true; // crosses the near plane
+        }
+        x_min = std::min(x_min, v.x);
+        y_min = std::min(y_min, v.y);
+        x_max = std::max(x_max, v.x);
+        y_max = std::max(y_max, v.y);
+        z_max = std::max(z_max, v.z);
+    }
+    // every pixel the box touches, not only the covered centers
+    int px0 = std::max(0, (int)floorf(x_min));
+    int py0 = std::max(0, (int)floorf(y_min));
+    int px1 = std::min(m_width - 1, (int)floorf(x_max));
+    int py1 = std::min(m_height - 1, (int)floorf(y_max));
+    if (px0 > px1 || py0 > py1)
+    {
+        return true; // off screen, left to the frustum test
+    }
+    for (int ty = py0 / occlusion_tile_height; ty <= py1 / occlusion_tile_height; ty++)
+    {
+        int row0 = std::max(py0 - ty * occlusion_tile_height, 0);
+        int row1 = std::min(py1 - ty * occlusion_tile_height, occlusion_tile_height - 1);
+        for (int tx = px0 / occlusion_tile_width; tx <= px1 / occlusion_tile_width; tx++)
+        {
+            const OcclusionTile& tile = m_tiles[ty * m_tiles_x + tx];
+            if (z_max < tile.z0)
+            {
+                continue;
+            }
+            int      column0 = std::max(px0 - tx * occlusion_tile_width, 0);
+            int      column1 = std::min(px1 - tx * occlusion_tile_width, occlusion_tile_width - 1);
+            uint32_t rect_mask = get_rect_mask(column0, row0, column1, row1);
+            if (tile.mask != 0 && (rect_mask & ~tile.mask) == 0 && z_max < tile.z1)
+            {
+                continue;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+Sisyphus::Render::OcclusionBuffer::is_visible(const Base::BoundingSphere& sphere, const Base::mat4_t& transform) const
+{
+    Base::BoundingBox box;
+    box.min = sphere.center - sphere.radius;
+    box.max = sphere.center + sphere.radius;
+    return this->is_visible(box, transform);
+}
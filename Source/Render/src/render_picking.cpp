@@ -0,0 +1,89 @@
+#include "render_context.h"
+
+#include <algorithm>
+
+void
+Sisyphus::Render::Context::update_id_buffers()
+{
+    size_t pixel_count = (size_t)m_width * m_height;
+    if (m_keep_object_ids)
+    {
+        m_object_ids.resize(pixel_count, 0);
+        m_object_id_data = m_object_ids.data();
+    }
+    else
+    {
+        std::vector<uint32_t>().swap(m_object_ids);
+        m_object_id_data = nullptr;
+    }
+    if (m_keep_object_ids && m_keep_primitive_ids)
+    {
+        m_primitive_ids.resize(pixel_count, 0);
+        m_primitive_id_data = m_primitive_ids.data();
+    }
+    else
+    {
+        std::vector<uint32_t>().swap(m_primitive_ids);
+        m_primitive_id_data = nullptr;
+    }
+}
+
+void
+Sisyphus::Render::Context::set_id_buffer(bool object_ids, bool primitive_ids)
+{
+    m_keep_object_ids = object_ids;
+    m_keep_primitive_ids = primitive_ids;
+    this->update_id_buffers();
+}
+
+void
+Sisyphus::Render::Context::set_object_id(uint32_t id)
+{
+    m_object_id = id;
+    m_pixel_object_id = id;
+}
+
+uint32_t
+Sisyphus::Render::Context::get_object_id() const
+{
+    return m_object_id;
+}
+
+bool
+Sisyphus::Render::Context::pick(int x, int y, PickResult& result) const
+{
+    return this->pick(ScreenRect {x, y, x + 1, y + 1}, result);
+}
+
+bool
+Sisyphus::Render::Context::pick(const ScreenRect& rect, PickResult& result) const
+{
+    if (m_object_id_data == nullptr)
+    {
+        return false;
+    }
+    int  x_min = std::max(rect.x_min, 0);
+    int  y_min = std::max(rect.y_min, 0);
+    int  x_max = std::min(rect.x_max, m_width);
+    int  y_max = std::min(rect.y_max, m_height);
+    bool found = false;
+    for (int y = y_min; y < y_max; y++)
+    {
+        for (int x = x_min; x < x_max; x++)
+        {
+            int idx = y * m_width + x;
+            // reverse z - the nearest pixel has the largest depth
+            if (m_object_id_data[idx] == 0 || (found && m_depth[idx] <= result.depth))
+            {
+                continue;
+            }
+            result.object_id = m_object_id_data[idx];
+            result.primitive_id = m_primitive_id_data != nullptr ? m_primitive_id_data[idx] : 0;
+            result.depth = m_depth[idx];
+            result.x = x;
+            result.y = y;
+            found = true;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,64 @@
+#include "render_pipeline_state.h"
+
+#include <cassert>
+
+int
+Sisyphus::Render::get_pipeline_variant(
+    ECullingMode backface_culling, bool depth_test, bool depth_write, EBlendMode blend, bool wireframe)
+{
+    // line loops are the lowest bits - depth test, depth write and blend
+    int variant = (((int)wireframe * 3 + (int)backface_culling) * 2 + (int)depth_test) * 2 + (int)depth_write;
+    variant = variant * 2 + (int)blend;
+    assert(variant >= 0 && variant < pipeline_variant_count);
+    return variant;
+}
+
+Sisyphus::Render::PipelineState::PipelineState(
+    VertexShaderFunc vsf, PixelShaderFunc psf, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const RasterState& raster)
+    : m_vsf(vsf)
+    , m_psf(psf)
+    , m_v_in_format(v_in_format)
+    , m_v_out_format(v_out_format)
+    , m_raster(raster)
+{
+    assert(m_vsf != nullptr && m_psf != nullptr);
+    m_variant = get_pipeline_variant(
+        raster.backface_culling, raster.depth_test, raster.depth_write, raster.blend, raster.wireframe);
+}
+
+Sisyphus::Render::VertexShaderFunc
+Sisyphus::Render::PipelineState::get_vertex_shader() const
+{
+    return m_vsf;
+}
+
+Sisyphus::Render::PixelShaderFunc
+Sisyphus::Render::PipelineState::get_pixel_shader() const
+{
+    return m_psf;
+}
+
+const Sisyphus::Render::VertexFormat&
+Sisyphus::Render::PipelineState::get_vertex_input_format() const
+{
+    return m_v_in_format;
+}
+
+const Sisyphus::Render::VertexFormat&
+Sisyphus::Render::PipelineState::get_vertex_output_format() const
+{
+    return m_v_out_format;
+}
+
+const Sisyphus::Render::RasterState&
+Sisyphus::Render::PipelineState::get_raster_state() const
+{
+    return m_raster;
+}
+
+int
+Sisyphus::Render::PipelineState::get_variant() const
+{
+    return m_variant;
+}
@@ -0,0 +1,213 @@
+#include "render_query.h"
+#include "render_context.h"
+#include "render_culling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    // corners of the face of a box, corner index bits are x, y and z of max
+    void
+    get_face_corners(int axis, int side, int corners[4])
+    {
+        int u = 1 << ((axis + 1) % 3);
+        int v = 1 << ((axis + 2) % 3);
+        int base = side << axis;
+        corners[0] = base;
+        corners[1] = base | u;
+        corners[2] = base | u | v;
+        corners[3] = base | v;
+    }
+} // namespace
+
+Sisyphus::Render::OcclusionQuery::OcclusionQuery()
+    : m_samples(0)
+    , m_frame(0)
+    , m_ready(false)
+{
+}
+
+bool
+Sisyphus::Render::OcclusionQuery::get_result(uint64_t& samples) const
+{
+    if (!m_ready.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    samples = m_samples.load(std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t
+Sisyphus::Render::OcclusionQuery::get_frame() const
+{
+    return m_frame.load(std::memory_order_acquire);
+}
+
+bool
+Sisyphus::Render::OcclusionQuery::is_hidden() const
+{
+    uint64_t samples = 0;
+    return this->get_result(samples) && samples == 0;
+}
+
+void
+Sisyphus::Render::OcclusionQuery::reset()
+{
+    m_ready.store(false, std::memory_order_release);
+}
+
+void
+Sisyphus::Render::Context::begin_query(OcclusionQuery* query)
+{
+    assert(m_active_query == nullptr); // queries do not nest
+    m_active_query = query;
+    m_query_samples = 0;
+}
+
+void
+Sisyphus::Render::Context::end_query()
+{
+    if (m_active_query == nullptr)
+    {
+        return;
+    }
+    m_active_query->m_samples.store(m_query_samples, std::memory_order_relaxed);
+    m_active_query->m_frame.store(m_frame_index, std::memory_order_relaxed);
+    m_active_query->m_ready.store(true, std::memory_order_release);
+    m_active_query = nullptr;
+}
+
+void
+Sisyphus::Render::Context::draw_query_proxy(const Base::BoundingBox& box)
+{
+    if (!is_box_visible(Base::transform_box(box, m_model_view_matrix), m_frustum))
+    {
+        return;
+    }
+    Base::vec4_t view[8];
+    Base::vec4_t screen[8];
+    Base::vec3_t center {0.0f, 0.0f, 0.0f};
+    const Plane& znear = m_frustum.bounds[0];
+    for (int i = 0; i < 8; i++)
+    {
+        Base::vec4_t corner {
+            (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z, 1.0f};
+        view[i] = m_model_view_matrix * corner;
+        if (znear.normal.calculate_dot_product(view[i].xyz) + znear.offset > 0.0f)
+        {
+            // the camera may be inside, never report such a box hidden
+            m_query_samples++;
+            return;
+        }
+        screen[i] = this->process_vertex(view[i]);
+        center += view[i].xyz;
+    }
+    center = center * 0.125f;
+    // only faces turned to the camera - they hide the rest of the box
+    for (int f = 0; f < 6; f++)
+    {
+        int corners[4];
+        get_face_corners(f >> 1, f & 1, corners);
+        Base::vec3_t face_center =
+            (view[corners[0]].xyz + view[corners[1]].xyz + view[corners[2]].xyz + view[corners[3]].xyz) * 0.25f;
+        Base::vec3_t normal = (view[corners[1]].xyz - view[corners[0]].xyz)
+                                  .calculate_cross_product(view[corners[3]].xyz - view[corners[0]].xyz);
+        if (normal.calculate_dot_product(face_center - center) < 0.0f)
+        {
+            normal = normal * -1.0f;
+        }
+        if (normal.calculate_dot_product(face_center) >= 0.0f)
+        {
+            continue;
+        }
+        for (int t = 0; t < 2; t++)
+        {
+            const Base::vec4_t& a = screen[corners[0]];
+            const Base::vec4_t& b = screen[corners[t + 1]];
+            const Base::vec4_t& c = screen[corners[t + 2]];
+            float               area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+            if (fabs(area) < Base::eps)
+            {
+                continue;
+            }
+            // depth is linear in screen space, so a plane through the three vertices
+            float za = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+            float zb = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+            int   x_min = std::max(0, (int)floorf(std::min(a.x, std::min(b.x, c.x))));
+            int   y_min = std::max(0, (int)floorf(std::min(a.y, std::min(b.y, c.y))));
+            int   x_max = std::min(m_width - 1, (int)ceilf(std::max(a.x, std::max(b.x, c.x))));
+            int   y_max = std::min(m_height - 1, (int)ceilf(std::max(a.y, std::max(b.y, c.y))));
+            float sign = area > 0.0f ? 1.0f : -1.0f;
+            for (int y = y_min; y <= y_max; y++)
+            {
+                float py = y + 0.5f;
+                for (int x = x_min; x <= x_max; x++)
+                {
+                    float px = x + 0.5f;
+                    float e0 = ((b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x)) * sign;
+                    float e1 = ((c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x)) * sign;
+                    float e2 = ((a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x)) * sign;
+                    if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+                    {
+                        continue;
+                    }
+                    // the proxy touching the surface it bounds still counts
+                    float z = a.z + za * (px - a.x) + zb * (py - a.y);
+                    if (z >= m_depth[y * m_width + x])
+                    {
+                        m_query_samples++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void
+Sisyphus::Render::Context::draw_lines_conditional(
+    const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+    const uint8_t* vertex_data, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const Base::Bounds* bounds)
+{
+    if (!query.is_hidden())
+    {
+        this->draw_lines(coords, indices, vertex_data, v_in_format, v_out_format, bounds);
+    }
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_conditional(
+    const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+    const uint8_t* vertex_data, const VertexFormat& v_in_format, const VertexFormat& v_out_format,
+    const Base::Bounds* bounds)
+{
+    if (!query.is_hidden())
+    {
+        this->draw_triangles(coords, indices, vertex_data, v_in_format, v_out_format, bounds);
+    }
+}
+
+void
+Sisyphus::Render::Context::draw_lines_conditional(
+    const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+    const uint8_t* vertex_data, const Base::Bounds* bounds)
+{
+    if (!query.is_hidden())
+    {
+        this->draw_lines(coords, indices, vertex_data, bounds);
+    }
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_conditional(
+    const OcclusionQuery& query, const std::vector<Base::vec4_t>& coords, const std::vector<int>& indices,
+    const uint8_t* vertex_data, const Base::Bounds* bounds)
+{
+    if (!query.is_hidden())
+    {
+        this->draw_triangles(coords, indices, vertex_data, bounds);
+    }
+}
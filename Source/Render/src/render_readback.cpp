@@ -0,0 +1,285 @@
+#include "render_readback.h"
+#include "render_context.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SISYPHUS_READBACK_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // frames are 4 bytes per pixel - b, g, r, a
+    const int frame_pixel_size = 4;
+
+    // width output pixels of factor x factor blocks, src_stride is the frame row size
+    void
+    downscale_row(const uint8_t* src, int src_stride, int factor, int width, uint8_t* out)
+    {
+        int x = 0;
+#if SISYPHUS_READBACK_SSE
+        __m128i zero = _mm_setzero_si128();
+        if (factor == 2)
+        {
+            // 4 pixels of 2 rows into 2
+            __m128i round = _mm_set1_epi16(2);
+            for (; x + 2 <= width; x += 2)
+            {
+                const uint8_t* p = src + x * 2 * frame_pixel_size;
+                __m128i        r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i        r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + src_stride));
+                __m128i        lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+                __m128i        hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+                lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * frame_pixel_size), _mm_packus_epi16(sum, sum));
+            }
+        }
+        else if (factor == 4)
+        {
+            // 4 pixels of 4 rows into 1, sums of 16 bytes fit 16 bit lanes
+            __m128i round = _mm_set1_epi16(8);
+            for (; x < width; x++)
+            {
+                const uint8_t* p = src + x * 4 * frame_pixel_size;
+                __m128i        sum = zero;
+                for (int r = 0; r < 4; r++)
+                {
+                    __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + r * src_stride));
+                    sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(row, zero), _mm_unpackhi_epi8(row, zero)));
+                }
+                sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 4);
+                int pixel = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+                memcpy(out + x * frame_pixel_size, &pixel, frame_pixel_size);
+            }
+        }
+#endif
+        int area = factor * factor;
+        for (; x < width; x++)
+        {
+            const uint8_t* p = src + x * factor * frame_pixel_size;
+            for (int c = 0; c < frame_pixel_size; c++)
+            {
+                int sum = 0;
+                for (int r = 0; r < factor; r++)
+                {
+                    for (int i = 0; i < factor; i++)
+                    {
+                        sum += p[r * src_stride + i * frame_pixel_size + c];
+                    }
+                }
+                out[x * frame_pixel_size + c] = (uint8_t)((sum + area / 2) / area);
+            }
+        }
+    }
+
+    void
+    convert_row(const uint8_t* bgra, int width, Sisyphus::Render::EReadbackFormat format, uint8_t* out)
+    {
+        int x = 0;
+        switch (format)
+        {
+        case Sisyphus::Render::EReadbackFormat::BGRA8:
+            memcpy(out, bgra, (size_t)width * frame_pixel_size);
+            break;
+        case Sisyphus::Render::EReadbackFormat::RGBA8:
+        {
+#if SISYPHUS_READBACK_SSE
+            // b and r swap places inside every 32 bit lane
+            __m128i ga_mask = _mm_set1_epi32((int)0xff00ff00);
+            __m128i low_mask = _mm_set1_epi32(0xff);
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + x * frame_pixel_size));
+                __m128i b = _mm_slli_epi32(_mm_and_si128(v, low_mask), 16);
+                __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), low_mask);
+                v = _mm_or_si128(_mm_and_si128(v, ga_mask), _mm_or_si128(b, r));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * frame_pixel_size), v);
+            }
+#endif
+            for (; x < width; x++)
+            {
+                const uint8_t* p = bgra + x * frame_pixel_size;
+                uint8_t*       o = out + x * frame_pixel_size;
+                o[0] = p[2];
+                o[1] = p[1];
+                o[2] = p[0];
+                o[3] = p[3];
+            }
+            break;
+        }
+        case Sisyphus::Render::EReadbackFormat::RGB8:
+            for (; x < width; x++)
+            {
+                const uint8_t* p = bgra + x * frame_pixel_size;
+                out[x * 3 + 0] = p[2];
+                out[x * 3 + 1] = p[1];
+                out[x * 3 + 2] = p[0];
+            }
+            break;
+        case Sisyphus::Render::EReadbackFormat::GRAY8:
+        {
+#if SISYPHUS_READBACK_SSE
+            // b * 29 + g * 150 and r * 77 per pixel from madd, then the two halves are added
+            __m128i zero = _mm_setzero_si128();
+            __m128i weights = _mm_set_epi16(0, 77, 150, 29, 0, 77, 150, 29);
+            __m128i round = _mm_set1_epi32(128);
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + x * frame_pixel_size));
+                __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+                __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+                lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+                hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+                __m128i luma = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(lo, hi), round), 8);
+                luma = _mm_packs_epi32(luma, luma);
+                int pixels = _mm_cvtsi128_si32(_mm_packus_epi16(luma, luma));
+                memcpy(out + x, &pixels, 4);
+            }
+#endif
+            for (; x < width; x++)
+            {
+                const uint8_t* p = bgra + x * frame_pixel_size;
+                out[x] = (uint8_t)((p[0] * 29 + p[1] * 150 + p[2] * 77 + 128) >> 8);
+            }
+            break;
+        }
+        }
+    }
+
+    void
+    read_rows(
+        const uint8_t* frame, int frame_width, const Sisyphus::Render::ReadbackDesc& desc,
+        const Sisyphus::Render::ScreenRect& rect, int width, uint8_t* dst, int stride, int row_begin, int row_end)
+    {
+        static thread_local std::vector<uint8_t> scratch;
+        int                                      frame_stride = frame_width * frame_pixel_size;
+        scratch.resize((size_t)width * frame_pixel_size);
+        for (int y = row_begin; y < row_end; y++)
+        {
+            const uint8_t* src =
+                frame + ((size_t)(rect.y_min + y * desc.downscale) * frame_width + rect.x_min) * frame_pixel_size;
+            uint8_t* out = dst + (size_t)y * stride;
+            if (desc.downscale == 1)
+            {
+                convert_row(src, width, desc.format, out);
+            }
+            else if (desc.format == Sisyphus::Render::EReadbackFormat::BGRA8)
+            {
+                downscale_row(src, frame_stride, desc.downscale, width, out);
+            }
+            else
+            {
+                downscale_row(src, frame_stride, desc.downscale, width, scratch.data());
+                convert_row(scratch.data(), width, desc.format, out);
+            }
+        }
+    }
+} // namespace
+
+int
+Sisyphus::Render::get_readback_pixel_size(EReadbackFormat format)
+{
+    switch (format)
+    {
+    case EReadbackFormat::BGRA8:
+    case EReadbackFormat::RGBA8:
+        return 4;
+    case EReadbackFormat::RGB8:
+        return 3;
+    case EReadbackFormat::GRAY8:
+        return 1;
+    }
+    return 0;
+}
+
+bool
+Sisyphus::Render::get_readback_size(
+    const ReadbackDesc& desc, int frame_width, int frame_height, int& width, int& height)
+{
+    ScreenRect rect = desc.rect;
+    if (rect.x_min >= rect.x_max || rect.y_min >= rect.y_max)
+    {
+        rect = ScreenRect {0, 0, frame_width, frame_height};
+    }
+    if (rect.x_min < 0 || rect.y_min < 0 || rect.x_max > frame_width || rect.y_max > frame_height)
+    {
+        return false;
+    }
+    if (desc.downscale != 1 && desc.downscale != 2 && desc.downscale != 4)
+    {
+        return false;
+    }
+    width = (rect.x_max - rect.x_min) / desc.downscale;
+    height = (rect.y_max - rect.y_min) / desc.downscale;
+    return width > 0 && height > 0;
+}
+
+bool
+Sisyphus::Render::read_frame_region(
+    const uint8_t* frame, int frame_width, int frame_height, const ReadbackDesc& desc, uint8_t* dst,
+    size_t dst_size)
+{
+    int width = 0;
+    int height = 0;
+    if (frame == nullptr || !get_readback_size(desc, frame_width, frame_height, width, height))
+    {
+        return false;
+    }
+    int row_size = width * get_readback_pixel_size(desc.format);
+    int stride = desc.stride != 0 ? desc.stride : row_size;
+    if (stride < row_size || dst_size < (size_t)stride * (height - 1) + row_size)
+    {
+        return false;
+    }
+    ScreenRect rect = desc.rect;
+    if (rect.x_min >= rect.x_max || rect.y_min >= rect.y_max)
+    {
+        rect = ScreenRect {0, 0, frame_width, frame_height};
+    }
+    int thread_count = std::min(std::max(desc.thread_count, 1), height);
+    int rows_per_thread = (height + thread_count - 1) / thread_count;
+    std::vector<std::thread> workers;
+    for (int row = rows_per_thread; row < height; row += rows_per_thread)
+    {
+        workers.emplace_back(
+            read_rows, frame, frame_width, std::cref(desc), std::cref(rect), width, dst, stride, row,
+            std::min(row + rows_per_thread, height));
+    }
+    read_rows(frame, frame_width, desc, rect, width, dst, stride, 0, std::min(rows_per_thread, height));
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    return true;
+}
+
+bool
+Sisyphus::Render::read_frame_region(const FrameBuffer& frame, const ReadbackDesc& desc, uint8_t* dst, size_t dst_size)
+{
+    if (frame.bytes_per_pixel != frame_pixel_size)
+    {
+        return false;
+    }
+    return read_frame_region(frame.get_data(), frame.width, frame.height, desc, dst, dst_size);
+}
+
+bool
+Sisyphus::Render::Context::read_frame(const ReadbackDesc& desc, uint8_t* dst, size_t dst_size)
+{
+    // held while reading, so presents from another thread don't render into it
+    const FrameBuffer* frame = m_swapchain.acquire_frame();
+    if (frame == nullptr)
+    {
+        return false;
+    }
+    bool result = read_frame_region(*frame, desc, dst, dst_size);
+    m_swapchain.release_frame(frame);
+    return result;
+}
@@ -0,0 +1,217 @@
+#include "render_resolution_governor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SISYPHUS_UPSCALE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // blend weights are 7 bit, so (b - a) * weight fits 16 bit lanes
+    const int weight_bits = 7;
+    const int weight_one = 1 << weight_bits;
+
+    int64_t
+    get_time_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // source sample position of a destination pixel center
+    void
+    get_sample(int dst, int dst_size, int src_size, int& src, int& weight)
+    {
+        float pos = ((float)dst + 0.5f) * (float)src_size / (float)dst_size - 0.5f;
+        pos = std::min(std::max(pos, 0.0f), (float)(src_size - 1));
+        src = std::min((int)pos, src_size - 1);
+        weight = (int)((pos - (float)src) * (float)weight_one + 0.5f);
+    }
+
+    void
+    blend_rows(const uint8_t* row0, const uint8_t* row1, int weight, int16_t* out, int size)
+    {
+        int i = 0;
+#if SISYPHUS_UPSCALE_SSE
+        __m128i zero = _mm_setzero_si128();
+        __m128i w = _mm_set1_epi16((int16_t)weight);
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+            __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+            __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+            __m128i d_lo = _mm_sub_epi16(_mm_unpacklo_epi8(b, zero), a_lo);
+            __m128i d_hi = _mm_sub_epi16(_mm_unpackhi_epi8(b, zero), a_hi);
+            a_lo = _mm_add_epi16(a_lo, _mm_srai_epi16(_mm_mullo_epi16(d_lo, w), weight_bits));
+            a_hi = _mm_add_epi16(a_hi, _mm_srai_epi16(_mm_mullo_epi16(d_hi, w), weight_bits));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), a_lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), a_hi);
+        }
+#endif
+        for (; i < size; i++)
+        {
+            out[i] = (int16_t)(row0[i] + (((row1[i] - row0[i]) * weight) >> weight_bits));
+        }
+    }
+} // namespace
+
+Sisyphus::Render::ResolutionGovernor::ResolutionGovernor(const ResolutionGovernorSettings& settings)
+    : m_settings(settings)
+    , m_scale(settings.max_scale)
+{
+    assert(settings.min_scale > 0.0f && settings.min_scale <= settings.max_scale && settings.scale_step > 0.0f);
+}
+
+void
+Sisyphus::Render::ResolutionGovernor::begin_frame()
+{
+    m_frame_start = get_time_ns();
+}
+
+void
+Sisyphus::Render::ResolutionGovernor::end_frame()
+{
+    this->add_frame_time((float)(get_time_ns() - m_frame_start) * 1e-6f);
+}
+
+void
+Sisyphus::Render::ResolutionGovernor::add_frame_time(float ms)
+{
+    if (m_measured_frames == 0)
+    {
+        m_average_ms = ms;
+    }
+    else
+    {
+        m_average_ms += m_settings.smoothing * (ms - m_average_ms);
+    }
+    m_measured_frames++;
+    if (m_measured_frames < m_settings.settle_frames)
+    {
+        return;
+    }
+    float scale = m_scale;
+    if (m_average_ms > m_settings.target_frame_ms)
+    {
+        // largest step that fits the budget at once, frames after a spike should not wait for several changes
+        scale = m_scale * sqrtf(m_settings.target_frame_ms / m_average_ms);
+        scale = floorf(scale / m_settings.scale_step) * m_settings.scale_step;
+    }
+    else
+    {
+        float next = m_scale + m_settings.scale_step;
+        float predicted = m_average_ms * (next * next) / (m_scale * m_scale);
+        if (predicted < m_settings.target_frame_ms * m_settings.headroom)
+        {
+            scale = next;
+        }
+    }
+    scale = std::min(std::max(scale, m_settings.min_scale), m_settings.max_scale);
+    if (scale != m_scale)
+    {
+        m_scale = scale;
+        m_measured_frames = 0;
+        m_changes++;
+    }
+}
+
+float
+Sisyphus::Render::ResolutionGovernor::get_scale() const
+{
+    return m_scale;
+}
+
+void
+Sisyphus::Render::ResolutionGovernor::get_render_size(
+    int output_width, int output_height, int& width, int& height) const
+{
+    width = std::max(1, (int)((float)output_width * m_scale + 0.5f));
+    height = std::max(1, (int)((float)output_height * m_scale + 0.5f));
+}
+
+float
+Sisyphus::Render::ResolutionGovernor::get_lod_bias() const
+{
+    return std::max(log2f(m_scale), -m_settings.max_lod_bias);
+}
+
+float
+Sisyphus::Render::ResolutionGovernor::get_average_frame_time() const
+{
+    return m_average_ms;
+}
+
+uint64_t
+Sisyphus::Render::ResolutionGovernor::get_change_count() const
+{
+    return m_changes;
+}
+
+void
+Sisyphus::Render::upscale_frame(
+    const uint8_t* src, int src_width, int src_height, uint8_t* dst, int dst_width, int dst_height,
+    int bytes_per_pixel)
+{
+    assert(src_width > 0 && src_height > 0 && dst_width > 0 && dst_height > 0);
+    if (src_width == dst_width && src_height == dst_height)
+    {
+        memcpy(dst, src, (size_t)src_width * src_height * bytes_per_pixel);
+        return;
+    }
+    static thread_local std::vector<int>     columns;
+    static thread_local std::vector<int>     column_weights;
+    static thread_local std::vector<int16_t> row;
+    columns.resize(dst_width);
+    column_weights.resize(dst_width);
+    for (int x = 0; x < dst_width; x++)
+    {
+        get_sample(x, dst_width, src_width, columns[x], column_weights[x]);
+    }
+    // blended row with its last pixel repeated, so the right neighbour always exists; padded for 16 byte loads
+    int row_size = src_width * bytes_per_pixel;
+    row.resize(row_size + bytes_per_pixel + 8);
+    for (int y = 0; y < dst_height; y++)
+    {
+        int y0 = 0;
+        int row_weight = 0;
+        get_sample(y, dst_height, src_height, y0, row_weight);
+        int y1 = std::min(y0 + 1, src_height - 1);
+        blend_rows(src + (size_t)y0 * row_size, src + (size_t)y1 * row_size, row_weight, row.data(), row_size);
+        memcpy(&row[row_size], &row[row_size - bytes_per_pixel], bytes_per_pixel * sizeof(int16_t));
+        uint8_t* out = dst + (size_t)y * dst_width * bytes_per_pixel;
+        int      x = 0;
+#if SISYPHUS_UPSCALE_SSE
+        if (bytes_per_pixel == 4)
+        {
+            // a pixel and its right neighbour are one load of 8 lanes
+            for (; x < dst_width; x++)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row[columns[x] * 4]));
+                __m128i d = _mm_sub_epi16(_mm_srli_si128(v, 8), v);
+                __m128i w = _mm_set1_epi16((int16_t)column_weights[x]);
+                v = _mm_add_epi16(v, _mm_srai_epi16(_mm_mullo_epi16(d, w), weight_bits));
+                int pixel = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+                memcpy(out + x * 4, &pixel, 4);
+            }
+        }
+#endif
+        for (; x < dst_width; x++)
+        {
+            const int16_t* a = &row[columns[x] * bytes_per_pixel];
+            const int16_t* b = a + bytes_per_pixel;
+            for (int c = 0; c < bytes_per_pixel; c++)
+            {
+                out[x * bytes_per_pixel + c] = (uint8_t)(a[c] + (((b[c] - a[c]) * column_weights[x]) >> weight_bits));
+            }
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#include "render_swapchain.h"
+
+#include <cassert>
+
+const uint8_t*
+Sisyphus::Render::FrameBuffer::get_data() const
+{
+    return storage.get_color();
+}
+
+unsigned int
+Sisyphus::Render::FrameBuffer::get_size() const
+{
+    return width * height * bytes_per_pixel;
+}
+
+Sisyphus::Render::Swapchain::Swapchain(int buffer_count)
+{
+    this->set_buffer_count(buffer_count);
+}
+
+Sisyphus::Render::FrameBuffer*
+Sisyphus::Render::Swapchain::find_back_buffer()
+{
+    FrameBuffer* candidate = nullptr;
+    for (int i = 0; i < m_buffer_count; i++)
+    {
+        if (m_buffers[i].state == EFrameState::Free)
+        {
+            return &m_buffers[i];
+        }
+    }
+    // nothing is free - overwrite the oldest presented frame nobody has taken yet
+    for (int i = 0; i < m_buffer_count; i++)
+    {
+        FrameBuffer& buffer = m_buffers[i];
+        if (buffer.state == EFrameState::Ready && (candidate == nullptr || buffer.frame_index < candidate->frame_index))
+        {
+            candidate = &buffer;
+        }
+    }
+    return candidate;
+}
+
+void
+Sisyphus::Render::Swapchain::set_buffer_count(int buffer_count)
+{
+    assert(buffer_count > 0 && buffer_count <= max_buffer_count);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffer_count = buffer_count;
+    for (int i = m_buffer_count; i < max_buffer_count; i++)
+    {
+        // buffers in use are left alone, they just will not be picked again
+        if (m_buffers[i].state == EFrameState::Free)
+        {
+            m_buffers[i].storage.release();
+        }
+    }
+}
+
+int
+Sisyphus::Render::Swapchain::get_buffer_count() const
+{
+    return m_buffer_count;
+}
+
+void
+Sisyphus::Render::Swapchain::set_huge_pages(bool flag)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (int i = 0; i < max_buffer_count; i++)
+    {
+        // storage of the buffers in use is reallocated on their next reserve
+        if (m_buffers[i].state == EFrameState::Free)
+        {
+            m_buffers[i].storage.set_huge_pages(flag);
+        }
+    }
+}
+
+Sisyphus::Render::FrameBuffer*
+Sisyphus::Render::Swapchain::get_back_buffer(int width, int height, int bytes_per_pixel)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_back == nullptr)
+    {
+        while ((m_back = find_back_buffer()) == nullptr)
+        {
+            m_released.wait(lock);
+        }
+        if (m_back == m_latest)
+        {
+            m_latest = nullptr;
+        }
+        m_back->state = EFrameState::Rendering;
+    }
+    m_back->width = width;
+    m_back->height = height;
+    m_back->bytes_per_pixel = bytes_per_pixel;
+    m_back->storage.reserve(width * height * (size_t)bytes_per_pixel, 0);
+    return m_back;
+}
+
+uint64_t
+Sisyphus::Render::Swapchain::present()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_back == nullptr)
+    {
+        return m_frame_counter;
+    }
+    m_back->frame_index = ++m_frame_counter;
+    m_back->state = EFrameState::Ready;
+    m_latest = m_back;
+    m_back = nullptr;
+    return m_frame_counter;
+}
+
+const Sisyphus::Render::FrameBuffer*
+Sisyphus::Render::Swapchain::acquire_frame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FrameBuffer* newest = nullptr;
+    uint64_t     newest_acquired = 0;
+    for (int i = 0; i < max_buffer_count; i++)
+    {
+        FrameBuffer& buffer = m_buffers[i];
+        if (buffer.state == EFrameState::Ready && (newest == nullptr || buffer.frame_index > newest->frame_index))
+        {
+            newest = &buffer;
+        }
+        if (buffer.state == EFrameState::Acquired && buffer.frame_index > newest_acquired)
+        {
+            newest_acquired = buffer.frame_index;
+        }
+    }
+    if (newest != nullptr && newest->frame_index < newest_acquired)
+    {
+        // consumer already holds something newer
+        newest = nullptr;
+    }
+    if (newest != nullptr)
+    {
+        newest->state = EFrameState::Acquired;
+    }
+    return newest;
+}
+
+void
+Sisyphus::Render::Swapchain::release_frame(const FrameBuffer* frame)
+{
+    if (frame == nullptr)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int                         idx = static_cast<int>(frame - m_buffers);
+        assert(idx >= 0 && idx < max_buffer_count && frame->state == EFrameState::Acquired);
+        m_buffers[idx].state = EFrameState::Free;
+    }
+    m_released.notify_all();
+}
+
+const Sisyphus::Render::FrameBuffer*
+Sisyphus::Render::Swapchain::get_latest_frame() const
+{
+    return m_latest;
+}
+
+uint64_t
+Sisyphus::Render::Swapchain::get_frame_counter() const
+{
+    return m_frame_counter;
+}
@@ -1,5 +1,138 @@
 #include "render_texture.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SISYPHUS_TEXTURE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    void
+    downsample_level(
+        const uint8_t* src, uint32_t src_width, uint32_t src_height, uint32_t channels, uint8_t* dst,
+        uint32_t dst_width, uint32_t dst_height)
+    {
+        // odd sizes repeat the last row or column
+        for (uint32_t y = 0; y < dst_height; y++)
+        {
+            const uint8_t* row0 = src + (size_t)std::min(2 * y, src_height - 1) * src_width * channels;
+            const uint8_t* row1 = src + (size_t)std::min(2 * y + 1, src_height - 1) * src_width * channels;
+            uint8_t*       out = dst + (size_t)y * dst_width * channels;
+            uint32_t       x = 0;
+#if SISYPHUS_TEXTURE_SSE
+            if (channels == 4)
+            {
+                // 4 texels of 2 rows into 2
+                __m128i zero = _mm_setzero_si128();
+                __m128i round = _mm_set1_epi16(2);
+                for (; 2 * x + 4 <= src_width && x + 2 <= dst_width; x += 2)
+                {
+                    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+                    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+                    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                    __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, sum));
+                }
+            }
+#endif
+            for (; x < dst_width; x++)
+            {
+                uint32_t x0 = std::min(2 * x, src_width - 1) * channels;
+                uint32_t x1 = std::min(2 * x + 1, src_width - 1) * channels;
+                for (uint32_t c = 0; c < channels; c++)
+                {
+                    int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                    out[x * channels + c] = (uint8_t)((sum + 2) >> 2);
+                }
+            }
+        }
+    }
+
+    void
+    tile_level(const uint8_t* src, uint32_t width, uint32_t height, uint32_t channels, std::vector<uint8_t>& dst)
+    {
+        // padding repeats the last row and column
+        uint32_t tile = Sisyphus::Render::texture_tile_size;
+        uint32_t padded_width = (width + tile - 1) / tile * tile;
+        uint32_t padded_height = (height + tile - 1) / tile * tile;
+        dst.resize((size_t)padded_width * padded_height * channels);
+        for (uint32_t y = 0; y < padded_height; y++)
+        {
+            const uint8_t* row = src + (size_t)std::min(y, height - 1) * width * channels;
+            for (uint32_t x = 0; x < padded_width; x++)
+            {
+                memcpy(
+                    dst.data() + (size_t)Sisyphus::Render::get_texel_index(x, y, width) * channels,
+                    row + std::min(x, width - 1) * channels, channels);
+            }
+        }
+    }
+
+    void
+    untile_level(const uint8_t* src, uint32_t width, uint32_t height, uint32_t channels, uint8_t* dst)
+    {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                memcpy(
+                    dst + ((size_t)y * width + x) * channels,
+                    src + (size_t)Sisyphus::Render::get_texel_index(x, y, width) * channels, channels);
+            }
+        }
+    }
+
+    // the tiled index is the sum of a part of x and a part of y, so lookups of
+    // neighbouring texels share them
+    inline uint32_t
+    get_column_offset(uint32_t x)
+    {
+        return (x >> 2) * 16 + ((x & 1) | ((x & 2) << 1));
+    }
+
+    inline uint32_t
+    get_row_offset(uint32_t y, uint32_t width)
+    {
+        return (y >> 2) * ((width + 3) >> 2) * 16 + (((y & 1) << 1) | ((y & 2) << 2));
+    }
+
+    Sisyphus::Base::vec4_t
+    read_texel(const uint8_t* data, uint32_t channels, uint32_t index)
+    {
+        Sisyphus::Base::vec4_t pixel {0.0f, 0.0f, 0.0f, 1.0f};
+        const uint8_t*         texel = data + (size_t)index * channels;
+        switch (channels)
+        {
+        case 4:
+            pixel.a = texel[3] / 255.0f;
+            // fall through
+        case 3:
+            pixel.b = texel[2] / 255.0f;
+            // fall through
+        case 2:
+            pixel.g = texel[1] / 255.0f;
+            // fall through
+        case 1:
+            pixel.r = texel[0] / 255.0f;
+        }
+        return pixel;
+    }
+} // namespace
+
+uint32_t
+Sisyphus::Render::get_texel_index(uint32_t x, uint32_t y, uint32_t width)
+{
+    // tiles of 4x4, bits of x and y within a tile interleaved
+    return get_column_offset(x) + get_row_offset(y, width);
+}
+
 Sisyphus::Render::Texture::Texture()
     : width(0)
     , height(0)
@@ -11,8 +144,53 @@ Sisyphus::Render::Texture::Texture(const uint8_t* d, uint32_t w, uint32_t h, uin
     width = w;
     height = h;
     channels = ch;
-    data.resize(w * h * ch);
-    memcpy(data.data(), d, w * h * ch);
+    tile_level(d, w, h, ch, data);
+}
+
+void
+Sisyphus::Render::Texture::generate_mips()
+{
+    // the box filter runs on row-major texels, every level is tiled after
+    mips.clear();
+    std::vector<uint8_t> src;
+    std::vector<uint8_t> dst;
+    this->export_linear(src);
+    uint32_t src_width = width;
+    uint32_t src_height = height;
+    while (src_width > 1 || src_height > 1)
+    {
+        TextureLevel level;
+        level.width = std::max(src_width / 2, 1u);
+        level.height = std::max(src_height / 2, 1u);
+        dst.resize((size_t)level.width * level.height * channels);
+        downsample_level(src.data(), src_width, src_height, channels, dst.data(), level.width, level.height);
+        tile_level(dst.data(), level.width, level.height, channels, level.data);
+        mips.push_back(std::move(level));
+        src.swap(dst);
+        src_width = mips.back().width;
+        src_height = mips.back().height;
+    }
+}
+
+void
+Sisyphus::Render::Texture::export_linear(std::vector<uint8_t>& out, uint32_t level) const
+{
+    if (width == 0 || level > mips.size())
+    {
+        out.clear();
+        return;
+    }
+    const uint8_t* level_data = level == 0 ? data.data() : mips[level - 1].data.data();
+    uint32_t       level_width = level == 0 ? width : mips[level - 1].width;
+    uint32_t       level_height = level == 0 ? height : mips[level - 1].height;
+    out.resize((size_t)level_width * level_height * channels);
+    untile_level(level_data, level_width, level_height, channels, out.data());
+}
+
+uint32_t
+Sisyphus::Render::Texture::get_level_count() const
+{
+    return width > 0 ? (uint32_t)mips.size() + 1 : 0;
 }
 
 Sisyphus::Base::vec4_t
@@ -21,21 +199,96 @@ Sisyphus::Render::Texture::get_pixel_color(float u, float v) const
     Sisyphus::Base::vec4_t pixel;
     int                    iu = u * (width - 1);
     int                    iv = (1.0f - v) * (height - 1);
-    uint32_t               idx = iv * width * channels + iu * channels;
     pixel.a = 1.0f;
-    if (idx < width * height * channels)
+    if (iu >= 0 && iu < (int)width && iv >= 0 && iv < (int)height)
     {
+        uint32_t idx = get_texel_index(iu, iv, width) * channels;
         switch (channels)
         {
         case 4:
             pixel.a = data[idx + 3] / 255.0f;
+            // fall through
         case 3:
             pixel.b = data[idx + 2] / 255.0f;
+            // fall through
         case 2:
             pixel.g = data[idx + 1] / 255.0f;
+            // fall through
         case 1:
             pixel.r = data[idx] / 255.0f;
         }
     }
     return pixel;
 }
+
+Sisyphus::Base::vec4_t
+Sisyphus::Render::Texture::sample_bilinear(float u, float v, uint32_t level) const
+{
+    if (width == 0)
+    {
+        return Sisyphus::Base::vec4_t {0.0f, 0.0f, 0.0f, 1.0f};
+    }
+    level = std::min(level, (uint32_t)mips.size());
+    const uint8_t* level_data = level == 0 ? data.data() : mips[level - 1].data.data();
+    uint32_t       level_width = level == 0 ? width : mips[level - 1].width;
+    uint32_t       level_height = level == 0 ? height : mips[level - 1].height;
+    // texel centers, v goes up as in get_pixel_color; edges are clamped
+    float    x = std::min(std::max(u * level_width - 0.5f, 0.0f), (float)(level_width - 1));
+    float    y = std::min(std::max((1.0f - v) * level_height - 0.5f, 0.0f), (float)(level_height - 1));
+    uint32_t x0 = (uint32_t)x;
+    uint32_t y0 = (uint32_t)y;
+    uint32_t x1 = std::min(x0 + 1, level_width - 1);
+    uint32_t y1 = std::min(y0 + 1, level_height - 1);
+    float    fx = x - (float)x0;
+    float    fy = y - (float)y0;
+    //
+    uint32_t column0 = get_column_offset(x0);
+    uint32_t column1 = get_column_offset(x1);
+    uint32_t row0 = get_row_offset(y0, level_width);
+    uint32_t row1 = get_row_offset(y1, level_width);
+    //
+    Base::vec4_t top = read_texel(level_data, channels, row0 + column0);
+    Base::vec4_t bottom = read_texel(level_data, channels, row1 + column0);
+    top = top + (read_texel(level_data, channels, row0 + column1) - top) * fx;
+    bottom = bottom + (read_texel(level_data, channels, row1 + column1) - bottom) * fx;
+    return top + (bottom - top) * fy;
+}
+
+Sisyphus::Base::vec4_t
+Sisyphus::Render::Texture::sample_trilinear(float u, float v, float lod) const
+{
+    float last = (float)mips.size();
+    if (!(lod > 0.0f))
+    {
+        return this->sample_bilinear(u, v, 0);
+    }
+    if (lod >= last)
+    {
+        return this->sample_bilinear(u, v, (uint32_t)last);
+    }
+    uint32_t               level = (uint32_t)lod;
+    float                  t = lod - (float)level;
+    Sisyphus::Base::vec4_t finer = this->sample_bilinear(u, v, level);
+    return finer + (this->sample_bilinear(u, v, level + 1) - finer) * t;
+}
+
+float
+Sisyphus::Render::Texture::calculate_lod(const Sisyphus::Base::vec4_t& gradients) const
+{
+    float dx_u = gradients.x * width;
+    float dx_v = gradients.y * height;
+    float dy_u = gradients.z * width;
+    float dy_v = gradients.w * height;
+    float rho_squared = std::max(dx_u * dx_u + dx_v * dx_v, dy_u * dy_u + dy_v * dy_v);
+    if (rho_squared <= 0.0f)
+    {
+        return 0.0f;
+    }
+    return 0.5f * log2f(rho_squared);
+}
+
+Sisyphus::Base::vec4_t
+Sisyphus::Render::Texture::sample(float u, float v, const Sisyphus::Base::vec4_t& gradients, float lod_bias) const
+{
+    return this->sample_trilinear(u, v, this->calculate_lod(gradients) + lod_bias);
+}
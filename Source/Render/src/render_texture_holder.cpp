@@ -20,6 +20,7 @@ uint32_t
 Sisyphus::Render::TextureHolder::add_texture(const uint8_t* pixelData, uint32_t w, uint32_t h, uint32_t ch)
 {
     m_textures.push_back(Texture(pixelData, w, h, ch));
+    m_textures.back().generate_mips();
     return m_textures.size() - 1;
 }
 
@@ -36,12 +37,26 @@ Sisyphus::Render::TextureHolder::get_pixel(uint32_t texId, float u, float v)
     return pixel;
 }
 
+Sisyphus::Base::vec4_t
+Sisyphus::Render::TextureHolder::sample(uint32_t texId, float u, float v, const Base::vec4_t& gradients, float lod_bias)
+{
+    if (texId < m_textures.size())
+    {
+        return m_textures[texId].sample(u, v, gradients, lod_bias);
+    }
+    Sisyphus::Base::vec4_t pixel;
+    pixel.a = 1.0f;
+    return pixel;
+}
+
 void
 Sisyphus::Render::TextureHolder::save_texture(const char* path, int texId)
 {
     if (texId >= 0 && texId < m_textures.size())
     {
-        const Texture& tex = m_textures[texId];
-        stbi_write_png(path, tex.width, tex.height, tex.channels, tex.data.data(), tex.width * tex.channels);
+        const Texture&       tex = m_textures[texId];
+        std::vector<uint8_t> pixels;
+        tex.export_linear(pixels);
+        stbi_write_png(path, tex.width, tex.height, tex.channels, pixels.data(), tex.width * tex.channels);
     }
 }
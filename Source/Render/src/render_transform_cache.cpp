@@ -0,0 +1,106 @@
+#include "render_transform_cache.h"
+#include "render_mesh.h"
+#include "render_pipeline_state.h"
+#include "base_utils.h"
+
+#include <cassert>
+
+bool
+Sisyphus::Render::TransformCacheKey::operator==(const TransformCacheKey& other) const
+{
+    return vertex_buffer_id == other.vertex_buffer_id && vertex_buffer_version == other.vertex_buffer_version &&
+           index_buffer_id == other.index_buffer_id && index_buffer_version == other.index_buffer_version &&
+           state_hash == other.state_hash;
+}
+
+void
+Sisyphus::Render::TransformCache::invalidate()
+{
+    m_valid = false;
+}
+
+bool
+Sisyphus::Render::TransformCache::is_valid() const
+{
+    return m_valid;
+}
+
+const Sisyphus::Render::TransformCacheKey&
+Sisyphus::Render::TransformCache::get_key() const
+{
+    return m_key;
+}
+
+uint32_t
+Sisyphus::Render::TransformCache::get_triangle_count() const
+{
+    return (uint32_t)(m_coords.size() / 3);
+}
+
+uint64_t
+Sisyphus::Render::TransformCache::get_rebuild_count() const
+{
+    return m_rebuilds;
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_cached(
+    TransformCache& cache, const Mesh& mesh, const VertexFormat& v_in_format, const VertexFormat& v_out_format)
+{
+    if (m_data == nullptr)
+    {
+        this->bind_back_buffer();
+    }
+    // occlusion changes every frame, so it is not a part of the key
+    if (!this->is_visible(mesh.get_bounds()))
+    {
+        return;
+    }
+    this->update_pipeline();
+    if (m_dirty_tiles != nullptr &&
+        this->skip_dirty_draw(mesh.get_geometry_view(), v_in_format, v_out_format, &mesh.get_bounds()))
+    {
+        return;
+    }
+    TransformCacheKey key;
+    key.vertex_buffer_id = mesh.get_vertex_buffer().get_id();
+    key.vertex_buffer_version = mesh.get_vertex_buffer().get_version();
+    key.index_buffer_id = mesh.get_index_buffer().get_id();
+    key.index_buffer_version = mesh.get_index_buffer().get_version();
+    uint64_t hash = Base::hash_seed;
+    hash = Base::hash_value(hash, m_bound_vsf);
+    hash = Base::hash_value(hash, m_pipeline_variant);
+    hash = Base::hash_value(hash, v_in_format.size);
+    hash = Base::hash_bytes(
+        hash, v_out_format.attributes.data(), v_out_format.attributes.size() * sizeof(EVertexAttribType));
+    hash = Base::hash_value(hash, m_frustum);
+    hash = Base::hash_bytes(hash, m_builtins.data(), m_builtins.size());
+    hash = Base::hash_bytes(hash, m_descriptor_set.data(), m_descriptor_set.size());
+    key.state_hash = hash;
+    bool wire = m_pipeline_variant >= pipeline_variant_count / 2;
+    if (!cache.m_valid || !(cache.m_key == key))
+    {
+        cache.m_coords.clear();
+        cache.m_data.clear();
+        cache.m_primitives.clear();
+        m_transform_capture = &cache;
+        (this->*s_capture_triangle_loops[m_pipeline_variant / line_pipeline_variant_count])(
+            mesh.get_geometry_view(), v_in_format, v_out_format);
+        m_transform_capture = nullptr;
+        // wireframe loops write barycentrics after the output of the shader
+        cache.m_format = wire ? m_wire_format : v_out_format;
+        cache.m_key = key;
+        cache.m_valid = true;
+        cache.m_rebuilds++;
+    }
+    int cached_variant = (int)wire * line_pipeline_variant_count + m_pipeline_variant % line_pipeline_variant_count;
+    (this->*s_cached_triangle_loops[cached_variant])(cache);
+}
+
+void
+Sisyphus::Render::Context::draw_triangles_cached(TransformCache& cache, const Mesh& mesh)
+{
+    assert(m_pipeline != nullptr);
+    this->draw_triangles_cached(
+        cache, mesh, m_pipeline->get_vertex_input_format(), m_pipeline->get_vertex_output_format());
+}
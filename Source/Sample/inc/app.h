@@ -1,10 +1,28 @@
+#include <cstdint>
+
 extern "C" void
 sisyphus_application_init(void* data);
-extern "C" void
+// only submits the frame to the render thread, returns its id for wait_frame
+extern "C" uint64_t
 sisyphus_application_update(void* data);
 extern "C" void
+sisyphus_application_set_frames_in_flight(int count); // 0 - render synchronously inside update
+extern "C" void
+sisyphus_application_wait_frame(uint64_t frame_id);
+extern "C" void
 sisyphus_application_set_log_function(void (*func)(const char* msg, unsigned int msg_size));
 extern "C" void
 sisyphus_application_close();
 extern "C" void
 sisyphus_application_get_frame(void* data, unsigned int data_size);
+// zero-copy alternative to get_frame - frame stays valid until release
+extern "C" const void*
+sisyphus_application_acquire_frame(int* width, int* height, unsigned int* data_size);
+extern "C" void
+sisyphus_application_release_frame(const void* data);
+// rect of the last frame, format is Render::EReadbackFormat, 0 width or height - the whole frame;
+// downscale is 1, 2 or 4 and stride 0 packs rows tightly. Returns 0 for an unknown format or
+// a request that does not fit
+extern "C" int
+sisyphus_application_read_frame(
+    int x, int y, int width, int height, int format, int stride, int downscale, void* data, unsigned int data_size);
@@ -2,7 +2,10 @@
 
 #include "app.h"
 #include "render_color.h"
+#include "render_command_buffer.h"
 #include "render_context.h"
+#include "render_frame_queue.h"
+#include "render_readback.h"
 #include "render_texture_holder.h"
 #include "win_tex_loader.h"
 #include "obj_file.h"
@@ -26,16 +29,19 @@ static std::vector<Base::vec4_t>    s_default_colors = {
 static Render::col4u_t s_bg_color {15, 15, 35, 255};
 static Render::col4u_t s_line_color {0, 150, 0, 255};
 
-static Render::Context s_render_context(1, 1, 4);
+static Render::Context                         s_render_context(1, 1, 4);
+static std::vector<const Render::FrameBuffer*> s_acquired_frames;
+static Render::CommandBuffer                   s_command_buffer; // recorded and submitted on the render thread
+static Render::FrameQueue                      s_frame_queue(2); // after context - stopped before it is destroyed
 
 static std::vector<Base::vec4_t> s_abc = {};
-static std::vector<int>          s_abc_line_indices = {0, 1, 1, 2, 2, 0};
 static std::vector<int>          s_abc_triangle_indices = {2, 1, 0};
 static std::vector<uint8_t>      s_abc_triangle_attribs = {};
 
 std::vector<Base::vec4_t> s_model_verts;
 std::vector<int>          s_model_inds;
 std::vector<uint8_t>      s_model_vertex_attribs;
+Base::Bounds              s_model_bounds;
 
 static Render::VertexFormat s_vertex_output_format({
     Render::EVertexAttribType::VEC4, // position
@@ -50,6 +56,81 @@ static Render::VertexFormat s_vertex_input_format({
     Render::EVertexAttribType::VEC3, // normal
 });
 
+static void
+render_frame(int width, int height, int bpp, float angle)
+{
+    // float angley = 30.0f / 360.0f * 2.0f * Base::pi;
+    // float anglez = 10.0f / 360.0f * 2.0f * Base::pi;
+    const Base::mat4_t rot_matrix_y = Base::mat4_t::calculate_rotation_matrix_around_y(angle);
+    const Base::mat4_t rot_matrix_z = Base::mat4_t::calculate_rotation_matrix_around_z(angle);
+    Base::mat4_t       rotation_matrix = rot_matrix_y * rot_matrix_z;
+
+    Base::mat4_t scale_matrix = Base::mat4_t::get_identity_matrix();
+    scale_matrix.r0.x = 0.5f;
+    scale_matrix.r1.y = 0.5f;
+    scale_matrix.r2.z = 0.5f;
+
+    Base::mat4_t translation_matrix = Base::mat4_t::get_identity_matrix();
+    // translation_matrix.r1.w = 0.3f; // y-shift
+    translation_matrix.r2.w = 0.7f; // z-shift
+
+    Base::mat4_t model_matrix = translation_matrix * rotation_matrix * scale_matrix;
+    s_command_buffer.reset();
+    s_command_buffer.set_model_matrix(model_matrix);
+    s_command_buffer.set_view_matrix(Base::mat4_t::get_identity_matrix()); // not really used yet
+    s_command_buffer.set_perspective(90.0f, width / (float)height, 0.4f, 100.0f);
+    s_command_buffer.set_backface_culling(Render::ECullingMode::CounterClockWise);
+    //
+    std::vector<uint8_t> descriptor_set;
+    Base::vec3_t         camera_position {0.0f, 0.0f, 0.0f};
+    Base::append_data(descriptor_set, camera_position);
+    int light_count = 3;
+    Base::append_data(descriptor_set, light_count);
+    int   light_ambient = 0;
+    float ambient_illumination = 0.2f;
+    int   light_point = 1;
+    float point_illumination = 0.4f;
+    int   light_directed = 2;
+    float direct_illumination = 0.4f;
+    Base::append_data(descriptor_set, light_ambient);
+    Base::append_data(descriptor_set, ambient_illumination);
+    Base::append_data(descriptor_set, light_point);
+    Base::append_data(descriptor_set, point_illumination);
+    Base::vec3_t light_point_position {-2.0f, 0.0f, -1.0f};
+    Base::append_data(descriptor_set, light_point_position);
+    Base::append_data(descriptor_set, light_directed);
+    Base::append_data(descriptor_set, direct_illumination);
+    Base::vec3_t light_direction {-1.0f, 0.0f, 1.0f};
+    Base::append_data(descriptor_set, light_direction);
+    //
+    s_command_buffer.set_viewport(0, 0, 0, width, height, 1);
+    // begin straight filling of color buffer
+    s_command_buffer.clear_depth(0.0f);
+    s_command_buffer.fill(s_bg_color); // fill background and also clear screen
+    //
+    s_command_buffer.set_descriptor_set(descriptor_set);
+    // both are opaque, depth key is the view space distance along z of their centers
+    Base::vec4_t abc_center = model_matrix * ((s_abc[0] + s_abc[1] + s_abc[2]) / 3.0f);
+#if TRIANGLE_LINE
+    // edges of the sample triangle are drawn over its shaded pixels in the same pass
+    s_command_buffer.set_wireframe(true, Base::vec4_t {0.0f, 0.0f, 0.0f, 1.0f}, 1.0f);
+#endif
+    s_command_buffer.draw_triangles_sorted(
+        s_abc,
+        s_abc_triangle_indices,
+        reinterpret_cast<const uint8_t*>(s_abc_triangle_attribs.data()),
+        s_vertex_input_format, s_vertex_output_format, abc_center.z);
+#if TRIANGLE_LINE
+    s_command_buffer.set_wireframe(false, Base::vec4_t {0.0f, 0.0f, 0.0f, 1.0f}, 1.0f);
+#endif
+    s_command_buffer.draw_triangles_sorted(
+        s_model_verts, s_model_inds, reinterpret_cast<const uint8_t*>(s_model_vertex_attribs.data()),
+        s_vertex_input_format, s_vertex_output_format, translation_matrix.r2.w, &s_model_bounds);
+    s_render_context.resize(width, height, bpp);
+    s_render_context.submit(s_command_buffer);
+    s_render_context.present();
+}
+
 extern "C"
 {
 void
@@ -79,6 +160,8 @@ sisyphus_application_init(void* data)
     Base::append_data(s_abc_triangle_attribs, uv2);
     Base::append_data(s_abc_triangle_attribs, normal);
     // we prepared sample triangle to draw in both modes - line and solid
+    // one buffer is presented, one is waiting to be taken and one is rendered
+    s_render_context.set_buffer_count(3);
     s_render_context.set_vertex_shader(
         [](const Base::vec4_t& inp, Base::vec4_t& out, std::vector<uint8_t>& per_vertex_out,
            const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins,
@@ -180,6 +263,7 @@ sisyphus_application_init(void* data)
     snprintf(obj_path, 128, "%s/cube_sided.obj", SISYPHUS_RESOURCES_FOLDER);
     uint32_t                       mosaic_texture = load_texture_win(tex_path);
     std::shared_ptr<Util::ObjFile> obj_file = Util::read_obj_model_file(obj_path);
+    s_model_bounds = obj_file->bounds;
 
     std::vector<Base::vec4_t> colors;
     for (int vert_idx = 0; vert_idx < obj_file->coord.size(); vert_idx++)
@@ -206,7 +290,7 @@ sisyphus_application_init(void* data)
     }
 }
 
-void
+uint64_t
 sisyphus_application_update(void* data)
 {
     int*   update_data_i_ptr = reinterpret_cast<int*>(data);
@@ -226,91 +310,94 @@ sisyphus_application_update(void* data)
         current_time -= period_time;
     }
     float angle = 2.0f * Base::pi * rotation_degree;
-    // float angley = 30.0f / 360.0f * 2.0f * Base::pi;
-    // float anglez = 10.0f / 360.0f * 2.0f * Base::pi;
-    const Base::mat4_t rot_matrix_y = Base::mat4_t::calculate_rotation_matrix_around_y(angle);
-    const Base::mat4_t rot_matrix_z = Base::mat4_t::calculate_rotation_matrix_around_z(angle);
-    Base::mat4_t       rotation_matrix = rot_matrix_y * rot_matrix_z;
-
-    Base::mat4_t scale_matrix = Base::mat4_t::get_identity_matrix();
-    scale_matrix.r0.x = 0.5f;
-    scale_matrix.r1.y = 0.5f;
-    scale_matrix.r2.z = 0.5f;
+    // everything else happens on the render thread, host continues with previous frame
+    return s_frame_queue.submit(
+        [width, height, bpp, angle]()
+        {
+            render_frame(width, height, bpp, angle);
+        });
+}
 
-    Base::mat4_t translation_matrix = Base::mat4_t::get_identity_matrix();
-    // translation_matrix.r1.w = 0.3f; // y-shift
-    translation_matrix.r2.w = 0.7f; // z-shift
+void
+sisyphus_application_set_frames_in_flight(int count)
+{
+    s_frame_queue.set_max_frames_in_flight(count);
+}
 
-    s_render_context.set_model_matrix(translation_matrix * rotation_matrix * scale_matrix);
-    s_render_context.set_view_matrix(Base::mat4_t::get_identity_matrix()); // not really used yet
-    s_render_context.set_perspective(90.0f, width / (float)height, 0.4f, 100.0f);
-    s_render_context.set_backface_culling(Render::ECullingMode::CounterClockWise);
-    //
-    std::vector<uint8_t> descriptor_set;
-    Base::vec3_t         camera_position {0.0f, 0.0f, 0.0f};
-    Base::append_data(descriptor_set, camera_position);
-    int light_count = 3;
-    Base::append_data(descriptor_set, light_count);
-    int   light_ambient = 0;
-    float ambient_illumination = 0.2f;
-    int   light_point = 1;
-    float point_illumination = 0.4f;
-    int   light_directed = 2;
-    float direct_illumination = 0.4f;
-    Base::append_data(descriptor_set, light_ambient);
-    Base::append_data(descriptor_set, ambient_illumination);
-    Base::append_data(descriptor_set, light_point);
-    Base::append_data(descriptor_set, point_illumination);
-    Base::vec3_t light_point_position {-2.0f, 0.0f, -1.0f};
-    Base::append_data(descriptor_set, light_point_position);
-    Base::append_data(descriptor_set, light_directed);
-    Base::append_data(descriptor_set, direct_illumination);
-    Base::vec3_t light_direction {-1.0f, 0.0f, 1.0f};
-    Base::append_data(descriptor_set, light_direction);
-    //
-    s_render_context.resize(width, height, bpp);
-    s_render_context.set_viewport(0, 0, 0, width, height, 1);
-    // begin straight filling of color buffer
-    s_render_context.clear_depth(0.0f);
-    s_render_context.fill(s_bg_color); // fill background and also clear screen
-    //
-    s_render_context.set_descriptor_set(descriptor_set);
-    s_render_context.draw_triangles(
-        s_abc,
-        s_abc_triangle_indices,
-        reinterpret_cast<const uint8_t*>(s_abc_triangle_attribs.data()),
-        s_vertex_input_format, s_vertex_output_format);
-    s_render_context.draw_triangles(
-        s_model_verts, s_model_inds, reinterpret_cast<const uint8_t*>(s_model_vertex_attribs.data()),
-        s_vertex_input_format, s_vertex_output_format);
-#if TRIANGLE_LINE
-    s_render_context.draw_lines(
-        s_abc,
-        s_abc_line_indices,
-        reinterpret_cast<const uint8_t*>(s_abc_triangle_attribs.data()),
-        s_vertex_input_format, s_vertex_output_format
-    );
-#endif
+void
+sisyphus_application_wait_frame(uint64_t frame_id)
+{
+    s_frame_queue.wait_frame(frame_id);
 }
 
 void
 sisyphus_application_set_log_function(void (*func)(const char* msg, unsigned int msg_size))
 {
+    s_frame_queue.flush(); // context is used by the render thread
     s_render_context.set_log_func(func);
 }
 
 void
 sisyphus_application_close()
 {
+    s_frame_queue.flush();
     // s_render_context.destroy();
 }
 
 void
 sisyphus_application_get_frame(void* data_ptr, unsigned int data_size)
 {
+    s_frame_queue.flush();
     unsigned int frame_size = s_render_context.get_frame_size();
     assert(frame_size <= data_size);
     const void* frame_data = s_render_context.get_frame();
     memcpy(data_ptr, frame_data, frame_size);
 }
+
+int
+sisyphus_application_read_frame(
+    int x, int y, int width, int height, int format, int stride, int downscale, void* data, unsigned int data_size)
+{
+    // the format comes from the host as a plain int
+    if (format < (int)Render::EReadbackFormat::BGRA8 || format > (int)Render::EReadbackFormat::GRAY8)
+    {
+        return 0;
+    }
+    s_frame_queue.flush();
+    Render::ReadbackDesc desc;
+    desc.rect = Render::ScreenRect {x, y, x + width, y + height};
+    desc.format = (Render::EReadbackFormat)format;
+    desc.stride = stride;
+    desc.downscale = downscale;
+    return s_render_context.read_frame(desc, static_cast<uint8_t*>(data), data_size) ? 1 : 0;
+}
+
+const void*
+sisyphus_application_acquire_frame(int* width, int* height, unsigned int* data_size)
+{
+    const Render::FrameBuffer* frame = s_render_context.acquire_frame();
+    if (frame == nullptr)
+    {
+        return nullptr;
+    }
+    *width = frame->width;
+    *height = frame->height;
+    *data_size = frame->get_size();
+    s_acquired_frames.push_back(frame);
+    return frame->get_data();
+}
+
+void
+sisyphus_application_release_frame(const void* data)
+{
+    for (int i = 0; i < s_acquired_frames.size(); i++)
+    {
+        if (s_acquired_frames[i]->get_data() == data)
+        {
+            s_render_context.release_frame(s_acquired_frames[i]);
+            s_acquired_frames.erase(s_acquired_frames.begin() + i);
+            return;
+        }
+    }
+}
 }
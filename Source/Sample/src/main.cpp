@@ -77,14 +77,26 @@ draw(HWND hWnd)
     }
     nanoseconds_prev = nanoseconds;
     update_info_t upd {width, height, 4, dt};
-    sisyphus_application_update(&upd);
-
-    static std::vector<uint8_t> frame_data = {};
-    frame_data.resize(width * height * 4);
-    sisyphus_application_get_frame(frame_data.data(), static_cast<unsigned int>(frame_data.size()));
+    uint64_t      frame_id = sisyphus_application_update(&upd);
+    // the new frame is rendered in background, show the previous one meanwhile
+    if (frame_id > 1)
+    {
+        sisyphus_application_wait_frame(frame_id - 1);
+    }
 
-    SetDIBitsToDevice(
-        hdc, 0, 0, width, height, 0, 0, 0, height, (unsigned char*)frame_data.data(), &bmi, DIB_RGB_COLORS);
+    // frame is read in place from the renderer buffer, no copies on the way
+    int          frame_width = 0, frame_height = 0;
+    unsigned int frame_size = 0;
+    const void*  frame_data = sisyphus_application_acquire_frame(&frame_width, &frame_height, &frame_size);
+    if (frame_data != nullptr)
+    {
+        bmi.bmiHeader.biWidth = frame_width;
+        bmi.bmiHeader.biHeight = -frame_height; // Top-down
+        SetDIBitsToDevice(
+            hdc, 0, 0, frame_width, frame_height, 0, 0, 0, frame_height, (const unsigned char*)frame_data, &bmi,
+            DIB_RGB_COLORS);
+        sisyphus_application_release_frame(frame_data);
+    }
     HRESULT hr = DwmFlush();
     if (FAILED(hr))
     {
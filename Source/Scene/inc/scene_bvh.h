@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "base_bounds.h"
+#include "render_context.h"
+
+namespace Sisyphus
+{
+namespace Scene
+{
+    const int bvh_width = 4;
+    const int bvh_max_leaf_items = 4;
+    // child bounds are stored per axis, so one SIMD register holds the same
+    // coordinate of all 4 children. Every slot covers a contiguous range of
+    // items, a slot with child < 0 is a leaf, empty slots have count 0
+    struct alignas(16) BvhNode {
+        float   min_x[bvh_width];
+        float   min_y[bvh_width];
+        float   min_z[bvh_width];
+        float   max_x[bvh_width];
+        float   max_y[bvh_width];
+        float   max_z[bvh_width];
+        int32_t child[bvh_width];
+        int32_t first[bvh_width];
+        int32_t count[bvh_width];
+        int32_t parent;
+    };
+    struct BvhRayHit {
+        int   instance = -1;
+        float distance = 0.0f;
+    };
+    // exact test for picking, negative distance - no hit
+    using BvhRayFunc = float (*)(
+        int instance, const Base::vec3_t& origin, const Base::vec3_t& direction, void* user_data);
+    // bounding volume hierarchy over instance boxes of one space, usually world
+    class Bvh {
+        std::vector<BvhNode>           m_nodes; // parents go before children
+        std::vector<int>               m_items; // instances in leaf order
+        std::vector<Base::BoundingBox> m_boxes; // by instance
+        std::vector<int>               m_item_nodes; // leaf node of every instance
+        std::vector<uint8_t>           m_dirty_nodes;
+        bool                           m_dirty = false;
+        //
+        int
+        build_node(int first, int count, int parent);
+        void
+        refit_node(int node_idx);
+
+      public:
+        void
+        build(const Base::BoundingBox* boxes, int count);
+        void
+        build(const std::vector<Base::BoundingBox>& boxes);
+        // only marks the path to the root, refit updates all marked nodes at once
+        void
+        set_bounds(int instance, const Base::BoundingBox& box);
+        const Base::BoundingBox&
+        get_bounds(int instance) const;
+        int
+        get_instance_count() const;
+        // cheap, keeps the tree topology - rebuild when instances moved far away
+        void
+        refit();
+        // appends instances that intersect the frustum given in bvh space, see
+        // Render::transform_frustum; subtrees fully inside are not tested further
+        int
+        query_frustum(const Render::Frustum& frustum, std::vector<int>& instances) const;
+        // closest hit along the ray, boxes only when func is nullptr
+        bool
+        query_ray(
+            const Base::vec3_t& origin, const Base::vec3_t& direction, float max_distance, BvhRayHit& hit,
+            BvhRayFunc func = nullptr, void* user_data = nullptr) const;
+    };
+} // namespace Scene
+} // namespace Sisyphus
@@ -0,0 +1,527 @@
+#include "scene_bvh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SISYPHUS_BVH_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    const int max_stack_size = 256;
+
+    struct FrustumEntry {
+        int      node;
+        uint32_t planes; // planes the node still crosses
+    };
+
+    struct RayEntry {
+        int   node;
+        float distance;
+    };
+
+    void
+    merge_box(Sisyphus::Base::BoundingBox& box, const Sisyphus::Base::BoundingBox& other)
+    {
+        box.min.x = std::min(box.min.x, other.min.x);
+        box.min.y = std::min(box.min.y, other.min.y);
+        box.min.z = std::min(box.min.z, other.min.z);
+        box.max.x = std::max(box.max.x, other.max.x);
+        box.max.y = std::max(box.max.y, other.max.y);
+        box.max.z = std::max(box.max.z, other.max.z);
+    }
+
+    Sisyphus::Base::BoundingBox
+    get_empty_box()
+    {
+        Sisyphus::Base::BoundingBox box;
+        box.min = Sisyphus::Base::vec3_t {INFINITY, INFINITY, INFINITY};
+        box.max = Sisyphus::Base::vec3_t {-INFINITY, -INFINITY, -INFINITY};
+        return box;
+    }
+
+    void
+    set_slot_box(Sisyphus::Scene::BvhNode& node, int slot, const Sisyphus::Base::BoundingBox& box)
+    {
+        node.min_x[slot] = box.min.x;
+        node.min_y[slot] = box.min.y;
+        node.min_z[slot] = box.min.z;
+        node.max_x[slot] = box.max.x;
+        node.max_y[slot] = box.max.y;
+        node.max_z[slot] = box.max.z;
+    }
+
+    Sisyphus::Base::BoundingBox
+    get_slot_box(const Sisyphus::Scene::BvhNode& node, int slot)
+    {
+        Sisyphus::Base::BoundingBox box;
+        box.min = Sisyphus::Base::vec3_t {node.min_x[slot], node.min_y[slot], node.min_z[slot]};
+        box.max = Sisyphus::Base::vec3_t {node.max_x[slot], node.max_y[slot], node.max_z[slot]};
+        return box;
+    }
+
+    bool
+    is_box_outside_plane(const Sisyphus::Base::BoundingBox& box, const Sisyphus::Render::Plane& p)
+    {
+        // the corner nearest along the normal is above the plane
+        const Sisyphus::Base::vec3_t& n = p.normal;
+        return n.x * (n.x > 0.0f ? box.min.x : box.max.x) + n.y * (n.y > 0.0f ? box.min.y : box.max.y) +
+                   n.z * (n.z > 0.0f ? box.min.z : box.max.z) + p.offset >
+               0.0f;
+    }
+
+    // returns bits of slots fully outside, slot_planes gets planes every slot still crosses
+    int
+    test_node_planes(
+        const Sisyphus::Scene::BvhNode& node, const Sisyphus::Render::Frustum& frustum, uint32_t planes,
+        uint32_t slot_planes[Sisyphus::Scene::bvh_width])
+    {
+        int outside_mask = 0;
+        for (int slot = 0; slot < Sisyphus::Scene::bvh_width; slot++)
+        {
+            slot_planes[slot] = 0;
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            if ((planes & (1u << i)) == 0)
+            {
+                continue;
+            }
+            const Sisyphus::Render::Plane& p = frustum.bounds[i];
+            const Sisyphus::Base::vec3_t&  n = p.normal;
+            // nearest and farthest corners along the normal are picked once per plane
+            const float* near_x = n.x > 0.0f ? node.min_x : node.max_x;
+            const float* near_y = n.y > 0.0f ? node.min_y : node.max_y;
+            const float* near_z = n.z > 0.0f ? node.min_z : node.max_z;
+            const float* far_x = n.x > 0.0f ? node.max_x : node.min_x;
+            const float* far_y = n.y > 0.0f ? node.max_y : node.min_y;
+            const float* far_z = n.z > 0.0f ? node.max_z : node.min_z;
+#if SISYPHUS_BVH_SSE
+            __m128 nx = _mm_set1_ps(n.x);
+            __m128 ny = _mm_set1_ps(n.y);
+            __m128 nz = _mm_set1_ps(n.z);
+            __m128 offset = _mm_set1_ps(p.offset);
+            __m128 near_distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(near_x)), _mm_mul_ps(ny, _mm_loadu_ps(near_y))),
+                _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(near_z)), offset));
+            __m128 far_distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(far_x)), _mm_mul_ps(ny, _mm_loadu_ps(far_y))),
+                _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(far_z)), offset));
+            outside_mask |= _mm_movemask_ps(_mm_cmpgt_ps(near_distance, _mm_setzero_ps()));
+            int crossing_mask = _mm_movemask_ps(_mm_cmpgt_ps(far_distance, _mm_setzero_ps()));
+            for (int slot = 0; slot < Sisyphus::Scene::bvh_width; slot++)
+            {
+                slot_planes[slot] |= ((crossing_mask >> slot) & 1u) << i;
+            }
+#else
+            for (int slot = 0; slot < Sisyphus::Scene::bvh_width; slot++)
+            {
+                float near_distance = n.x * near_x[slot] + n.y * near_y[slot] + n.z * near_z[slot] + p.offset;
+                float far_distance = n.x * far_x[slot] + n.y * far_y[slot] + n.z * far_z[slot] + p.offset;
+                outside_mask |= (near_distance > 0.0f) << slot;
+                slot_planes[slot] |= (uint32_t)(far_distance > 0.0f) << i;
+            }
+#endif
+        }
+        return outside_mask;
+    }
+
+    // entry and exit distances of one slab, a zero direction component gives an infinite inverse and would turn
+    // origins on the slab planes into 0 * inf, so a ray parallel to the slab is inside it everywhere or nowhere
+    void
+    intersect_slab(float min, float max, float origin, float inv_direction, float& t_near, float& t_far)
+    {
+        if (std::isinf(inv_direction))
+        {
+            bool inside = origin >= min && origin <= max;
+            t_near = inside ? -INFINITY : INFINITY;
+            t_far = inside ? INFINITY : -INFINITY;
+            return;
+        }
+        float t0 = (min - origin) * inv_direction;
+        float t1 = (max - origin) * inv_direction;
+        t_near = std::min(t0, t1);
+        t_far = std::max(t0, t1);
+    }
+
+#if SISYPHUS_BVH_SSE
+    void
+    intersect_slabs(__m128 min, __m128 max, float origin, float inv_direction, __m128& t_near, __m128& t_far)
+    {
+        __m128 o = _mm_set1_ps(origin);
+        if (std::isinf(inv_direction))
+        {
+            __m128 inside = _mm_and_ps(_mm_cmple_ps(min, o), _mm_cmple_ps(o, max));
+            __m128 inf = _mm_set1_ps(INFINITY);
+            __m128 neg_inf = _mm_set1_ps(-INFINITY);
+            t_near = _mm_or_ps(_mm_and_ps(inside, neg_inf), _mm_andnot_ps(inside, inf));
+            t_far = _mm_or_ps(_mm_and_ps(inside, inf), _mm_andnot_ps(inside, neg_inf));
+            return;
+        }
+        __m128 i = _mm_set1_ps(inv_direction);
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(min, o), i);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(max, o), i);
+        t_near = _mm_min_ps(t0, t1);
+        t_far = _mm_max_ps(t0, t1);
+    }
+#endif
+
+    // slab test, distance to the entry point or infinity when missed or farther than max_distance
+    void
+    intersect_node_slots(
+        const Sisyphus::Scene::BvhNode& node, const Sisyphus::Base::vec3_t& origin,
+        const Sisyphus::Base::vec3_t& inv_direction, float max_distance, float distances[Sisyphus::Scene::bvh_width])
+    {
+#if SISYPHUS_BVH_SSE
+        __m128 near_x, far_x, near_y, far_y, near_z, far_z;
+        intersect_slabs(_mm_loadu_ps(node.min_x), _mm_loadu_ps(node.max_x), origin.x, inv_direction.x, near_x, far_x);
+        intersect_slabs(_mm_loadu_ps(node.min_y), _mm_loadu_ps(node.max_y), origin.y, inv_direction.y, near_y, far_y);
+        intersect_slabs(_mm_loadu_ps(node.min_z), _mm_loadu_ps(node.max_z), origin.z, inv_direction.z, near_z, far_z);
+        __m128 t_enter = _mm_max_ps(_mm_max_ps(near_x, near_y), _mm_max_ps(near_z, _mm_setzero_ps()));
+        __m128 t_exit = _mm_min_ps(_mm_min_ps(far_x, far_y), _mm_min_ps(far_z, _mm_set1_ps(max_distance)));
+        __m128 missed = _mm_cmpgt_ps(t_enter, t_exit);
+        __m128 result = _mm_or_ps(_mm_and_ps(missed, _mm_set1_ps(INFINITY)), _mm_andnot_ps(missed, t_enter));
+        _mm_storeu_ps(distances, result);
+#else
+        for (int slot = 0; slot < Sisyphus::Scene::bvh_width; slot++)
+        {
+            float near_x, far_x, near_y, far_y, near_z, far_z;
+            intersect_slab(node.min_x[slot], node.max_x[slot], origin.x, inv_direction.x, near_x, far_x);
+            intersect_slab(node.min_y[slot], node.max_y[slot], origin.y, inv_direction.y, near_y, far_y);
+            intersect_slab(node.min_z[slot], node.max_z[slot], origin.z, inv_direction.z, near_z, far_z);
+            float t_enter = std::max(std::max(near_x, near_y), std::max(near_z, 0.0f));
+            float t_exit = std::min(std::min(far_x, far_y), std::min(far_z, max_distance));
+            distances[slot] = t_enter > t_exit ? INFINITY : t_enter;
+        }
+#endif
+    }
+
+    float
+    intersect_box(
+        const Sisyphus::Base::BoundingBox& box, const Sisyphus::Base::vec3_t& origin,
+        const Sisyphus::Base::vec3_t& inv_direction, float max_distance)
+    {
+        float near_x, far_x, near_y, far_y, near_z, far_z;
+        intersect_slab(box.min.x, box.max.x, origin.x, inv_direction.x, near_x, far_x);
+        intersect_slab(box.min.y, box.max.y, origin.y, inv_direction.y, near_y, far_y);
+        intersect_slab(box.min.z, box.max.z, origin.z, inv_direction.z, near_z, far_z);
+        float t_enter = std::max(std::max(near_x, near_y), std::max(near_z, 0.0f));
+        float t_exit = std::min(std::min(far_x, far_y), std::min(far_z, max_distance));
+        return t_enter > t_exit ? INFINITY : t_enter;
+    }
+} // namespace
+
+void
+Sisyphus::Scene::Bvh::build(const Base::BoundingBox* boxes, int count)
+{
+    m_boxes.assign(boxes, boxes + count);
+    m_items.resize(count);
+    m_item_nodes.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        m_items[i] = i;
+    }
+    m_nodes.clear();
+    m_nodes.reserve(count / 2 + 1);
+    if (count > 0)
+    {
+        this->build_node(0, count, -1);
+    }
+    m_dirty_nodes.assign(m_nodes.size(), 0);
+    m_dirty = false;
+}
+
+void
+Sisyphus::Scene::Bvh::build(const std::vector<Base::BoundingBox>& boxes)
+{
+    this->build(boxes.data(), (int)boxes.size());
+}
+
+int
+Sisyphus::Scene::Bvh::build_node(int first, int count, int parent)
+{
+    int node_idx = (int)m_nodes.size();
+    m_nodes.push_back(BvhNode());
+    // up to 4 groups, the biggest one is split in halves along the longest
+    // axis of its centers until every group fits a leaf or there are 4 of them
+    int group_first[bvh_width] = {first};
+    int group_count[bvh_width] = {count};
+    int group_size = 1;
+    while (group_size < bvh_width)
+    {
+        int biggest = 0;
+        for (int g = 1; g < group_size; g++)
+        {
+            biggest = group_count[g] > group_count[biggest] ? g : biggest;
+        }
+        if (group_count[biggest] <= bvh_max_leaf_items)
+        {
+            break;
+        }
+        int          range_first = group_first[biggest];
+        int          range_count = group_count[biggest];
+        Base::vec3_t center_min {INFINITY, INFINITY, INFINITY};
+        Base::vec3_t center_max {-INFINITY, -INFINITY, -INFINITY};
+        for (int i = range_first; i < range_first + range_count; i++)
+        {
+            const Base::BoundingBox& box = m_boxes[m_items[i]];
+            Base::vec3_t             center = box.min + box.max;
+            center_min.x = std::min(center_min.x, center.x);
+            center_min.y = std::min(center_min.y, center.y);
+            center_min.z = std::min(center_min.z, center.z);
+            center_max.x = std::max(center_max.x, center.x);
+            center_max.y = std::max(center_max.y, center.y);
+            center_max.z = std::max(center_max.z, center.z);
+        }
+        Base::vec3_t extent = center_max - center_min;
+        int          axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        int          half = range_count / 2;
+        std::nth_element(
+            m_items.begin() + range_first, m_items.begin() + range_first + half,
+            m_items.begin() + range_first + range_count,
+            [this, axis](int a, int b)
+            {
+                return m_boxes[a].min[axis] + m_boxes[a].max[axis] < m_boxes[b].min[axis] + m_boxes[b].max[axis];
+            });
+        group_count[biggest] = half;
+        group_first[group_size] = range_first + half;
+        group_count[group_size] = range_count - half;
+        group_size++;
+    }
+    for (int slot = 0; slot < bvh_width; slot++)
+    {
+        m_nodes[node_idx].child[slot] = -1;
+        m_nodes[node_idx].first[slot] = slot < group_size ? group_first[slot] : 0;
+        m_nodes[node_idx].count[slot] = slot < group_size ? group_count[slot] : 0;
+    }
+    m_nodes[node_idx].parent = parent;
+    for (int slot = 0; slot < group_size; slot++)
+    {
+        if (group_count[slot] > bvh_max_leaf_items)
+        {
+            // m_nodes grows inside, no references are kept over the call
+            int child = this->build_node(group_first[slot], group_count[slot], node_idx);
+            m_nodes[node_idx].child[slot] = child;
+        }
+        else
+        {
+            for (int i = group_first[slot]; i < group_first[slot] + group_count[slot]; i++)
+            {
+                m_item_nodes[m_items[i]] = node_idx;
+            }
+        }
+    }
+    this->refit_node(node_idx);
+    return node_idx;
+}
+
+void
+Sisyphus::Scene::Bvh::refit_node(int node_idx)
+{
+    BvhNode& node = m_nodes[node_idx];
+    for (int slot = 0; slot < bvh_width; slot++)
+    {
+        Base::BoundingBox box = get_empty_box();
+        if (node.count[slot] > 0 && node.child[slot] < 0)
+        {
+            for (int i = node.first[slot]; i < node.first[slot] + node.count[slot]; i++)
+            {
+                merge_box(box, m_boxes[m_items[i]]);
+            }
+        }
+        else if (node.count[slot] > 0)
+        {
+            const BvhNode& child = m_nodes[node.child[slot]];
+            for (int child_slot = 0; child_slot < bvh_width; child_slot++)
+            {
+                if (child.count[child_slot] > 0)
+                {
+                    merge_box(box, get_slot_box(child, child_slot));
+                }
+            }
+        }
+        set_slot_box(node, slot, box);
+    }
+}
+
+void
+Sisyphus::Scene::Bvh::set_bounds(int instance, const Base::BoundingBox& box)
+{
+    m_boxes[instance] = box;
+    for (int node_idx = m_item_nodes[instance]; node_idx >= 0 && !m_dirty_nodes[node_idx];
+         node_idx = m_nodes[node_idx].parent)
+    {
+        m_dirty_nodes[node_idx] = 1;
+    }
+    m_dirty = true;
+}
+
+const Sisyphus::Base::BoundingBox&
+Sisyphus::Scene::Bvh::get_bounds(int instance) const
+{
+    return m_boxes[instance];
+}
+
+int
+Sisyphus::Scene::Bvh::get_instance_count() const
+{
+    return (int)m_boxes.size();
+}
+
+void
+Sisyphus::Scene::Bvh::refit()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+    // children always have bigger indices, so going backwards refits them first
+    for (int node_idx = (int)m_nodes.size() - 1; node_idx >= 0; node_idx--)
+    {
+        if (m_dirty_nodes[node_idx])
+        {
+            this->refit_node(node_idx);
+            m_dirty_nodes[node_idx] = 0;
+        }
+    }
+    m_dirty = false;
+}
+
+int
+Sisyphus::Scene::Bvh::query_frustum(const Render::Frustum& frustum, std::vector<int>& instances) const
+{
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+    size_t       start_size = instances.size();
+    FrustumEntry stack[max_stack_size];
+    int          stack_size = 0;
+    stack[stack_size++] = FrustumEntry {0, 0x3f};
+    while (stack_size > 0)
+    {
+        FrustumEntry   entry = stack[--stack_size];
+        const BvhNode& node = m_nodes[entry.node];
+        uint32_t       slot_planes[bvh_width];
+        int            outside_mask = test_node_planes(node, frustum, entry.planes, slot_planes);
+        for (int slot = 0; slot < bvh_width; slot++)
+        {
+            if (node.count[slot] == 0 || (outside_mask & (1 << slot)) != 0)
+            {
+                continue;
+            }
+            const int* items = &m_items[node.first[slot]];
+            if (slot_planes[slot] == 0)
+            {
+                // fully inside, the whole subtree is one contiguous range
+                instances.insert(instances.end(), items, items + node.count[slot]);
+            }
+            else if (node.child[slot] < 0)
+            {
+                for (int i = 0; i < node.count[slot]; i++)
+                {
+                    bool visible = true;
+                    for (int p = 0; p < 6 && visible; p++)
+                    {
+                        visible = (slot_planes[slot] & (1u << p)) == 0 ||
+                                  !is_box_outside_plane(m_boxes[items[i]], frustum.bounds[p]);
+                    }
+                    if (visible)
+                    {
+                        instances.push_back(items[i]);
+                    }
+                }
+            }
+            else
+            {
+                assert(stack_size < max_stack_size);
+                stack[stack_size++] = FrustumEntry {node.child[slot], slot_planes[slot]};
+            }
+        }
+    }
+    return (int)(instances.size() - start_size);
+}
+
+bool
+Sisyphus::Scene::Bvh::query_ray(
+    const Base::vec3_t& origin, const Base::vec3_t& direction, float max_distance, BvhRayHit& hit, BvhRayFunc func,
+    void* user_data) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+    Base::vec3_t inv_direction {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    float        best = max_distance;
+    int          best_instance = -1;
+    RayEntry     stack[max_stack_size];
+    int          stack_size = 0;
+    stack[stack_size++] = RayEntry {0, 0.0f};
+    while (stack_size > 0)
+    {
+        RayEntry entry = stack[--stack_size];
+        if (entry.distance > best)
+        {
+            continue;
+        }
+        const BvhNode& node = m_nodes[entry.node];
+        float          distances[bvh_width];
+        intersect_node_slots(node, origin, inv_direction, best, distances);
+        // nearest child is pushed last to be visited first
+        int order[bvh_width];
+        int hit_count = 0;
+        for (int slot = 0; slot < bvh_width; slot++)
+        {
+            if (node.count[slot] == 0 || distances[slot] == INFINITY)
+            {
+                continue;
+            }
+            int i = hit_count++;
+            while (i > 0 && distances[order[i - 1]] < distances[slot])
+            {
+                order[i] = order[i - 1];
+                i--;
+            }
+            order[i] = slot;
+        }
+        for (int i = 0; i < hit_count; i++)
+        {
+            int slot = order[i];
+            if (node.child[slot] >= 0)
+            {
+                assert(stack_size < max_stack_size);
+                stack[stack_size++] = RayEntry {node.child[slot], distances[slot]};
+                continue;
+            }
+            for (int j = node.first[slot]; j < node.first[slot] + node.count[slot]; j++)
+            {
+                int   instance = m_items[j];
+                float distance = intersect_box(m_boxes[instance], origin, inv_direction, best);
+                if (distance == INFINITY)
+                {
+                    continue;
+                }
+                if (func != nullptr)
+                {
+                    distance = func(instance, origin, direction, user_data);
+                    if (distance < 0.0f || distance > best)
+                    {
+                        continue;
+                    }
+                }
+                best = distance;
+                best_instance = instance;
+            }
+        }
+    }
+    if (best_instance < 0)
+    {
+        return false;
+    }
+    hit.instance = best_instance;
+    hit.distance = best;
+    return true;
+}
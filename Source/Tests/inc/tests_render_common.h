@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+#include "render_context.h"
+#include "base_bounds.h"
+
+namespace Sisyphus
+{
+namespace Tests
+{
+    // scene shared by the render tests: camera at the origin looking along z through a
+    // 90 degree perspective, identity model and view, position is the only vertex output
+    inline Base::vec4_t
+    get_view_position(const Base::vec4_t& input, const std::vector<uint8_t>& builtins)
+    {
+        const Base::mat4_t* model_view = reinterpret_cast<const Base::mat4_t*>(builtins.data()) + 3;
+        return (*model_view) * input;
+    }
+    // instance data, if any, starts with a vec4 offset
+    inline void
+    vertex_shader(
+        const Base::vec4_t& input, Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out, const uint8_t*,
+        const std::vector<uint8_t>& builtins, const std::vector<uint8_t>&)
+    {
+        output = get_view_position(input, builtins);
+        const uint8_t* instance_data = Render::get_instance_data(builtins);
+        if (instance_data != nullptr)
+        {
+            output = output + *reinterpret_cast<const Base::vec4_t*>(instance_data);
+        }
+        memcpy(per_vertex_out.data(), &output, sizeof(Base::vec4_t));
+    }
+    inline Base::vec4_t
+    pixel_shader(const Base::vec4_t&, const uint8_t*, const std::vector<uint8_t>&, const std::vector<uint8_t>&)
+    {
+        return Base::vec4_t {1.0f, 1.0f, 1.0f, 1.0f};
+    }
+    inline void
+    setup_context(Render::Context& context, int width, int height)
+    {
+        context.set_viewport(0, 0, 0, (float)width, (float)height, 1);
+        context.set_perspective(90.0f, 1.0f, 0.5f, 100.0f);
+        context.set_model_matrix(Base::mat4_t::get_identity_matrix());
+        context.set_view_matrix(Base::mat4_t::get_identity_matrix());
+        context.set_vertex_shader(vertex_shader);
+        context.set_pixel_shader(pixel_shader);
+        context.clear_depth(0.0f);
+    }
+    // shaders above ignore the vertex data, a float per vertex is enough
+    inline Render::VertexFormat
+    get_input_format()
+    {
+        return Render::VertexFormat({Render::EVertexAttribType::FLOAT32});
+    }
+    inline Render::VertexFormat
+    get_output_format()
+    {
+        return Render::VertexFormat({Render::EVertexAttribType::VEC4});
+    }
+    // square facing the camera, draw it with get_quad_indices
+    inline std::vector<Base::vec4_t>
+    create_quad(float x, float y, float z, float half_size)
+    {
+        return std::vector<Base::vec4_t> {
+            {x - half_size, y - half_size, z, 1.0f},
+            {x + half_size, y - half_size, z, 1.0f},
+            {x + half_size, y + half_size, z, 1.0f},
+            {x - half_size, y + half_size, z, 1.0f},
+        };
+    }
+    inline std::vector<int>
+    get_quad_indices()
+    {
+        return std::vector<int> {0, 1, 2, 0, 2, 3};
+    }
+    // wall from -3 to 3 at distance 5, covers the middle of the screen
+    inline std::vector<Base::vec4_t>
+    create_wall()
+    {
+        return create_quad(0.0f, 0.0f, 5.0f, 3.0f);
+    }
+    inline Base::BoundingBox
+    create_box(float x, float y, float z, float half_size)
+    {
+        Base::BoundingBox box;
+        box.min = Base::vec3_t {x - half_size, y - half_size, z - half_size};
+        box.max = Base::vec3_t {x + half_size, y + half_size, z + half_size};
+        return box;
+    }
+    // copy of the latest presented frame, empty if there is none
+    inline std::vector<uint8_t>
+    read_frame(Render::Context& context)
+    {
+        std::vector<uint8_t>       pixels;
+        const Render::FrameBuffer* frame = context.acquire_frame();
+        if (frame == nullptr)
+        {
+            return pixels;
+        }
+        pixels.assign(frame->get_data(), frame->get_data() + frame->get_size());
+        context.release_frame(frame);
+        return pixels;
+    }
+} // namespace Tests
+} // namespace Sisyphus
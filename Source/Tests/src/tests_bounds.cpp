@@ -0,0 +1,54 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "base_bounds.h"
+#include "base_utils.h"
+
+#include <vector>
+
+TEST_CASE("Sisyphus::Base bounds tests", "[Base::bounds]")
+{
+    using namespace Sisyphus::Base;
+    std::vector<vec3_t> points = {
+        {-1.0f, 0.0f, 2.0f},
+        {3.0f, -2.0f, 0.0f},
+        {1.0f, 4.0f, 1.0f},
+    };
+    SECTION("box and sphere enclose every point")
+    {
+        Bounds bounds = calculate_bounds(points);
+        REQUIRE(bounds.box.min == vec3_t {-1.0f, -2.0f, 0.0f});
+        REQUIRE(bounds.box.max == vec3_t {3.0f, 4.0f, 2.0f});
+        REQUIRE(bounds.sphere.center == vec3_t {1.0f, 1.0f, 1.0f});
+        for (const vec3_t& p : points)
+        {
+            vec3_t d = p - bounds.sphere.center;
+            REQUIRE(d.calculate_dot_product(d) <= bounds.sphere.radius * bounds.sphere.radius + 1e-5f);
+        }
+        Bounds empty = calculate_bounds(std::vector<vec3_t>());
+        REQUIRE(empty.sphere.radius == 0.0f);
+    }
+    SECTION("transformed volumes follow translation, rotation and scale")
+    {
+        Bounds bounds = calculate_bounds(points);
+        mat4_t m = mat4_t::calculate_rotation_matrix_around_z(0.5f);
+        m.r0 = m.r0 * 2.0f;
+        m.r1 = m.r1 * 2.0f;
+        m.r2 = m.r2 * 2.0f;
+        m.r0.w = 5.0f;
+        m.r2.w = -3.0f;
+        BoundingSphere sphere = transform_sphere(bounds.sphere, m);
+        BoundingBox    box = transform_box(bounds.box, m);
+        REQUIRE(EQUAL_FLOATS(sphere.radius, bounds.sphere.radius * 2.0f));
+        for (const vec3_t& p : points)
+        {
+            vec4_t t = m * vec4_t {p.x, p.y, p.z, 1.0f};
+            vec3_t d = t.xyz - sphere.center;
+            REQUIRE(d.calculate_dot_product(d) <= sphere.radius * sphere.radius + 1e-4f);
+            REQUIRE(t.x >= box.min.x - 1e-5f);
+            REQUIRE(t.y >= box.min.y - 1e-5f);
+            REQUIRE(t.z >= box.min.z - 1e-5f);
+            REQUIRE(t.x <= box.max.x + 1e-5f);
+            REQUIRE(t.y <= box.max.y + 1e-5f);
+            REQUIRE(t.z <= box.max.z + 1e-5f);
+        }
+    }
+}
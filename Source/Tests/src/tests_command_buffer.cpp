@@ -0,0 +1,197 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_command_buffer.h"
+#include "render_context.h"
+#include "render_pipeline_state.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+static Sisyphus::Base::vec4_t
+red_shader(const Sisyphus::Base::vec4_t&, const uint8_t*, const std::vector<uint8_t>&, const std::vector<uint8_t>&)
+{
+    return Sisyphus::Base::vec4_t {1.0f, 0.0f, 0.0f, 1.0f};
+}
+
+static Sisyphus::Base::vec4_t
+blue_shader(const Sisyphus::Base::vec4_t&, const uint8_t*, const std::vector<uint8_t>&, const std::vector<uint8_t>&)
+{
+    return Sisyphus::Base::vec4_t {0.0f, 0.0f, 1.0f, 1.0f};
+}
+
+// half transparent, so blending changes the result
+static Sisyphus::Base::vec4_t
+green_shader(const Sisyphus::Base::vec4_t&, const uint8_t*, const std::vector<uint8_t>&, const std::vector<uint8_t>&)
+{
+    return Sisyphus::Base::vec4_t {0.0f, 1.0f, 0.0f, 0.5f};
+}
+
+// the same calls go to a context directly or to a command buffer, which keeps pointers to the arguments
+template <typename Target>
+static void
+record_scene(
+    Target& target, const std::vector<Sisyphus::Base::vec4_t>& far_quad,
+    const std::vector<Sisyphus::Base::vec4_t>& near_quad, const std::vector<int>& indices,
+    const std::vector<uint8_t>& vertex_data, const Sisyphus::Render::VertexFormat& v_in_format,
+    const Sisyphus::Render::VertexFormat& v_out_format)
+{
+    Sisyphus::Base::mat4_t shift = Sisyphus::Base::mat4_t::get_identity_matrix();
+    shift.r0.w = 1.0f;
+    target.fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+    target.clear_depth(0.0f);
+    target.set_pixel_shader(blue_shader);
+    target.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+    // hidden by the near quad where they overlap
+    target.set_pixel_shader(red_shader);
+    target.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+    // drawn over everything, shifted to the right
+    target.set_depth_test(false);
+    target.set_model_matrix(shift);
+    target.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+    target.set_model_matrix(Sisyphus::Base::mat4_t::get_identity_matrix());
+    target.set_depth_test(true);
+}
+
+TEST_CASE("Sisyphus::Render command buffer tests", "[Render::command_buffer]")
+{
+    Sisyphus::Render::Context recorded(64, 64, 4);
+    Sisyphus::Render::Context immediate(64, 64, 4);
+    Sisyphus::Tests::setup_context(recorded, 64, 64);
+    Sisyphus::Tests::setup_context(immediate, 64, 64);
+    Sisyphus::Render::VertexFormat      v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat      v_out_format = Sisyphus::Tests::get_output_format();
+    std::vector<int>                    indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>                vertex_data(4 * sizeof(float));
+    std::vector<Sisyphus::Base::vec4_t> far_quad = Sisyphus::Tests::create_quad(0.0f, 0.0f, 6.0f, 3.0f);
+    std::vector<Sisyphus::Base::vec4_t> near_quad = Sisyphus::Tests::create_quad(-1.0f, 0.0f, 4.0f, 1.0f);
+    Sisyphus::Render::CommandBuffer     buffer;
+    SECTION("submitted buffers render like immediate calls")
+    {
+        record_scene(immediate, far_quad, near_quad, indices, vertex_data, v_in_format, v_out_format);
+        immediate.present();
+        record_scene(buffer, far_quad, near_quad, indices, vertex_data, v_in_format, v_out_format);
+        recorded.submit(buffer);
+        recorded.present();
+        std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(immediate);
+        REQUIRE(!frame.empty());
+        REQUIRE(Sisyphus::Tests::read_frame(recorded) == frame);
+        // both buffers in one submit, the second one starts from the state the first one ended with
+        Sisyphus::Render::CommandBuffer second;
+        record_scene(second, near_quad, far_quad, indices, vertex_data, v_in_format, v_out_format);
+        record_scene(immediate, near_quad, far_quad, indices, vertex_data, v_in_format, v_out_format);
+        immediate.present();
+        const Sisyphus::Render::CommandBuffer* buffers[] = {&buffer, &second};
+        recorded.submit(buffers, 2);
+        recorded.present();
+        REQUIRE(Sisyphus::Tests::read_frame(recorded) == Sisyphus::Tests::read_frame(immediate));
+    }
+    SECTION("buffers submitted under a bound pipeline state draw with it")
+    {
+        Sisyphus::Render::RasterState raster;
+        raster.blend = Sisyphus::Render::EBlendMode::Alpha;
+        Sisyphus::Render::PipelineState pipeline(
+            Sisyphus::Tests::vertex_shader, green_shader, v_in_format, v_out_format, raster);
+        recorded.set_pipeline_state(&pipeline);
+        immediate.set_pipeline_state(&pipeline);
+        buffer.fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+        buffer.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        buffer.draw_triangles_sorted(near_quad, indices, vertex_data.data(), v_in_format, v_out_format, 4.0f);
+        recorded.submit(buffer);
+        recorded.present();
+        immediate.fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+        immediate.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.present();
+        std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(immediate);
+        REQUIRE(Sisyphus::Tests::read_frame(recorded) == frame);
+        // blended over the background and not written over it
+        REQUIRE(frame[(32 * 64 + 32) * 4 + 1] > 32);
+        REQUIRE(frame[(32 * 64 + 32) * 4 + 1] < 255);
+        // the caller's pipeline stays bound for direct draws
+        REQUIRE(recorded.get_pipeline_state() == &pipeline);
+    }
+    SECTION("blend modes and pipeline states are recorded")
+    {
+        Sisyphus::Render::RasterState   raster;
+        Sisyphus::Render::PipelineState pipeline(
+            Sisyphus::Tests::vertex_shader, red_shader, v_in_format, v_out_format, raster);
+        // the legacy state is changed under the bound pipeline, which then no longer applies
+        buffer.fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+        buffer.set_pipeline_state(&pipeline);
+        buffer.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        buffer.set_pixel_shader(green_shader);
+        buffer.set_blend_mode(Sisyphus::Render::EBlendMode::Alpha);
+        buffer.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        buffer.set_blend_mode(Sisyphus::Render::EBlendMode::Opaque);
+        recorded.submit(buffer);
+        recorded.present();
+        immediate.fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+        immediate.set_pipeline_state(&pipeline);
+        immediate.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.set_pixel_shader(green_shader);
+        immediate.set_blend_mode(Sisyphus::Render::EBlendMode::Alpha);
+        immediate.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.set_blend_mode(Sisyphus::Render::EBlendMode::Opaque);
+        immediate.present();
+        std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(immediate);
+        REQUIRE(Sisyphus::Tests::read_frame(recorded) == frame);
+        // bgra, green half over the red far quad
+        REQUIRE(frame[(32 * 64 + 21) * 4 + 2] > 64);
+        REQUIRE(frame[(32 * 64 + 21) * 4 + 1] > 64);
+        REQUIRE(recorded.get_pipeline_state() == nullptr);
+    }
+    SECTION("sorted draws do not cross fills and clears")
+    {
+        // the near quad is sorted first, but the fill after it has to erase it
+        buffer.set_pixel_shader(red_shader);
+        buffer.draw_triangles_sorted(near_quad, indices, vertex_data.data(), v_in_format, v_out_format, 4.0f);
+        buffer.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        buffer.clear_depth(0.0f);
+        buffer.set_pixel_shader(blue_shader);
+        buffer.draw_triangles_sorted(far_quad, indices, vertex_data.data(), v_in_format, v_out_format, 6.0f);
+        recorded.submit(buffer);
+        recorded.present();
+        immediate.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        immediate.set_pixel_shader(blue_shader);
+        immediate.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.present();
+        REQUIRE(Sisyphus::Tests::read_frame(recorded) == Sisyphus::Tests::read_frame(immediate));
+    }
+    SECTION("sorted draws keep the viewport they were recorded with")
+    {
+        buffer.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        buffer.set_viewport(0, 0, 0, 32, 64, 1);
+        buffer.draw_triangles_sorted(far_quad, indices, vertex_data.data(), v_in_format, v_out_format, 6.0f);
+        buffer.set_viewport(32, 0, 0, 64, 64, 1);
+        buffer.draw_triangles_sorted(near_quad, indices, vertex_data.data(), v_in_format, v_out_format, 4.0f);
+        recorded.submit(buffer);
+        recorded.present();
+        immediate.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        immediate.set_viewport(0, 0, 0, 32, 64, 1);
+        immediate.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.set_viewport(32, 0, 0, 64, 64, 1);
+        immediate.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        immediate.present();
+        REQUIRE(Sisyphus::Tests::read_frame(recorded) == Sisyphus::Tests::read_frame(immediate));
+    }
+    SECTION("sorted draws go front to back")
+    {
+        // recorded back to front, without depth writes the last draw over a pixel owns it
+        Sisyphus::Render::PickResult result;
+        recorded.set_id_buffer(true, false);
+        recorded.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        buffer.set_depth_write(false);
+        buffer.set_object_id(1);
+        buffer.draw_triangles_sorted(far_quad, indices, vertex_data.data(), v_in_format, v_out_format, 6.0f);
+        buffer.set_object_id(2);
+        buffer.draw_triangles_sorted(near_quad, indices, vertex_data.data(), v_in_format, v_out_format, 4.0f);
+        buffer.set_depth_write(true);
+        recorded.submit(buffer);
+        REQUIRE(recorded.pick(21, 32, result));
+        REQUIRE(result.object_id == 1);
+        // the same draws in recorded order
+        recorded.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        recorded.submit(buffer, false);
+        REQUIRE(recorded.pick(21, 32, result));
+        REQUIRE(result.object_id == 2);
+    }
+}
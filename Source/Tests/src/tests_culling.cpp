@@ -0,0 +1,135 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_culling.h"
+#include "tests_render_common.h"
+
+#include <cstdlib>
+#include <vector>
+
+static float
+get_random(float min, float max)
+{
+    return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+TEST_CASE("Sisyphus::Render culling tests", "[Render::culling]")
+{
+    Sisyphus::Render::Frustum frustum =
+        Sisyphus::Render::calculate_frustum(Sisyphus::Base::pi * 0.5f, 1.0f, 0.5f, 100.0f);
+    srand(7);
+    SECTION("batched sphere tests match single ones")
+    {
+        // random spheres around the frustum, and spheres touching every plane from both sides
+        std::vector<Sisyphus::Base::vec4_t> spheres;
+        for (int i = 0; i < 200; i++)
+        {
+            spheres.push_back(Sisyphus::Base::vec4_t {
+                get_random(-60.0f, 60.0f), get_random(-60.0f, 60.0f), get_random(-10.0f, 110.0f),
+                get_random(0.0f, 10.0f)});
+        }
+        for (int j = 0; j < 6; j++)
+        {
+            const Sisyphus::Render::Plane& plane = frustum.bounds[j];
+            // a point of the plane inside the other planes, the middle of the near or far plane for those two
+            Sisyphus::Base::vec3_t on_plane = plane.normal * -plane.offset;
+            if (j >= 4 || on_plane.z < 0.5f)
+            {
+                on_plane = Sisyphus::Base::vec3_t {0.0f, 0.0f, 10.0f};
+                on_plane = on_plane - plane.normal * (plane.normal.calculate_dot_product(on_plane) + plane.offset);
+            }
+            for (float distance : {-1.5f, -1.0f, -0.5f, 0.0f, 0.5f, 0.999f, 1.001f, 1.5f})
+            {
+                Sisyphus::Base::vec3_t center = on_plane + plane.normal * distance;
+                spheres.push_back(Sisyphus::Base::vec4_t {center.x, center.y, center.z, 1.0f});
+            }
+        }
+        // counts that leave a scalar tail after the groups of four
+        for (int count : {0, 1, 3, 4, 5, 7, 13, 101, (int)spheres.size()})
+        {
+            std::vector<uint8_t> visible(count + 1, 2);
+            Sisyphus::Render::cull_spheres(spheres.data(), count, frustum, visible.data());
+            for (int i = 0; i < count; i++)
+            {
+                Sisyphus::Base::BoundingSphere sphere {spheres[i].xyz, spheres[i].w};
+                REQUIRE(visible[i] == (uint8_t)Sisyphus::Render::is_sphere_visible(sphere, frustum));
+            }
+            REQUIRE(visible[count] == 2);
+        }
+        int                  visible_count = 0;
+        std::vector<uint8_t> visible(spheres.size());
+        Sisyphus::Render::cull_spheres(spheres.data(), (int)spheres.size(), frustum, visible.data());
+        for (uint8_t v : visible)
+        {
+            visible_count += v;
+        }
+        REQUIRE(visible_count > 0);
+        REQUIRE(visible_count < (int)spheres.size());
+    }
+    SECTION("boxes inside, outside and across the frustum")
+    {
+        REQUIRE(Sisyphus::Render::is_box_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 10.0f, 1.0f), frustum));
+        REQUIRE(Sisyphus::Render::is_box_visible(Sisyphus::Tests::create_box(10.0f, 0.0f, 10.0f, 1.0f), frustum));
+        REQUIRE(Sisyphus::Render::is_box_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 0.0f, 1.0f), frustum));
+        REQUIRE_FALSE(Sisyphus::Render::is_box_visible(Sisyphus::Tests::create_box(14.0f, 0.0f, 10.0f, 1.0f), frustum));
+        REQUIRE_FALSE(Sisyphus::Render::is_box_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, -5.0f, 1.0f), frustum));
+        REQUIRE_FALSE(Sisyphus::Render::is_box_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 102.0f, 1.0f), frustum));
+    }
+    SECTION("frustums moved by a scaling matrix keep unit normals")
+    {
+        // model space is scaled twice and moved along z, spheres scale with it
+        Sisyphus::Base::mat4_t m = Sisyphus::Base::mat4_t::get_identity_matrix();
+        m.r0.x = 2.0f;
+        m.r1.y = 2.0f;
+        m.r2.z = 2.0f;
+        m.r2.w = 3.0f;
+        Sisyphus::Render::Frustum model_frustum = Sisyphus::Render::transform_frustum(frustum, m);
+        for (int j = 0; j < 6; j++)
+        {
+            REQUIRE(model_frustum.bounds[j].normal.calculate_magnitude() == Catch::Approx(1.0f));
+        }
+        for (int i = 0; i < 500; i++)
+        {
+            Sisyphus::Base::BoundingSphere sphere {
+                Sisyphus::Base::vec3_t {
+                    get_random(-30.0f, 30.0f), get_random(-30.0f, 30.0f), get_random(-5.0f, 55.0f)},
+                get_random(0.0f, 5.0f)};
+            Sisyphus::Base::BoundingSphere view_sphere {
+                Sisyphus::Base::vec3_t {
+                    sphere.center.x * 2.0f, sphere.center.y * 2.0f, sphere.center.z * 2.0f + 3.0f},
+                sphere.radius * 2.0f};
+            REQUIRE(
+                Sisyphus::Render::is_sphere_visible(sphere, model_frustum) ==
+                Sisyphus::Render::is_sphere_visible(view_sphere, frustum));
+        }
+    }
+    SECTION("batched bounds tests match single ones")
+    {
+        // one box in many places, a nullptr is never culled
+        std::vector<Sisyphus::Base::vec3_t>        points = {{-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}};
+        Sisyphus::Base::Bounds                     bounds = Sisyphus::Base::calculate_bounds(points);
+        std::vector<Sisyphus::Base::mat4_t>        model_views;
+        std::vector<const Sisyphus::Base::Bounds*> bounds_list;
+        for (int i = 0; i < 103; i++)
+        {
+            Sisyphus::Base::mat4_t model_view = Sisyphus::Base::mat4_t::get_identity_matrix();
+            model_view.r0.w = get_random(-30.0f, 30.0f);
+            model_view.r1.w = get_random(-30.0f, 30.0f);
+            model_view.r2.w = get_random(-5.0f, 40.0f);
+            model_views.push_back(model_view);
+            bounds_list.push_back(i % 10 == 9 ? nullptr : &bounds);
+        }
+        std::vector<uint8_t> visible(bounds_list.size());
+        int                  visible_count = Sisyphus::Render::cull_bounds(
+            bounds_list.data(), model_views.data(), (int)bounds_list.size(), frustum, visible.data());
+        int expected_count = 0;
+        for (size_t i = 0; i < bounds_list.size(); i++)
+        {
+            bool expected = bounds_list[i] == nullptr ||
+                            Sisyphus::Render::is_visible(*bounds_list[i], model_views[i], frustum);
+            REQUIRE(visible[i] == (uint8_t)expected);
+            expected_count += expected;
+        }
+        REQUIRE(visible_count == expected_count);
+        REQUIRE(visible_count > 10);
+        REQUIRE(visible_count < (int)bounds_list.size());
+    }
+}
@@ -0,0 +1,152 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_command_buffer.h"
+#include "render_context.h"
+#include "render_dirty_tiles.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+// depth shows up in the frame, so moved draws change pixels
+static Sisyphus::Base::vec4_t
+pixel_shader(
+    const Sisyphus::Base::vec4_t& input, const uint8_t*, const std::vector<uint8_t>&, const std::vector<uint8_t>&)
+{
+    return Sisyphus::Base::vec4_t {input.z * 0.1f, 1.0f, 1.0f, 1.0f};
+}
+
+// like Tests::read_frame, with the rects that changed since the frame before it
+static std::vector<uint8_t>
+read_frame(Sisyphus::Render::Context& context, std::vector<Sisyphus::Render::ScreenRect>& dirty_rects)
+{
+    std::vector<uint8_t>                 pixels;
+    const Sisyphus::Render::FrameBuffer* frame = context.acquire_frame();
+    dirty_rects.clear();
+    if (frame == nullptr)
+    {
+        return pixels;
+    }
+    pixels.assign(frame->get_data(), frame->get_data() + frame->get_size());
+    dirty_rects = frame->dirty_rects;
+    context.release_frame(frame);
+    return pixels;
+}
+
+TEST_CASE("Sisyphus::Render dirty tiles tests", "[Render::dirty_tiles]")
+{
+    Sisyphus::Render::VertexFormat v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat v_out_format = Sisyphus::Tests::get_output_format();
+    std::vector<int>               indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>           vertex_data(4 * sizeof(float));
+    SECTION("draws that appear, move or disappear mark only their tiles")
+    {
+        Sisyphus::Render::DirtyTiles              tiles(16);
+        std::vector<Sisyphus::Render::ScreenRect> rects;
+        tiles.begin_frame(64, 64);
+        tiles.add_draw(1, Sisyphus::Render::ScreenRect {0, 0, 10, 10});
+        tiles.add_draw(2, Sisyphus::Render::ScreenRect {40, 40, 50, 50});
+        tiles.end_frame(1, 0);
+        tiles.get_changed_rects(rects);
+        REQUIRE(rects.size() == 1);
+        REQUIRE(rects[0].x_max - rects[0].x_min == 64);
+        REQUIRE(rects[0].y_max - rects[0].y_min == 64);
+        // same draws in another order
+        tiles.begin_frame(64, 64);
+        tiles.add_draw(2, Sisyphus::Render::ScreenRect {40, 40, 50, 50});
+        tiles.add_draw(1, Sisyphus::Render::ScreenRect {0, 0, 10, 10});
+        tiles.end_frame(2, 1);
+        tiles.get_changed_rects(rects);
+        REQUIRE(rects.empty());
+        tiles.get_redraw_rects(rects);
+        REQUIRE(rects.empty());
+        tiles.begin_frame(64, 64);
+        tiles.add_draw(1, Sisyphus::Render::ScreenRect {0, 0, 10, 10});
+        tiles.add_draw(2, Sisyphus::Render::ScreenRect {40, 20, 50, 30});
+        tiles.end_frame(3, 2);
+        tiles.get_changed_rects(rects);
+        REQUIRE(rects.size() == 1);
+        REQUIRE(rects[0].x_min == 32);
+        REQUIRE(rects[0].y_min == 16);
+        REQUIRE(rects[0].x_max == 64);
+        REQUIRE(rects[0].y_max == 64);
+        REQUIRE(!tiles.is_redraw_tile(0, 0));
+        REQUIRE(tiles.is_redraw_tile(2, 1));
+        // back buffer two frames behind also misses the changes of frame 3
+        tiles.begin_frame(64, 64);
+        tiles.add_draw(1, Sisyphus::Render::ScreenRect {0, 0, 10, 10});
+        tiles.add_draw(2, Sisyphus::Render::ScreenRect {40, 20, 50, 30});
+        tiles.end_frame(4, 2);
+        tiles.get_changed_rects(rects);
+        REQUIRE(rects.empty());
+        REQUIRE(tiles.is_redraw_tile(2, 1));
+        // skipped frame
+        tiles.begin_frame(64, 64);
+        tiles.end_frame(6, 5);
+        REQUIRE(tiles.is_redraw_tile(0, 0));
+        REQUIRE(tiles.is_redraw_tile(3, 3));
+    }
+    SECTION("incremental submits match full ones")
+    {
+        Sisyphus::Render::Context full(128, 128, 4);
+        Sisyphus::Render::Context incremental(128, 128, 4);
+        Sisyphus::Tests::setup_context(full, 128, 128);
+        Sisyphus::Tests::setup_context(incremental, 128, 128);
+        full.set_pixel_shader(pixel_shader);
+        incremental.set_pixel_shader(pixel_shader);
+        Sisyphus::Render::DirtyTiles              tiles(16);
+        std::vector<Sisyphus::Render::ScreenRect> dirty_rects;
+        std::vector<Sisyphus::Base::vec4_t>       left = Sisyphus::Tests::create_quad(-1.0f, 0.0f, 4.0f, 0.5f);
+        std::vector<Sisyphus::Base::vec4_t>       right = Sisyphus::Tests::create_quad(1.0f, 0.0f, 4.0f, 0.5f);
+        for (int frame = 0; frame < 6; frame++)
+        {
+            if (frame == 3)
+            {
+                right = Sisyphus::Tests::create_quad(1.0f, 1.0f, 4.0f, 0.5f);
+            }
+            Sisyphus::Render::CommandBuffer buffer;
+            buffer.fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+            buffer.clear_depth(0.0f);
+            buffer.draw_triangles(left, indices, vertex_data.data(), v_in_format, v_out_format);
+            buffer.draw_triangles(right, indices, vertex_data.data(), v_in_format, v_out_format);
+            full.submit(buffer);
+            full.present();
+            incremental.submit_incremental(buffer, tiles);
+            incremental.present();
+            REQUIRE(read_frame(incremental, dirty_rects) == Sisyphus::Tests::read_frame(full));
+            if (frame == 0)
+            {
+                REQUIRE(dirty_rects.size() == 1);
+                REQUIRE(dirty_rects[0].x_max - dirty_rects[0].x_min == 128);
+            }
+            else if (frame == 3)
+            {
+                REQUIRE(!dirty_rects.empty());
+                for (const Sisyphus::Render::ScreenRect& rect : dirty_rects)
+                {
+                    REQUIRE(rect.x_min >= 64);
+                }
+            }
+            else
+            {
+                REQUIRE(dirty_rects.empty());
+            }
+        }
+    }
+    SECTION("scissor limits fills")
+    {
+        Sisyphus::Render::Context context(32, 32, 4);
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 0});
+        context.set_scissor(Sisyphus::Render::ScreenRect {8, 8, 16, 16});
+        context.fill(Sisyphus::Render::col4u_t {255, 255, 255, 255});
+        context.reset_scissor();
+        context.present();
+        std::vector<uint8_t> pixels = Sisyphus::Tests::read_frame(context);
+        int                  lit = 0;
+        for (int i = 0; i < 32 * 32; i++)
+        {
+            lit += pixels[i * 4] != 0;
+        }
+        REQUIRE(lit == 64);
+        REQUIRE(pixels[(8 * 32 + 8) * 4] != 0);
+        REQUIRE(pixels[(7 * 32 + 8) * 4] == 0);
+    }
+}
@@ -0,0 +1,140 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_command_buffer.h"
+#include "render_draw_queue.h"
+#include "render_pipeline_state.h"
+#include "tests_render_common.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static std::atomic<int> s_shaded_vertices(0);
+
+static void
+vertex_shader(
+    const Sisyphus::Base::vec4_t& input, Sisyphus::Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out,
+    const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins, const std::vector<uint8_t>& descriptor_set)
+{
+    Sisyphus::Tests::vertex_shader(input, output, per_vertex_out, per_vertex_data, builtins, descriptor_set);
+    s_shaded_vertices++;
+}
+
+TEST_CASE("Sisyphus::Render draw queue tests", "[Render::draw_queue]")
+{
+    const int                           producer_count = 4;
+    const int                           per_producer = 200;
+    Sisyphus::Render::VertexFormat      v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat      v_out_format = Sisyphus::Tests::get_output_format();
+    Sisyphus::Render::RasterState       raster;
+    Sisyphus::Render::PipelineState     pipeline(
+        vertex_shader, Sisyphus::Tests::pixel_shader, v_in_format, v_out_format, raster);
+    std::vector<Sisyphus::Base::vec4_t> quad = Sisyphus::Tests::create_quad(0.0f, 0.0f, 5.0f, 0.5f);
+    std::vector<int>                    indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>                vertex_data(quad.size() * sizeof(float));
+    Sisyphus::Render::CommandBuffer     setup;
+    setup.set_viewport(0, 0, 0, 64, 64, 1);
+    setup.set_perspective(90.0f, 1.0f, 0.5f, 100.0f);
+    setup.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+    setup.clear_depth(0.0f);
+    s_shaded_vertices = 0;
+    SECTION("packets of several producers are all executed")
+    {
+        // small queue, so producers also wait for free slots
+        Sisyphus::Render::DrawQueue  queue(64, 64, 4, 8);
+        Sisyphus::Render::DrawPacket commands;
+        commands.type = Sisyphus::Render::EDrawPacketType::Commands;
+        commands.commands = &setup;
+        queue.submit(commands);
+        queue.flush();
+        std::vector<std::thread> producers;
+        for (int p = 0; p < producer_count; p++)
+        {
+            producers.emplace_back(
+                [&, p]()
+                {
+                    // every producer draws its own column of the screen
+                    Sisyphus::Render::DrawPacket packet;
+                    packet.pipeline = &pipeline;
+                    packet.coords = &quad;
+                    packet.indices = &indices;
+                    packet.vertex_data = vertex_data.data();
+                    packet.model_matrix.r0.w = -3.75f + 2.5f * p;
+                    for (int i = 0; i < per_producer; i++)
+                    {
+                        if (!queue.try_submit(packet))
+                        {
+                            queue.submit(packet);
+                        }
+                    }
+                });
+        }
+        for (std::thread& producer : producers)
+        {
+            producer.join();
+        }
+        Sisyphus::Render::DrawPacket present;
+        present.type = Sisyphus::Render::EDrawPacketType::Present;
+        queue.submit(present);
+        queue.flush();
+        Sisyphus::Render::DrawQueueStats stats = queue.get_stats();
+        REQUIRE(stats.submitted == producer_count * per_producer + 2);
+        REQUIRE(stats.executed == stats.submitted);
+        REQUIRE(stats.max_queue_size <= 8);
+        REQUIRE(s_shaded_vertices == producer_count * per_producer * 4);
+        const Sisyphus::Render::FrameBuffer* frame = queue.acquire_frame();
+        REQUIRE(frame != nullptr);
+        const uint8_t* pixels = frame->get_data();
+        for (int p = 0; p < producer_count; p++)
+        {
+            // middle of the quad of the producer, the screen is 10 units wide at distance 5
+            int x = (int)(32.0f + (-3.75f + 2.5f * p) * 6.4f);
+            REQUIRE(pixels[(32 * 64 + x) * 4] == 255);
+        }
+        REQUIRE(pixels[(32 * 64 + 1) * 4] == 0);
+        queue.release_frame(frame);
+    }
+    SECTION("flush waits for its own packet while another producer keeps submitting")
+    {
+        // the other producer may have a packet executed before it is counted,
+        // flush of this thread should still wait for the draw it has submitted
+        Sisyphus::Render::DrawQueue     queue(64, 64, 4, 8);
+        Sisyphus::Render::CommandBuffer empty;
+        Sisyphus::Render::DrawPacket    commands;
+        commands.type = Sisyphus::Render::EDrawPacketType::Commands;
+        commands.commands = &setup;
+        queue.submit(commands);
+        queue.flush();
+        std::atomic<bool> stop(false);
+        std::thread       producer(
+            [&]()
+            {
+                Sisyphus::Render::DrawPacket nop;
+                nop.type = Sisyphus::Render::EDrawPacketType::Commands;
+                nop.commands = &empty;
+                while (!stop.load())
+                {
+                    queue.submit(nop);
+                    std::this_thread::yield();
+                }
+            });
+        Sisyphus::Render::DrawPacket packet;
+        packet.pipeline = &pipeline;
+        packet.coords = &quad;
+        packet.indices = &indices;
+        packet.vertex_data = vertex_data.data();
+        int not_executed = 0;
+        for (int i = 0; i < 2000; i++)
+        {
+            int shaded = s_shaded_vertices.load();
+            queue.submit(packet);
+            queue.flush();
+            if (s_shaded_vertices.load() != shaded + 4)
+            {
+                not_executed++;
+            }
+        }
+        stop.store(true);
+        producer.join();
+        REQUIRE(not_executed == 0);
+    }
+}
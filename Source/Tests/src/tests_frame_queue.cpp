@@ -0,0 +1,105 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_frame_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Sisyphus::Render frame queue tests", "[Render::frame_queue]")
+{
+    SECTION("jobs run in submission order on the render thread")
+    {
+        Sisyphus::Render::FrameQueue queue(2);
+        std::vector<int>             order;
+        std::thread::id              caller = std::this_thread::get_id();
+        std::atomic<bool>            inline_job(false);
+        for (int i = 0; i < 100; i++)
+        {
+            uint64_t frame_id = queue.submit(
+                [&order, &inline_job, caller, i]()
+                {
+                    inline_job = inline_job || std::this_thread::get_id() == caller;
+                    order.push_back(i);
+                });
+            REQUIRE(frame_id == (uint64_t)i + 1);
+        }
+        queue.flush();
+        REQUIRE(queue.is_frame_completed(100));
+        REQUIRE(order.size() == 100);
+        for (int i = 0; i < 100; i++)
+        {
+            REQUIRE(order[i] == i);
+        }
+        REQUIRE_FALSE(inline_job);
+    }
+    SECTION("submit waits while the frames in flight are unfinished")
+    {
+        Sisyphus::Render::FrameQueue queue(1);
+        std::atomic<bool>            release(false);
+        std::atomic<bool>            second_submitted(false);
+        uint64_t                     first = queue.submit(
+            [&release]()
+            {
+                while (!release)
+                {
+                    std::this_thread::yield();
+                }
+            });
+        std::thread producer(
+            [&queue, &second_submitted]()
+            {
+                queue.submit([]() {});
+                second_submitted = true;
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        REQUIRE_FALSE(queue.is_frame_completed(first));
+        REQUIRE_FALSE(second_submitted);
+        release = true;
+        producer.join();
+        REQUIRE(second_submitted);
+        queue.wait_frame(first);
+        REQUIRE(queue.is_frame_completed(first));
+        queue.flush();
+        REQUIRE(queue.is_frame_completed(2));
+    }
+    SECTION("zero frames in flight run jobs inline")
+    {
+        Sisyphus::Render::FrameQueue queue(0);
+        std::thread::id              runner;
+        uint64_t                     frame_id = queue.submit(
+            [&runner]()
+            {
+                runner = std::this_thread::get_id();
+            });
+        REQUIRE(runner == std::this_thread::get_id());
+        REQUIRE(queue.is_frame_completed(frame_id));
+        // switching modes keeps the numbering
+        queue.set_max_frames_in_flight(2);
+        frame_id = queue.submit(
+            [&runner]()
+            {
+                runner = std::this_thread::get_id();
+            });
+        REQUIRE(frame_id == 2);
+        queue.wait_frame(frame_id);
+        REQUIRE(runner != std::this_thread::get_id());
+    }
+    SECTION("destruction finishes queued jobs")
+    {
+        std::atomic<int> finished(0);
+        {
+            Sisyphus::Render::FrameQueue queue(3);
+            for (int i = 0; i < 3; i++)
+            {
+                queue.submit(
+                    [&finished]()
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        finished++;
+                    });
+            }
+        }
+        REQUIRE(finished == 3);
+    }
+}
@@ -0,0 +1,185 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_query.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+static int s_shaded_vertices = 0;
+
+static void
+vertex_shader(
+    const Sisyphus::Base::vec4_t& input, Sisyphus::Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out,
+    const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins, const std::vector<uint8_t>& descriptor_set)
+{
+    Sisyphus::Tests::vertex_shader(input, output, per_vertex_out, per_vertex_data, builtins, descriptor_set);
+    s_shaded_vertices++;
+}
+
+TEST_CASE("Sisyphus::Render geometry view tests", "[Render::geometry_view]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    context.set_vertex_shader(vertex_shader);
+    Sisyphus::Render::VertexFormat v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat v_out_format = Sisyphus::Tests::get_output_format();
+    // one quad, and the same quad behind two unused vertices in a pooled buffer
+    std::vector<Sisyphus::Base::vec4_t> quad = {
+        {-2.0f, -1.0f, 5.0f, 1.0f},
+        {1.0f, -2.0f, 5.0f, 1.0f},
+        {2.0f, 2.0f, 5.0f, 1.0f},
+        {-1.0f, 1.0f, 5.0f, 1.0f},
+    };
+    std::vector<Sisyphus::Base::vec4_t> pool = {{0.0f, 0.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 1.0f, 1.0f}};
+    pool.insert(pool.end(), quad.begin(), quad.end());
+    std::vector<int>                 indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint16_t>            pool_indices = {0, 0, 0, 0, 1, 2, 0, 2, 3};
+    std::vector<uint8_t>             vertex_data(pool.size() * sizeof(float));
+    Sisyphus::Render::OcclusionQuery query;
+    uint64_t                         samples = 0;
+    uint64_t                         view_samples = 0;
+    // the same triangles should cover exactly the same pixels
+    context.clear_depth(0.0f);
+    context.begin_query(&query);
+    context.draw_triangles(quad, indices, vertex_data.data(), v_in_format, v_out_format);
+    context.end_query();
+    REQUIRE(query.get_result(samples));
+    REQUIRE(samples > 0);
+    SECTION("16 bit indices with index offset and base vertex")
+    {
+        Sisyphus::Render::GeometryView view(pool, pool_indices, vertex_data.data());
+        view.index_offset = 3;
+        view.index_count = 6;
+        view.base_vertex = 2;
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_triangles(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        REQUIRE(view_samples == samples);
+    }
+    SECTION("raw pointers without vectors")
+    {
+        Sisyphus::Render::GeometryView view;
+        view.coords = quad.data();
+        view.vertex_count = (uint32_t)quad.size();
+        view.indices = indices.data();
+        view.index_count = (uint32_t)indices.size();
+        view.vertex_data = vertex_data.data();
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_triangles(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        REQUIRE(view_samples == samples);
+    }
+    SECTION("strips and fans cover the same pixels and shade every vertex once")
+    {
+        std::vector<int> strip = {1, 2, 0, 3};
+        std::vector<int> fan = {0, 1, 2, 3};
+        for (const std::vector<int>* topology_indices : {&strip, &fan})
+        {
+            Sisyphus::Render::GeometryView view(quad, *topology_indices, vertex_data.data());
+            view.topology = topology_indices == &strip ? Sisyphus::Render::EPrimitiveType::TRIANGLE_STRIP
+                                                       : Sisyphus::Render::EPrimitiveType::TRIANGLE_FAN;
+            s_shaded_vertices = 0;
+            context.clear_depth(0.0f);
+            context.begin_query(&query);
+            context.draw_triangles(view, v_in_format, v_out_format);
+            context.end_query();
+            REQUIRE(query.get_result(view_samples));
+            REQUIRE(view_samples == samples);
+            REQUIRE(s_shaded_vertices == 4);
+        }
+    }
+    SECTION("primitive restart batches separate strips")
+    {
+        // the quad twice, the second copy behind the first one
+        std::vector<Sisyphus::Base::vec4_t> quads = quad;
+        for (const Sisyphus::Base::vec4_t& v : quad)
+        {
+            quads.push_back(Sisyphus::Base::vec4_t {v.x, v.y, v.z + 1.0f, 1.0f});
+        }
+        std::vector<uint16_t>          strips = {1, 2, 0, 3, 0xffff, 5, 6, 4, 7};
+        std::vector<uint8_t>           quads_data(quads.size() * sizeof(float));
+        Sisyphus::Render::GeometryView view(quads, strips, quads_data.data());
+        view.topology = Sisyphus::Render::EPrimitiveType::TRIANGLE_STRIP;
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_triangles(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        // the far quad is drawn after the near one, so it fails the depth test everywhere
+        REQUIRE(view_samples == samples);
+        std::swap(strips[0], strips[5]);
+        std::swap(strips[1], strips[6]);
+        std::swap(strips[2], strips[7]);
+        std::swap(strips[3], strips[8]);
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_triangles(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        REQUIRE(view_samples > samples);
+    }
+    SECTION("degenerate triangles stitching strips draw nothing")
+    {
+        // two quads apart, joined into one strip by repeating the last index of the first one
+        std::vector<Sisyphus::Base::vec4_t> quads = Sisyphus::Tests::create_quad(-2.0f, 0.0f, 5.0f, 1.0f);
+        std::vector<Sisyphus::Base::vec4_t> right = Sisyphus::Tests::create_quad(2.0f, 0.0f, 5.0f, 1.0f);
+        quads.insert(quads.end(), right.begin(), right.end());
+        std::vector<int>     stitched = {1, 2, 0, 3, 3, 5, 5, 6, 4, 7};
+        std::vector<int>     list = {1, 2, 0, 0, 2, 3, 5, 6, 4, 4, 6, 7};
+        std::vector<uint8_t> quads_data(quads.size() * sizeof(float));
+        std::vector<uint8_t> list_frame;
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_triangles(quads, list, quads_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples > 0);
+        context.present();
+        list_frame = Sisyphus::Tests::read_frame(context);
+        Sisyphus::Render::GeometryView view(quads, stitched, quads_data.data());
+        view.topology = Sisyphus::Render::EPrimitiveType::TRIANGLE_STRIP;
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_triangles(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        REQUIRE(view_samples == samples);
+        context.present();
+        REQUIRE(Sisyphus::Tests::read_frame(context) == list_frame);
+    }
+    SECTION("line strips are line lists sharing their vertices")
+    {
+        std::vector<int> lines = {0, 1, 1, 2, 2, 3};
+        std::vector<int> line_strip = {0, 1, 2, 3};
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_lines(quad, lines, vertex_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples > 0);
+        Sisyphus::Render::GeometryView view(quad, line_strip, vertex_data.data());
+        view.topology = Sisyphus::Render::EPrimitiveType::LINE_STRIP;
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_lines(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        REQUIRE(view_samples == samples);
+        // without a vertex count the indices tell how many vertices there are
+        view.vertex_count = 0;
+        s_shaded_vertices = 0;
+        context.clear_depth(0.0f);
+        context.begin_query(&query);
+        context.draw_lines(view, v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(view_samples));
+        REQUIRE(view_samples == samples);
+        REQUIRE(s_shaded_vertices == 4);
+    }
+}
@@ -0,0 +1,116 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_query.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+static std::vector<int> s_shaded_instances;
+static std::vector<int> s_shaded_draws;
+
+static void
+vertex_shader(
+    const Sisyphus::Base::vec4_t& input, Sisyphus::Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out,
+    const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins, const std::vector<uint8_t>& descriptor_set)
+{
+    Sisyphus::Tests::vertex_shader(input, output, per_vertex_out, per_vertex_data, builtins, descriptor_set);
+    s_shaded_instances.push_back(Sisyphus::Render::get_instance_index(builtins));
+    s_shaded_draws.push_back(Sisyphus::Render::get_draw_index(builtins));
+}
+
+TEST_CASE("Sisyphus::Render instanced drawing tests", "[Render::instancing]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    context.set_vertex_shader(vertex_shader);
+    std::vector<Sisyphus::Base::vec4_t> triangle = {
+        {-1.0f, -1.0f, 5.0f, 1.0f},
+        {0.0f, 1.0f, 5.0f, 1.0f},
+        {1.0f, -1.0f, 5.0f, 1.0f},
+    };
+    std::vector<int>                    indices = {0, 1, 2};
+    std::vector<uint8_t>                vertex_data(triangle.size() * sizeof(float));
+    Sisyphus::Render::VertexFormat      v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat      v_out_format = Sisyphus::Tests::get_output_format();
+    Sisyphus::Render::VertexFormat      instance_format({Sisyphus::Render::EVertexAttribType::VEC4});
+    std::vector<Sisyphus::Base::vec4_t> offsets = {
+        {-2.5f, 0.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f, 0.0f},
+        {2.5f, 0.0f, 0.0f, 0.0f},
+    };
+    Sisyphus::Render::OcclusionQuery query;
+    s_shaded_instances.clear();
+    s_shaded_draws.clear();
+    SECTION("instances are shaded with their own index and data")
+    {
+        context.begin_query(&query);
+        context.draw_triangles(triangle, indices, vertex_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        uint64_t single_samples = 0;
+        REQUIRE(query.get_result(single_samples));
+        REQUIRE(single_samples > 0);
+        REQUIRE(s_shaded_instances == std::vector<int> {0, 0, 0});
+        s_shaded_instances.clear();
+        // the middle instance is hidden by the triangle drawn above, the others do not overlap
+        context.begin_query(&query);
+        context.draw_triangles_instanced(
+            triangle, indices, vertex_data.data(), v_in_format, v_out_format, (int)offsets.size(),
+            reinterpret_cast<const uint8_t*>(offsets.data()), instance_format);
+        context.end_query();
+        uint64_t samples = 0;
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples == single_samples * 2);
+        REQUIRE(s_shaded_instances == std::vector<int> {0, 0, 0, 1, 1, 1, 2, 2, 2});
+    }
+    SECTION("regular draws after instanced ones see no instance")
+    {
+        context.draw_triangles_instanced(
+            triangle, indices, vertex_data.data(), v_in_format, v_out_format, 2,
+            reinterpret_cast<const uint8_t*>(offsets.data()), instance_format);
+        s_shaded_instances.clear();
+        context.draw_triangles(triangle, indices, vertex_data.data(), v_in_format, v_out_format);
+        REQUIRE(s_shaded_instances == std::vector<int> {0, 0, 0});
+    }
+    SECTION("indirect draws execute every record with its range, instances and constants")
+    {
+        // two copies of the triangle in one buffer, the second one is reached by base vertex
+        std::vector<Sisyphus::Base::vec4_t> coords = triangle;
+        coords.insert(coords.end(), triangle.begin(), triangle.end());
+        std::vector<int>                                   shared_indices = {0, 1, 2, 0, 1, 2};
+        std::vector<uint8_t>                               shared_data(coords.size() * sizeof(float));
+        std::vector<float>                                 constants = {0.0f, 100.0f, 0.0f};
+        std::vector<Sisyphus::Render::DrawIndirectCommand> draws = {
+            {0, 3, 1, 0, 0},
+            {3, 3, 0, 0, 0}, // dropped by culling
+            {0, 3, 2, 3, 1},
+        };
+        context.begin_query(&query);
+        context.draw_triangles_indirect(
+            coords, shared_indices, shared_data.data(), v_in_format, v_out_format, draws.data(), (int)draws.size(),
+            reinterpret_cast<const uint8_t*>(offsets.data()), instance_format,
+            reinterpret_cast<const uint8_t*>(constants.data()), sizeof(float));
+        context.end_query();
+        REQUIRE(s_shaded_draws == std::vector<int> {0, 0, 0, 2, 2, 2, 2, 2, 2});
+        REQUIRE(s_shaded_instances == std::vector<int> {0, 0, 0, 1, 1, 1, 2, 2, 2});
+        uint64_t samples = 0;
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples > 0);
+        s_shaded_draws.clear();
+        context.draw_triangles(triangle, indices, vertex_data.data(), v_in_format, v_out_format);
+        REQUIRE(s_shaded_draws == std::vector<int> {0, 0, 0});
+    }
+    SECTION("indirect records outside the indices are skipped")
+    {
+        // the offset of the second record wraps around when the count is added
+        std::vector<Sisyphus::Render::DrawIndirectCommand> draws = {
+            {0, 6, 1, 0, 0},
+            {0xfffffffe, 3, 1, 0, 0},
+            {3, 3, 1, 0, 0},
+            {0, 3, 1, 0, 0},
+        };
+        context.draw_triangles_indirect(
+            triangle, indices, vertex_data.data(), v_in_format, v_out_format, draws.data(), (int)draws.size(),
+            reinterpret_cast<const uint8_t*>(offsets.data()), instance_format, nullptr, 0);
+        REQUIRE(s_shaded_draws == std::vector<int> {3, 3, 3});
+    }
+}
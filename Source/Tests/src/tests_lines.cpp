@@ -0,0 +1,136 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+// lit pixels of the lines drawn over a black frame, as y * 64 + x
+static std::vector<int>
+draw_view(Sisyphus::Render::Context& context, const Sisyphus::Render::GeometryView& view)
+{
+    std::vector<int> lit;
+    context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+    context.clear_depth(0.0f);
+    context.draw_lines(view, Sisyphus::Tests::get_input_format(), Sisyphus::Tests::get_output_format());
+    context.present();
+    std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(context);
+    for (int i = 0; i < 64 * 64; i++)
+    {
+        if (frame[i * 4] != 0)
+        {
+            lit.push_back(i);
+        }
+    }
+    return lit;
+}
+
+static std::vector<int>
+draw_segment(Sisyphus::Render::Context& context, const Sisyphus::Base::vec4_t& a, const Sisyphus::Base::vec4_t& b)
+{
+    std::vector<Sisyphus::Base::vec4_t> coords = {a, b};
+    std::vector<int>                    indices = {0, 1};
+    std::vector<uint8_t>                vertex_data(coords.size() * sizeof(float));
+    Sisyphus::Render::GeometryView      view(coords, indices, vertex_data.data());
+    view.topology = Sisyphus::Render::EPrimitiveType::LINE;
+    return draw_view(context, view);
+}
+
+TEST_CASE("Sisyphus::Render line tests", "[Render::lines]")
+{
+    // the screen is 10 units wide at distance 5, 6.4 pixels per unit
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    SECTION("list segments cover both of their end pixels")
+    {
+        std::vector<int> lit = draw_segment(
+            context, Sisyphus::Base::vec4_t {-2.0f, 0.0f, 5.0f, 1.0f}, Sisyphus::Base::vec4_t {2.0f, 0.0f, 5.0f, 1.0f});
+        // from 19.2 to 44.8
+        REQUIRE(lit.size() == 26);
+        for (int i = 0; i < (int)lit.size(); i++)
+        {
+            REQUIRE(lit[i] / 64 == lit[0] / 64);
+            REQUIRE(lit[i] % 64 == 19 + i);
+        }
+        // reversed, the same pixels
+        REQUIRE(
+            draw_segment(
+                context, Sisyphus::Base::vec4_t {2.0f, 0.0f, 5.0f, 1.0f},
+                Sisyphus::Base::vec4_t {-2.0f, 0.0f, 5.0f, 1.0f}) == lit);
+    }
+    SECTION("strip segments leave the shared pixel to the next one, the last keeps its end")
+    {
+        // along the row to the middle of the screen, then down the column
+        std::vector<Sisyphus::Base::vec4_t> coords = {
+            {-2.0f, 0.0f, 5.0f, 1.0f}, {0.0f, 0.0f, 5.0f, 1.0f}, {0.0f, -2.0f, 5.0f, 1.0f}};
+        std::vector<int>               indices = {0, 1, 2};
+        std::vector<uint8_t>           vertex_data(coords.size() * sizeof(float));
+        Sisyphus::Render::GeometryView view(coords, indices, vertex_data.data());
+        view.topology = Sisyphus::Render::EPrimitiveType::LINE_STRIP;
+        std::vector<int> lit = draw_view(context, view);
+        // 19 to 32 in the row, 33 to 44.8 in the column
+        REQUIRE(lit.size() == 26);
+        REQUIRE(lit.front() == 32 * 64 + 19);
+        REQUIRE(lit.back() == 44 * 64 + 32);
+        // a list of the same segments covers the same pixels
+        std::vector<int> list_indices = {0, 1, 1, 2};
+        view.indices = list_indices.data();
+        view.index_count = (uint32_t)list_indices.size();
+        view.topology = Sisyphus::Render::EPrimitiveType::LINE;
+        REQUIRE(draw_view(context, view) == lit);
+    }
+    SECTION("segments through the near plane are clipped to the frustum")
+    {
+        // starts behind the camera, enters the frustum through its top plane at z = 1
+        std::vector<int> lit = draw_segment(
+            context, Sisyphus::Base::vec4_t {0.0f, 1.0f, -5.0f, 1.0f}, Sisyphus::Base::vec4_t {0.0f, 1.0f, 5.0f, 1.0f});
+        // from the edge of the screen to the end in front of the camera at 25.6, one pixel per row
+        REQUIRE(lit.size() == 26);
+        for (int i = 0; i < (int)lit.size(); i++)
+        {
+            REQUIRE(lit[i] == i * 64 + 32);
+        }
+    }
+    SECTION("line batches with bounds outside the frustum are culled")
+    {
+        std::vector<Sisyphus::Base::vec4_t> coords = {{-2.0f, 0.0f, 5.0f, 1.0f}, {2.0f, 0.0f, 5.0f, 1.0f}};
+        std::vector<int>                    indices = {0, 1};
+        std::vector<uint8_t>                vertex_data(coords.size() * sizeof(float));
+        // bounds behind the camera, the segment itself is in view
+        std::vector<Sisyphus::Base::vec3_t> points = {{-2.0f, -1.0f, -6.0f}, {2.0f, 1.0f, -4.0f}};
+        Sisyphus::Base::Bounds              hidden = Sisyphus::Base::calculate_bounds(points);
+        Sisyphus::Render::LineBatch         batches[2] = {
+            {&coords, &indices, vertex_data.data(), &hidden},
+            {&coords, &indices, vertex_data.data()},
+        };
+        for (int count = 1; count <= 2; count++)
+        {
+            context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+            context.clear_depth(0.0f);
+            context.draw_line_batches(
+                batches, count, Sisyphus::Tests::get_input_format(), Sisyphus::Tests::get_output_format());
+            context.present();
+            std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(context);
+            REQUIRE((frame[(32 * 64 + 32) * 4] != 0) == (count == 2));
+        }
+    }
+    SECTION("segments outside the frustum draw nothing")
+    {
+        // behind the camera, in front of the near plane, left of the frustum and beyond the far plane
+        REQUIRE(draw_segment(
+                    context, Sisyphus::Base::vec4_t {-1.0f, 0.0f, -5.0f, 1.0f},
+                    Sisyphus::Base::vec4_t {1.0f, 0.0f, -2.0f, 1.0f})
+                    .empty());
+        REQUIRE(draw_segment(
+                    context, Sisyphus::Base::vec4_t {0.0f, 0.0f, 0.1f, 1.0f},
+                    Sisyphus::Base::vec4_t {0.0f, 0.1f, 0.4f, 1.0f})
+                    .empty());
+        REQUIRE(draw_segment(
+                    context, Sisyphus::Base::vec4_t {-10.0f, -1.0f, 5.0f, 1.0f},
+                    Sisyphus::Base::vec4_t {-8.0f, 1.0f, 5.0f, 1.0f})
+                    .empty());
+        REQUIRE(draw_segment(
+                    context, Sisyphus::Base::vec4_t {0.0f, 0.0f, 150.0f, 1.0f},
+                    Sisyphus::Base::vec4_t {1.0f, 1.0f, 200.0f, 1.0f})
+                    .empty());
+    }
+}
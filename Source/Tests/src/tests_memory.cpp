@@ -0,0 +1,114 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "base_memory.h"
+#include "render_frame_storage.h"
+
+TEST_CASE("Sisyphus::Base aligned memory tests", "[Base::memory]")
+{
+    SECTION("align_up rounds to the next multiple")
+    {
+        REQUIRE(Sisyphus::Base::align_up(0, 64) == 0);
+        REQUIRE(Sisyphus::Base::align_up(1, 64) == 64);
+        REQUIRE(Sisyphus::Base::align_up(64, 64) == 64);
+        REQUIRE(Sisyphus::Base::align_up(65, 64) == 128);
+    }
+    SECTION("allocated block is cache line aligned")
+    {
+        Sisyphus::Base::AlignedBlock block = Sisyphus::Base::allocate_aligned_block(1000, false);
+        REQUIRE(block.data != nullptr);
+        REQUIRE(block.capacity >= 1000);
+        REQUIRE(reinterpret_cast<uintptr_t>(block.data) % Sisyphus::Base::cache_line_size == 0);
+        Sisyphus::Base::free_aligned_block(block);
+        REQUIRE(block.data == nullptr);
+    }
+    SECTION("huge pages request falls back gracefully")
+    {
+        Sisyphus::Base::AlignedBlock block = Sisyphus::Base::allocate_aligned_block(1000, true);
+        REQUIRE(block.data != nullptr);
+        REQUIRE(reinterpret_cast<uintptr_t>(block.data) % Sisyphus::Base::cache_line_size == 0);
+        Sisyphus::Base::free_aligned_block(block);
+    }
+    SECTION("pool hands out released blocks again")
+    {
+        Sisyphus::Base::AlignedBlockPool pool(2);
+        Sisyphus::Base::AlignedBlock     block = pool.acquire(4096, false);
+        uint8_t*                         ptr = block.data;
+        pool.release(block);
+        REQUIRE(block.data == nullptr);
+        REQUIRE(pool.get_free_block_count() == 1);
+        Sisyphus::Base::AlignedBlock same = pool.acquire(3000, false);
+        REQUIRE(same.data == ptr);
+        // too big for such a small request
+        pool.release(same);
+        Sisyphus::Base::AlignedBlock small = pool.acquire(100, false);
+        REQUIRE(small.data != ptr);
+        REQUIRE(pool.get_free_block_count() == 1);
+        pool.release(small);
+        REQUIRE(pool.get_free_block_count() == 2);
+        Sisyphus::Base::AlignedBlock extra = pool.acquire(100000, false);
+        pool.release(extra);
+        REQUIRE(pool.get_free_block_count() == 2); // the oldest one is evicted
+    }
+    SECTION("pool reuses huge page blocks even if huge pages were not granted")
+    {
+        Sisyphus::Base::AlignedBlockPool pool(2);
+        Sisyphus::Base::AlignedBlock     block = pool.acquire(Sisyphus::Base::huge_page_size, true);
+        uint8_t*                         ptr = block.data;
+        REQUIRE(block.huge_pages_requested);
+        pool.release(block);
+        Sisyphus::Base::AlignedBlock same = pool.acquire(Sisyphus::Base::huge_page_size, true);
+        REQUIRE(same.data == ptr);
+        // regular requests keep away from them
+        pool.release(same);
+        Sisyphus::Base::AlignedBlock regular = pool.acquire(Sisyphus::Base::huge_page_size, false);
+        REQUIRE(regular.data != ptr);
+        REQUIRE(!regular.huge_pages_requested);
+        pool.release(regular);
+    }
+}
+
+TEST_CASE("Sisyphus::Render frame storage tests", "[Render::frame_storage]")
+{
+    const size_t                   big_size = 1024 * 1024;
+    const size_t                   small_size = 1024;
+    Sisyphus::Render::FrameStorage storage;
+    storage.reserve(big_size, big_size);
+    uint8_t* color = storage.get_color();
+    size_t   capacity = storage.get_color_capacity();
+    REQUIRE(color != nullptr);
+    REQUIRE(capacity >= big_size);
+    SECTION("growing within the headroom keeps the memory")
+    {
+        storage.reserve(big_size + big_size / 8, big_size);
+        REQUIRE(storage.get_color() == color);
+        REQUIRE(storage.get_color_capacity() == capacity);
+        storage.reserve(capacity + 1, big_size);
+        REQUIRE(storage.get_color_capacity() > capacity + capacity / 4);
+    }
+    SECTION("storage shrinks only after shrink_delay small frames in a row")
+    {
+        for (int i = 0; i < Sisyphus::Render::FrameStorage::shrink_delay - 1; i++)
+        {
+            storage.reserve(small_size, small_size);
+            REQUIRE(storage.get_color() == color);
+            REQUIRE(storage.get_color_capacity() == capacity);
+        }
+        storage.reserve(small_size, small_size);
+        REQUIRE(storage.get_color_capacity() < capacity);
+        REQUIRE(storage.get_color_capacity() >= small_size);
+        REQUIRE(storage.get_depth_capacity() < capacity);
+    }
+    SECTION("a big frame in between restarts the delay")
+    {
+        for (int i = 0; i < Sisyphus::Render::FrameStorage::shrink_delay - 1; i++)
+        {
+            storage.reserve(small_size, small_size);
+        }
+        storage.reserve(big_size, big_size);
+        for (int i = 0; i < Sisyphus::Render::FrameStorage::shrink_delay - 1; i++)
+        {
+            storage.reserve(small_size, small_size);
+        }
+        REQUIRE(storage.get_color() == color);
+        REQUIRE(storage.get_color_capacity() == capacity);
+    }
+}
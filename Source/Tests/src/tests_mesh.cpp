@@ -0,0 +1,160 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_mesh.h"
+
+#include <algorithm>
+#include <vector>
+
+TEST_CASE("Sisyphus::Render mesh tests", "[Render::mesh]")
+{
+    // 4x4 grid of quads, two triangles per quad, listed row by row
+    const int                           size = 4;
+    std::vector<Sisyphus::Base::vec4_t> coords;
+    std::vector<int>                    indices;
+    for (int y = 0; y <= size; y++)
+    {
+        for (int x = 0; x <= size; x++)
+        {
+            coords.push_back(Sisyphus::Base::vec4_t {(float)x, (float)y, 0.0f, 1.0f});
+        }
+    }
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            int v = y * (size + 1) + x;
+            indices.insert(indices.end(), {v, v + 1, v + size + 2, v, v + size + 2, v + size + 1});
+        }
+    }
+    Sisyphus::Render::VertexFormat format({Sisyphus::Render::EVertexAttribType::FLOAT32});
+    std::vector<uint8_t>           data(coords.size() * format.size);
+    SECTION("invalid layouts and indices are rejected")
+    {
+        REQUIRE(Sisyphus::Render::create_mesh(
+                    coords.data(), (uint32_t)coords.size(), data.data(), data.size() - 1, format, indices.data(),
+                    (uint32_t)indices.size()) == nullptr);
+        REQUIRE(Sisyphus::Render::create_mesh(
+                    coords.data(), (uint32_t)coords.size(), data.data(), data.size(), format, indices.data(),
+                    (uint32_t)indices.size() - 1) == nullptr);
+        indices.back() = (int)coords.size();
+        REQUIRE(Sisyphus::Render::create_mesh(
+                    coords.data(), (uint32_t)coords.size(), data.data(), data.size(), format, indices.data(),
+                    (uint32_t)indices.size()) == nullptr);
+    }
+    SECTION("derived data is calculated on creation")
+    {
+        std::shared_ptr<Sisyphus::Render::Mesh> mesh = Sisyphus::Render::create_mesh(
+            coords.data(), (uint32_t)coords.size(), data.data(), data.size(), format, indices.data(),
+            (uint32_t)indices.size(), 8);
+        REQUIRE(mesh != nullptr);
+        const Sisyphus::Render::IndexBuffer& index_buffer = mesh->get_index_buffer();
+        REQUIRE(index_buffer.get_type() == Sisyphus::Render::EIndexType::UINT16);
+        REQUIRE(index_buffer.get_count() == indices.size());
+        REQUIRE(mesh->get_bounds().box.max.x == (float)size);
+        int meshlet_triangles = 0;
+        for (const Sisyphus::Render::Meshlet& meshlet : mesh->get_meshlets().meshlets)
+        {
+            REQUIRE(meshlet.triangle_count <= 8);
+            meshlet_triangles += meshlet.triangle_count;
+        }
+        REQUIRE(meshlet_triangles == size * size * 2);
+        // the same triangles with the same winding, only the order differs
+        Sisyphus::Render::GeometryView geometry = mesh->get_geometry_view();
+        std::vector<std::vector<int>>  triangles;
+        std::vector<std::vector<int>>  ordered;
+        for (uint32_t i = 0; i < indices.size(); i += 3)
+        {
+            int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            int first = std::min(a, std::min(b, c));
+            triangles.push_back(first == a ? std::vector<int> {a, b, c}
+                                           : (first == b ? std::vector<int> {b, c, a} : std::vector<int> {c, a, b}));
+            a = Sisyphus::Render::get_geometry_index(geometry, i);
+            b = Sisyphus::Render::get_geometry_index(geometry, i + 1);
+            c = Sisyphus::Render::get_geometry_index(geometry, i + 2);
+            first = std::min(a, std::min(b, c));
+            ordered.push_back(first == a ? std::vector<int> {a, b, c}
+                                         : (first == b ? std::vector<int> {b, c, a} : std::vector<int> {c, a, b}));
+        }
+        std::sort(triangles.begin(), triangles.end());
+        std::sort(ordered.begin(), ordered.end());
+        REQUIRE(triangles == ordered);
+        // consecutive triangles mostly share an edge, so the three cached vertices cover two of the next ones
+        int shared = 0;
+        int shared_before = 0;
+        for (uint32_t i = 3; i < indices.size(); i += 3)
+        {
+            for (uint32_t j = i; j < i + 3; j++)
+            {
+                for (uint32_t k = i - 3; k < i; k++)
+                {
+                    shared += Sisyphus::Render::get_geometry_index(geometry, k) ==
+                              Sisyphus::Render::get_geometry_index(geometry, j);
+                    shared_before += indices[k] == indices[j];
+                }
+            }
+        }
+        REQUIRE(shared > shared_before);
+        REQUIRE(shared * 10 >= 2 * (int)(indices.size() / 3 - 1) * 9);
+    }
+    SECTION("adjacency links triangles across shared edges")
+    {
+        std::vector<int> adjacency =
+            Sisyphus::Render::calculate_triangle_adjacency(indices.data(), (uint32_t)indices.size());
+        REQUIRE(adjacency.size() == indices.size());
+        // the boundary of the grid is open, every inner edge is shared both ways
+        REQUIRE(std::count(adjacency.begin(), adjacency.end(), -1) == 4 * size);
+        for (uint32_t corner = 0; corner < adjacency.size(); corner++)
+        {
+            int other = adjacency[corner];
+            if (other >= 0)
+            {
+                int triangle = (int)corner / 3;
+                REQUIRE(std::count(adjacency.begin() + other * 3, adjacency.begin() + other * 3 + 3, triangle) == 1);
+            }
+        }
+        REQUIRE(adjacency[0] == -1);
+        REQUIRE(adjacency[1] == 3);
+        REQUIRE(adjacency[2] == 1);
+    }
+    SECTION("updates grow the version and recalculate bounds")
+    {
+        std::shared_ptr<Sisyphus::Render::Mesh> mesh = Sisyphus::Render::create_mesh(
+            coords.data(), (uint32_t)coords.size(), data.data(), data.size(), format, indices.data(),
+            (uint32_t)indices.size());
+        uint64_t version = mesh->get_version();
+        uint64_t id = mesh->get_vertex_buffer().get_id();
+        for (Sisyphus::Base::vec4_t& v : coords)
+        {
+            v.x *= 2.0f;
+        }
+        REQUIRE_FALSE(mesh->update_vertices(coords.data(), data.data(), data.size() + 1));
+        REQUIRE(mesh->get_version() == version);
+        REQUIRE(mesh->update_vertices(coords.data(), data.data(), data.size()));
+        REQUIRE(mesh->get_version() > version);
+        REQUIRE(mesh->get_vertex_buffer().get_id() == id);
+        REQUIRE(mesh->get_bounds().box.max.x == 2.0f * size);
+    }
+    SECTION("updates keep the meshlet size of creation")
+    {
+        std::shared_ptr<Sisyphus::Render::Mesh> mesh = Sisyphus::Render::create_mesh(
+            coords.data(), (uint32_t)coords.size(), data.data(), data.size(), format, indices.data(),
+            (uint32_t)indices.size(), 4);
+        size_t meshlet_count = mesh->get_meshlets().meshlets.size();
+        REQUIRE(meshlet_count >= (size_t)(size * size * 2 / 4));
+        for (int update = 0; update < 2; update++)
+        {
+            for (Sisyphus::Base::vec4_t& v : coords)
+            {
+                v.z += 1.0f;
+            }
+            REQUIRE(mesh->update_vertices(coords.data(), data.data(), data.size()));
+            REQUIRE(mesh->get_meshlets().meshlets.size() == meshlet_count);
+            int meshlet_triangles = 0;
+            for (const Sisyphus::Render::Meshlet& meshlet : mesh->get_meshlets().meshlets)
+            {
+                REQUIRE(meshlet.triangle_count <= 4);
+                meshlet_triangles += meshlet.triangle_count;
+            }
+            REQUIRE(meshlet_triangles == size * size * 2);
+        }
+    }
+}
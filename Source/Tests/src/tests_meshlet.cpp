@@ -0,0 +1,124 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_meshlet.h"
+#include "render_query.h"
+#include "tests_render_common.h"
+
+#include <algorithm>
+#include <vector>
+
+static int s_shaded_vertices = 0;
+
+static void
+vertex_shader(
+    const Sisyphus::Base::vec4_t& input, Sisyphus::Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out,
+    const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins, const std::vector<uint8_t>& descriptor_set)
+{
+    Sisyphus::Tests::vertex_shader(input, output, per_vertex_out, per_vertex_data, builtins, descriptor_set);
+    s_shaded_vertices++;
+}
+
+// triangle as its indices starting from the smallest one, the winding is kept
+static std::vector<int>
+get_triangle(const std::vector<int>& indices, size_t offset)
+{
+    int a = indices[offset], b = indices[offset + 1], c = indices[offset + 2];
+    int first = std::min(a, std::min(b, c));
+    return first == a ? std::vector<int> {a, b, c}
+                      : (first == b ? std::vector<int> {b, c, a} : std::vector<int> {c, a, b});
+}
+
+TEST_CASE("Sisyphus::Render meshlet tests", "[Render::meshlet]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    context.set_vertex_shader(vertex_shader);
+    Sisyphus::Render::VertexFormat v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat v_out_format = Sisyphus::Tests::get_output_format();
+    // 8x8 grid of quads from -4 to 4 at distance 5, the normals of the triangles look away from the camera
+    const int                           size = 8;
+    std::vector<Sisyphus::Base::vec4_t> coords;
+    std::vector<int>                    indices;
+    for (int y = 0; y <= size; y++)
+    {
+        for (int x = 0; x <= size; x++)
+        {
+            coords.push_back(Sisyphus::Base::vec4_t {(float)x - 4.0f, (float)y - 4.0f, 5.0f, 1.0f});
+        }
+    }
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            int v = y * (size + 1) + x;
+            indices.insert(indices.end(), {v, v + 1, v + size + 2, v, v + size + 2, v + size + 1});
+        }
+    }
+    std::vector<uint8_t>             vertex_data(coords.size() * sizeof(float));
+    Sisyphus::Render::OcclusionQuery query;
+    uint64_t                         samples = 0;
+    SECTION("meshlets cover every triangle once and keep the limit")
+    {
+        Sisyphus::Render::MeshletMesh mesh = Sisyphus::Render::build_meshlets(coords, indices, 5);
+        REQUIRE(mesh.indices.size() == indices.size());
+        REQUIRE(mesh.meshlets.size() >= (size_t)(size * size * 2 / 5));
+        int next_offset = 0;
+        for (const Sisyphus::Render::Meshlet& meshlet : mesh.meshlets)
+        {
+            REQUIRE(meshlet.index_offset == next_offset);
+            REQUIRE(meshlet.triangle_count > 0);
+            REQUIRE(meshlet.triangle_count <= 5);
+            next_offset += meshlet.triangle_count * 3;
+        }
+        REQUIRE(next_offset == (int)indices.size());
+        std::vector<std::vector<int>> triangles;
+        std::vector<std::vector<int>> clustered;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            triangles.push_back(get_triangle(indices, i));
+            clustered.push_back(get_triangle(mesh.indices, i));
+        }
+        std::sort(triangles.begin(), triangles.end());
+        std::sort(clustered.begin(), clustered.end());
+        REQUIRE(triangles == clustered);
+    }
+    SECTION("clusters facing away are culled before shading")
+    {
+        Sisyphus::Render::MeshletMesh mesh = Sisyphus::Render::build_meshlets(coords, indices, 16);
+        for (const Sisyphus::Render::Meshlet& meshlet : mesh.meshlets)
+        {
+            REQUIRE(meshlet.cone_cutoff > 0.0f);
+            REQUIRE(meshlet.cone_axis.z > 0.0f);
+        }
+        context.set_backface_culling(Sisyphus::Render::ECullingMode::CounterClockWise);
+        s_shaded_vertices = 0;
+        context.begin_query(&query);
+        context.draw_meshlets(coords, mesh, vertex_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples == 0);
+        REQUIRE(s_shaded_vertices == 0);
+        // the other winding faces the camera, every cluster is drawn
+        context.set_backface_culling(Sisyphus::Render::ECullingMode::ClockWise);
+        context.begin_query(&query);
+        context.draw_meshlets(coords, mesh, vertex_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples > 0);
+        REQUIRE(s_shaded_vertices > 0);
+    }
+    SECTION("meshlets draw the same pixels as the whole list")
+    {
+        Sisyphus::Render::MeshletMesh mesh = Sisyphus::Render::build_meshlets(coords, indices, 16);
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        context.draw_triangles(coords, indices, vertex_data.data(), v_in_format, v_out_format);
+        context.present();
+        std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(context);
+        REQUIRE(std::count(frame.begin(), frame.end(), 255) > 64 * 64);
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        context.clear_depth(0.0f);
+        context.draw_meshlets(coords, mesh, vertex_data.data(), v_in_format, v_out_format);
+        context.present();
+        REQUIRE(Sisyphus::Tests::read_frame(context) == frame);
+    }
+}
@@ -0,0 +1,79 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "base_mpsc_queue.h"
+
+#include <thread>
+#include <vector>
+
+TEST_CASE("Sisyphus::Base bounded MPSC queue tests", "[Base::mpsc_queue]")
+{
+    SECTION("single thread keeps order and reports full and empty")
+    {
+        Sisyphus::Base::BoundedMpscQueue<int> queue(4);
+        int                                   value = 0;
+        REQUIRE(queue.get_capacity() == 4);
+        REQUIRE_FALSE(queue.try_pop(value));
+        for (int i = 0; i < 4; i++)
+        {
+            REQUIRE(queue.try_push(i));
+        }
+        REQUIRE_FALSE(queue.try_push(4));
+        REQUIRE(queue.get_size() == 4);
+        REQUIRE(queue.get_enqueue_position() == 4);
+        for (int i = 0; i < 4; i++)
+        {
+            REQUIRE(queue.is_ready());
+            REQUIRE(queue.try_pop(value));
+            REQUIRE(value == i);
+        }
+        REQUIRE_FALSE(queue.is_ready());
+        // wraps around
+        REQUIRE(queue.try_push(10));
+        REQUIRE(queue.get_enqueue_position() == 5);
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(value == 10);
+    }
+    SECTION("several producers, every value arrives once and in producer order")
+    {
+        const int                             producer_count = 4;
+        const int                             per_producer = 20000;
+        Sisyphus::Base::BoundedMpscQueue<int> queue(64);
+        std::vector<std::thread>              producers;
+        for (int p = 0; p < producer_count; p++)
+        {
+            producers.emplace_back(
+                [&queue, p, per_producer]()
+                {
+                    for (int i = 0; i < per_producer; i++)
+                    {
+                        while (!queue.try_push(p * per_producer + i))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+        }
+        std::vector<int> last(producer_count, -1);
+        int              received = 0;
+        bool             ordered = true;
+        while (received < producer_count * per_producer)
+        {
+            int value;
+            if (!queue.try_pop(value))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            int producer = value / per_producer;
+            ordered = ordered && value % per_producer == last[producer] + 1;
+            last[producer] = value % per_producer;
+            received++;
+        }
+        for (int p = 0; p < producer_count; p++)
+        {
+            producers[p].join();
+            REQUIRE(last[p] == per_producer - 1);
+        }
+        REQUIRE(ordered);
+        REQUIRE(queue.get_size() == 0);
+    }
+}
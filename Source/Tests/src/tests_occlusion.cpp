@@ -0,0 +1,74 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_occlusion.h"
+#include "tests_render_common.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+static float
+get_random(float min, float max)
+{
+    return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+TEST_CASE("Sisyphus::Render occlusion buffer tests", "[Render::occlusion]")
+{
+    Sisyphus::Base::mat4_t transform =
+        Sisyphus::Base::mat4_t::calculate_projection_matrix(Sisyphus::Base::pi * 0.5f, 1.0f, 0.5f, 100.0f);
+    std::vector<Sisyphus::Base::vec4_t> wall = Sisyphus::Tests::create_wall();
+    std::vector<int>                    wall_indices = Sisyphus::Tests::get_quad_indices();
+    Sisyphus::Render::OcclusionBuffer   occlusion(125, 130);
+    REQUIRE(occlusion.get_width() == 128);
+    REQUIRE(occlusion.get_height() == 132);
+    SECTION("empty buffer hides nothing")
+    {
+        REQUIRE(occlusion.is_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 10.0f, 0.5f), transform));
+    }
+    SECTION("boxes behind the wall are hidden, boxes around or in front are not")
+    {
+        occlusion.render_occluder(wall, wall_indices, transform);
+        REQUIRE_FALSE(occlusion.is_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 10.0f, 0.5f), transform));
+        REQUIRE_FALSE(occlusion.is_visible(Sisyphus::Tests::create_box(4.0f, -4.0f, 10.0f, 0.5f), transform));
+        REQUIRE(occlusion.is_visible(Sisyphus::Tests::create_box(8.0f, 0.0f, 10.0f, 0.5f), transform));
+        REQUIRE(occlusion.is_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 2.0f, 0.5f), transform));
+        // crosses the wall
+        REQUIRE(occlusion.is_visible(Sisyphus::Tests::create_box(0.0f, 0.0f, 5.0f, 0.5f), transform));
+        Sisyphus::Base::BoundingSphere sphere {{0.0f, 0.0f, 20.0f}, 1.0f};
+        REQUIRE_FALSE(occlusion.is_visible(sphere, transform));
+        occlusion.clear();
+        REQUIRE(occlusion.is_visible(sphere, transform));
+    }
+    SECTION("occluders do not hide their own bounds")
+    {
+        // the box of a wall touches it, so the wall is never in front of its box; flat walls
+        // are where the depth plane rounds nearer than the vertices
+        srand(37);
+        int hidden = 0;
+        for (int trial = 0; trial < 1000; trial++)
+        {
+            float                  tilt = trial % 2 == 0 ? 0.0f : 2.0f;
+            Sisyphus::Base::vec3_t center {get_random(-4.0f, 4.0f), get_random(-4.0f, 4.0f), get_random(4.0f, 30.0f)};
+            Sisyphus::Base::vec3_t right {get_random(0.5f, 3.0f), 0.0f, get_random(-tilt, tilt)};
+            Sisyphus::Base::vec3_t up {0.0f, get_random(0.5f, 3.0f), get_random(-tilt, tilt)};
+            //
+            std::vector<Sisyphus::Base::vec4_t> random_wall;
+            Sisyphus::Base::BoundingBox         box {center, center};
+            for (int corner = 0; corner < 4; corner++)
+            {
+                float                  su = (corner == 1 || corner == 2) ? 1.0f : -1.0f;
+                float                  sv = corner >= 2 ? 1.0f : -1.0f;
+                Sisyphus::Base::vec3_t p = center + right * su + up * sv;
+                random_wall.push_back(Sisyphus::Base::vec4_t {p.x, p.y, p.z, 1.0f});
+                box.min = Sisyphus::Base::vec3_t {
+                    std::min(box.min.x, p.x), std::min(box.min.y, p.y), std::min(box.min.z, p.z)};
+                box.max = Sisyphus::Base::vec3_t {
+                    std::max(box.max.x, p.x), std::max(box.max.y, p.y), std::max(box.max.z, p.z)};
+            }
+            occlusion.clear();
+            occlusion.render_occluder(random_wall, wall_indices, transform);
+            hidden += !occlusion.is_visible(box, transform);
+        }
+        REQUIRE(hidden == 0);
+    }
+}
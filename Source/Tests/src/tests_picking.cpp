@@ -0,0 +1,127 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_command_buffer.h"
+#include "render_context.h"
+#include "render_meshlet.h"
+#include "tests_render_common.h"
+
+#include <set>
+#include <vector>
+
+TEST_CASE("Sisyphus::Render picking tests", "[Render::picking]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    Sisyphus::Render::VertexFormat      v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat      v_out_format = Sisyphus::Tests::get_output_format();
+    std::vector<int>                    indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>                vertex_data(4 * sizeof(float));
+    // pixels 16 to 48 and 24 to 40
+    std::vector<Sisyphus::Base::vec4_t> far_quad = Sisyphus::Tests::create_quad(0.0f, 0.0f, 6.0f, 3.0f);
+    std::vector<Sisyphus::Base::vec4_t> near_quad = Sisyphus::Tests::create_quad(0.0f, 0.0f, 4.0f, 1.0f);
+    Sisyphus::Render::PickResult        result;
+    SECTION("disabled ids pick nothing")
+    {
+        context.set_object_id(1);
+        context.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        REQUIRE(!context.pick(32, 32, result));
+    }
+    SECTION("top-most object and primitive of a pixel or a rect")
+    {
+        context.set_id_buffer(true, true);
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        // near quad first, so the far one fails the depth test over it
+        context.set_object_id(2);
+        context.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        context.set_object_id(1);
+        context.draw_triangles(far_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        REQUIRE(context.pick(32, 32, result));
+        REQUIRE(result.object_id == 2);
+        REQUIRE(context.pick(18, 32, result));
+        REQUIRE(result.object_id == 1);
+        REQUIRE(!context.pick(2, 2, result));
+        REQUIRE(!context.pick(-1, 70, result));
+        REQUIRE(context.pick(Sisyphus::Render::ScreenRect {0, 0, 64, 64}, result));
+        REQUIRE(result.object_id == 2);
+        std::set<uint32_t> primitives;
+        for (int y = 26; y < 38; y++)
+        {
+            for (int x = 26; x < 38; x++)
+            {
+                REQUIRE(context.pick(x, y, result));
+                primitives.insert(result.primitive_id);
+            }
+        }
+        REQUIRE(primitives == std::set<uint32_t> {0, 1});
+        // fill is the background again
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        REQUIRE(!context.pick(32, 32, result));
+        context.set_id_buffer(false);
+        REQUIRE(!context.pick(32, 32, result));
+    }
+    SECTION("instances and recorded draws")
+    {
+        context.set_id_buffer(true);
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        std::vector<Sisyphus::Base::vec4_t> small_quad = Sisyphus::Tests::create_quad(0.0f, 0.0f, 5.0f, 0.5f);
+        std::vector<Sisyphus::Base::vec4_t> offsets = {
+            {-2.5f, 0.0f, 0.0f, 0.0f},
+            {0.0f, 0.0f, 0.0f, 0.0f},
+            {2.5f, 0.0f, 0.0f, 0.0f},
+        };
+        Sisyphus::Render::VertexFormat instance_format({Sisyphus::Render::EVertexAttribType::VEC4});
+        context.set_object_id(10);
+        context.draw_triangles_instanced(
+            small_quad, indices, vertex_data.data(), v_in_format, v_out_format, (int)offsets.size(),
+            reinterpret_cast<const uint8_t*>(offsets.data()), instance_format);
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            REQUIRE(context.pick(16 + (int)i * 16, 32, result));
+            REQUIRE(result.object_id == 10 + i);
+        }
+        Sisyphus::Render::CommandBuffer buffer;
+        buffer.clear_depth(0.0f);
+        buffer.set_object_id(7);
+        buffer.draw_triangles(near_quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        context.submit(buffer);
+        REQUIRE(context.pick(32, 32, result));
+        REQUIRE(result.object_id == 7);
+        REQUIRE(context.pick(16, 32, result));
+        REQUIRE(result.object_id == 10);
+    }
+    SECTION("meshlet ranges keep the primitive numbers of the whole mesh")
+    {
+        // left and right quads with one out of view in between, so they are drawn as two ranges
+        std::vector<Sisyphus::Base::vec4_t> coords;
+        std::vector<int>                    mesh_indices;
+        for (float x : {-2.0f, 0.0f, 2.0f})
+        {
+            std::vector<Sisyphus::Base::vec4_t> quad =
+                Sisyphus::Tests::create_quad(x, x == 0.0f ? 50.0f : 0.0f, 5.0f, 0.75f);
+            for (int index : indices)
+            {
+                mesh_indices.push_back(index + (int)coords.size());
+            }
+            coords.insert(coords.end(), quad.begin(), quad.end());
+        }
+        Sisyphus::Render::MeshletMesh mesh = Sisyphus::Render::build_meshlets(coords, mesh_indices, 2);
+        REQUIRE(mesh.meshlets.size() == 3);
+        std::vector<uint8_t> mesh_data(coords.size() * sizeof(float));
+        context.set_id_buffer(true, true);
+        context.set_object_id(1);
+        context.draw_meshlets(coords, mesh, mesh_data.data(), v_in_format, v_out_format);
+        std::set<uint32_t> primitives;
+        // diagonals over the quads, so both triangles of each are hit
+        for (int x : {19, 45})
+        {
+            for (int y = 28; y < 36; y++)
+            {
+                REQUIRE(context.pick(x + y - 32, y, result));
+                // the picked triangle is one of the quad under the pixel
+                const Sisyphus::Base::vec4_t& corner = coords[mesh.indices[result.primitive_id * 3]];
+                REQUIRE((corner.x < 0.0f) == (x < 32));
+                primitives.insert(result.primitive_id);
+            }
+        }
+        REQUIRE(primitives.size() == 4);
+    }
+}
@@ -0,0 +1,79 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_pipeline_state.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+// half transparent, so blending changes the result
+static Sisyphus::Base::vec4_t
+pixel_shader(const Sisyphus::Base::vec4_t&, const uint8_t*, const std::vector<uint8_t>&, const std::vector<uint8_t>&)
+{
+    return Sisyphus::Base::vec4_t {0.0f, 1.0f, 0.5f, 0.5f};
+}
+
+TEST_CASE("Sisyphus::Render pipeline state tests", "[Render::pipeline_state]")
+{
+    Sisyphus::Render::Context by_calls(64, 64, 4);
+    Sisyphus::Render::Context by_state(64, 64, 4);
+    Sisyphus::Tests::setup_context(by_calls, 64, 64);
+    Sisyphus::Tests::setup_context(by_state, 64, 64);
+    by_calls.set_pixel_shader(pixel_shader);
+    by_calls.set_wireframe_style(Sisyphus::Base::vec4_t {1.0f, 0.0f, 0.0f, 1.0f}, 1.5f);
+    by_state.set_wireframe_style(Sisyphus::Base::vec4_t {1.0f, 0.0f, 0.0f, 1.0f}, 1.5f);
+    Sisyphus::Render::VertexFormat v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat v_out_format = Sisyphus::Tests::get_output_format();
+    std::vector<uint8_t>           vertex_data(4 * sizeof(float));
+    // the near quad is wound the other way, so culling drops either it or the far one
+    std::vector<Sisyphus::Base::vec4_t>  far_quad = Sisyphus::Tests::create_quad(0.0f, 0.0f, 6.0f, 3.0f);
+    std::vector<Sisyphus::Base::vec4_t>  near_quad = Sisyphus::Tests::create_quad(-1.0f, 0.0f, 4.0f, 1.0f);
+    std::vector<int>                     far_indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<int>                     near_indices = {0, 2, 1, 0, 3, 2};
+    const Sisyphus::Render::ECullingMode culling_modes[] = {
+        Sisyphus::Render::ECullingMode::None,
+        Sisyphus::Render::ECullingMode::ClockWise,
+        Sisyphus::Render::ECullingMode::CounterClockWise,
+    };
+    const Sisyphus::Render::EBlendMode   blend_modes[] = {
+        Sisyphus::Render::EBlendMode::Opaque,
+        Sisyphus::Render::EBlendMode::Alpha,
+    };
+    int                                  lit_frames = 0;
+    for (Sisyphus::Render::ECullingMode culling : culling_modes)
+    {
+        for (Sisyphus::Render::EBlendMode blend : blend_modes)
+        {
+            for (int flags = 0; flags < 8; flags++)
+            {
+                Sisyphus::Render::RasterState raster;
+                raster.depth_test = (flags & 1) != 0;
+                raster.depth_write = (flags & 2) != 0;
+                raster.wireframe = (flags & 4) != 0;
+                raster.backface_culling = culling;
+                raster.blend = blend;
+                Sisyphus::Render::PipelineState pipeline(
+                    Sisyphus::Tests::vertex_shader, pixel_shader, v_in_format, v_out_format, raster);
+                by_calls.set_depth_test(raster.depth_test);
+                by_calls.set_depth_write(raster.depth_write);
+                by_calls.set_wireframe(raster.wireframe);
+                by_calls.set_backface_culling(culling);
+                by_calls.set_blend_mode(blend);
+                by_state.set_pipeline_state(&pipeline);
+                for (Sisyphus::Render::Context* context : {&by_calls, &by_state})
+                {
+                    context->fill(Sisyphus::Render::col4u_t {16, 32, 64, 255});
+                    context->clear_depth(0.0f);
+                    context->draw_triangles(near_quad, near_indices, vertex_data.data(), v_in_format, v_out_format);
+                    context->draw_triangles(far_quad, far_indices, vertex_data.data(), v_in_format, v_out_format);
+                    context->present();
+                }
+                by_state.set_pipeline_state(nullptr);
+                std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(by_calls);
+                REQUIRE(Sisyphus::Tests::read_frame(by_state) == frame);
+                lit_frames += frame[(32 * 64 + 32) * 4] != 16;
+            }
+        }
+    }
+    // culling drops the far quad in one mode, in every other frame the middle is drawn
+    REQUIRE(lit_frames >= 32);
+}
@@ -0,0 +1,84 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_query.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+static uint64_t
+query_proxy(Sisyphus::Render::Context& context, Sisyphus::Render::OcclusionQuery& query, float x, float z)
+{
+    context.begin_query(&query);
+    context.draw_query_proxy(Sisyphus::Tests::create_box(x, 0.0f, z, 0.5f));
+    context.end_query();
+    uint64_t samples = 0;
+    REQUIRE(query.get_result(samples));
+    return samples;
+}
+
+TEST_CASE("Sisyphus::Render occlusion query tests", "[Render::query]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    std::vector<Sisyphus::Base::vec4_t> wall = Sisyphus::Tests::create_wall();
+    std::vector<int>                    wall_indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>                wall_data(wall.size() * sizeof(float));
+    Sisyphus::Render::VertexFormat      v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat      v_out_format = Sisyphus::Tests::get_output_format();
+    Sisyphus::Render::OcclusionQuery    query;
+    SECTION("no result before the first query")
+    {
+        uint64_t samples = 0;
+        REQUIRE_FALSE(query.get_result(samples));
+        REQUIRE_FALSE(query.is_hidden());
+    }
+    SECTION("draws count the samples passing the depth test")
+    {
+        context.begin_query(&query);
+        context.draw_triangles(wall, wall_indices, wall_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        uint64_t wall_samples = 0;
+        REQUIRE(query.get_result(wall_samples));
+        REQUIRE(wall_samples > 0);
+        // the same wall again does not pass the depth test anywhere
+        context.begin_query(&query);
+        context.draw_triangles(wall, wall_indices, wall_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        uint64_t samples = 0;
+        REQUIRE(query.get_result(samples));
+        REQUIRE(samples == 0);
+        REQUIRE(query.is_hidden());
+    }
+    SECTION("box proxies behind the wall are hidden")
+    {
+        REQUIRE(query_proxy(context, query, 0.0f, 10.0f) > 0);
+        context.draw_triangles(wall, wall_indices, wall_data.data(), v_in_format, v_out_format);
+        REQUIRE(query_proxy(context, query, 0.0f, 10.0f) == 0);
+        REQUIRE(query_proxy(context, query, 0.0f, 2.0f) > 0);
+        REQUIRE(query_proxy(context, query, 6.0f, 10.0f) > 0);
+        // camera inside the box
+        REQUIRE(query_proxy(context, query, 0.0f, 0.0f) > 0);
+        // out of the frustum
+        REQUIRE(query_proxy(context, query, 0.0f, -10.0f) == 0);
+    }
+    SECTION("conditional draws are skipped only after a hidden result")
+    {
+        context.draw_triangles(wall, wall_indices, wall_data.data(), v_in_format, v_out_format);
+        query_proxy(context, query, 0.0f, 10.0f);
+        REQUIRE(query.is_hidden());
+        Sisyphus::Render::OcclusionQuery counter;
+        context.clear_depth(0.0f);
+        context.begin_query(&counter);
+        context.draw_triangles_conditional(query, wall, wall_indices, wall_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        uint64_t samples = 0;
+        REQUIRE(counter.get_result(samples));
+        REQUIRE(samples == 0);
+        query.reset();
+        context.begin_query(&counter);
+        context.draw_triangles_conditional(query, wall, wall_indices, wall_data.data(), v_in_format, v_out_format);
+        context.end_query();
+        REQUIRE(counter.get_result(samples));
+        REQUIRE(samples > 0);
+    }
+}
@@ -0,0 +1,141 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_readback.h"
+
+#include <cstdlib>
+#include <vector>
+
+static const int s_frame_width = 37;
+static const int s_frame_height = 29;
+
+static uint8_t
+get_expected(
+    const std::vector<uint8_t>& frame, const Sisyphus::Render::ReadbackDesc& desc, int x, int y, int channel)
+{
+    // box average of b, g, r, a and then the conversion
+    int bgra[4];
+    int area = desc.downscale * desc.downscale;
+    for (int c = 0; c < 4; c++)
+    {
+        int sum = 0;
+        for (int j = 0; j < desc.downscale; j++)
+        {
+            for (int i = 0; i < desc.downscale; i++)
+            {
+                int fx = desc.rect.x_min + x * desc.downscale + i;
+                int fy = desc.rect.y_min + y * desc.downscale + j;
+                sum += frame[(fy * s_frame_width + fx) * 4 + c];
+            }
+        }
+        bgra[c] = (sum + area / 2) / area;
+    }
+    switch (desc.format)
+    {
+    case Sisyphus::Render::EReadbackFormat::BGRA8:
+        return (uint8_t)bgra[channel];
+    case Sisyphus::Render::EReadbackFormat::RGBA8:
+        return (uint8_t)bgra[channel == 3 ? 3 : 2 - channel];
+    case Sisyphus::Render::EReadbackFormat::RGB8:
+        return (uint8_t)bgra[2 - channel];
+    case Sisyphus::Render::EReadbackFormat::GRAY8:
+        return (uint8_t)((bgra[0] * 29 + bgra[1] * 150 + bgra[2] * 77 + 128) >> 8);
+    }
+    return 0;
+}
+
+TEST_CASE("Sisyphus::Render readback tests", "[Render::readback]")
+{
+    std::vector<uint8_t> frame(s_frame_width * s_frame_height * 4);
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        frame[i] = (uint8_t)(rand() & 0xff);
+    }
+    SECTION("formats, downscale, stride and threads")
+    {
+        const Sisyphus::Render::EReadbackFormat formats[] = {
+            Sisyphus::Render::EReadbackFormat::BGRA8, Sisyphus::Render::EReadbackFormat::RGBA8,
+            Sisyphus::Render::EReadbackFormat::RGB8, Sisyphus::Render::EReadbackFormat::GRAY8};
+        for (Sisyphus::Render::EReadbackFormat format : formats)
+        {
+            for (int downscale : {1, 2, 4})
+            {
+                for (int thread_count : {1, 3})
+                {
+                    Sisyphus::Render::ReadbackDesc desc;
+                    desc.rect = Sisyphus::Render::ScreenRect {3, 2, 36, 27};
+                    desc.format = format;
+                    desc.downscale = downscale;
+                    desc.thread_count = thread_count;
+                    int pixel_size = Sisyphus::Render::get_readback_pixel_size(format);
+                    int width = 0;
+                    int height = 0;
+                    REQUIRE(Sisyphus::Render::get_readback_size(desc, s_frame_width, s_frame_height, width, height));
+                    REQUIRE(width == 33 / downscale);
+                    REQUIRE(height == 25 / downscale);
+                    desc.stride = width * pixel_size + 5;
+                    std::vector<uint8_t> dst(desc.stride * height, 0xcd);
+                    REQUIRE(Sisyphus::Render::read_frame_region(
+                        frame.data(), s_frame_width, s_frame_height, desc, dst.data(), dst.size()));
+                    int mismatches = 0;
+                    for (int y = 0; y < height; y++)
+                    {
+                        for (int x = 0; x < width; x++)
+                        {
+                            for (int c = 0; c < pixel_size; c++)
+                            {
+                                mismatches += dst[y * desc.stride + x * pixel_size + c] !=
+                                              get_expected(frame, desc, x, y, c);
+                            }
+                        }
+                        // padding between rows is not touched
+                        for (int i = width * pixel_size; i < desc.stride; i++)
+                        {
+                            mismatches += dst[y * desc.stride + i] != 0xcd;
+                        }
+                    }
+                    REQUIRE(mismatches == 0);
+                }
+            }
+        }
+    }
+    SECTION("requests that do not fit")
+    {
+        Sisyphus::Render::ReadbackDesc desc;
+        std::vector<uint8_t>           dst(frame.size());
+        int                            width = 0;
+        int                            height = 0;
+        REQUIRE(Sisyphus::Render::get_readback_size(desc, s_frame_width, s_frame_height, width, height));
+        REQUIRE(width == s_frame_width);
+        REQUIRE(height == s_frame_height);
+        REQUIRE(Sisyphus::Render::read_frame_region(
+            frame.data(), s_frame_width, s_frame_height, desc, dst.data(), dst.size()));
+        REQUIRE(dst == frame);
+        REQUIRE(!Sisyphus::Render::read_frame_region(
+            frame.data(), s_frame_width, s_frame_height, desc, dst.data(), dst.size() - 1));
+        desc.downscale = 3;
+        REQUIRE(!Sisyphus::Render::get_readback_size(desc, s_frame_width, s_frame_height, width, height));
+        desc.downscale = 1;
+        desc.rect = Sisyphus::Render::ScreenRect {30, 0, 40, 10};
+        REQUIRE(!Sisyphus::Render::get_readback_size(desc, s_frame_width, s_frame_height, width, height));
+        desc.rect = Sisyphus::Render::ScreenRect {0, 0, 10, 10};
+        desc.stride = 8;
+        REQUIRE(!Sisyphus::Render::read_frame_region(
+            frame.data(), s_frame_width, s_frame_height, desc, dst.data(), dst.size()));
+    }
+    SECTION("last presented frame of a context")
+    {
+        Sisyphus::Render::Context      context(16, 16, 4);
+        Sisyphus::Render::ReadbackDesc desc;
+        desc.format = Sisyphus::Render::EReadbackFormat::RGB8;
+        desc.downscale = 4;
+        std::vector<uint8_t> dst(4 * 4 * 3);
+        REQUIRE(!context.read_frame(desc, dst.data(), dst.size()));
+        context.fill(Sisyphus::Render::col4u_t {10, 20, 30, 255});
+        context.present();
+        REQUIRE(context.read_frame(desc, dst.data(), dst.size()));
+        REQUIRE(dst[0] == 10);
+        REQUIRE(dst[1] == 20);
+        REQUIRE(dst[2] == 30);
+        REQUIRE(dst[dst.size() - 1] == 30);
+    }
+}
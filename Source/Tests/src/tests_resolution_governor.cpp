@@ -0,0 +1,117 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_resolution_governor.h"
+
+#include <cstdlib>
+#include <vector>
+
+static void
+upscale_reference(
+    const std::vector<uint8_t>& src, int src_width, int src_height, std::vector<uint8_t>& dst, int dst_width,
+    int dst_height, int bytes_per_pixel)
+{
+    // the same 7 bit weights in plain code
+    dst.resize((size_t)dst_width * dst_height * bytes_per_pixel);
+    auto sample = [](int d, int dst_size, int src_size, int& s, int& w)
+    {
+        float pos = ((float)d + 0.5f) * (float)src_size / (float)dst_size - 0.5f;
+        pos = pos < 0.0f ? 0.0f : (pos > (float)(src_size - 1) ? (float)(src_size - 1) : pos);
+        s = (int)pos;
+        w = (int)((pos - (float)s) * 128.0f + 0.5f);
+    };
+    for (int y = 0; y < dst_height; y++)
+    {
+        int y0, wy;
+        sample(y, dst_height, src_height, y0, wy);
+        int y1 = y0 + 1 < src_height ? y0 + 1 : y0;
+        for (int x = 0; x < dst_width; x++)
+        {
+            int x0, wx;
+            sample(x, dst_width, src_width, x0, wx);
+            int x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+            for (int c = 0; c < bytes_per_pixel; c++)
+            {
+                auto at = [&](int sx, int sy) { return (int)src[(sy * src_width + sx) * bytes_per_pixel + c]; };
+                int  a = at(x0, y0) + (((at(x0, y1) - at(x0, y0)) * wy) >> 7);
+                int  b = at(x1, y0) + (((at(x1, y1) - at(x1, y0)) * wy) >> 7);
+                dst[(y * dst_width + x) * bytes_per_pixel + c] = (uint8_t)(a + (((b - a) * wx) >> 7));
+            }
+        }
+    }
+}
+
+TEST_CASE("Sisyphus::Render resolution governor tests", "[Render::resolution_governor]")
+{
+    SECTION("overruns shrink at once, spare time grows back step by step")
+    {
+        Sisyphus::Render::ResolutionGovernorSettings settings;
+        settings.target_frame_ms = 10.0f;
+        Sisyphus::Render::ResolutionGovernor governor(settings);
+        REQUIRE(governor.get_scale() == 1.0f);
+        REQUIRE(governor.get_lod_bias() == 0.0f);
+        // frame time proportional to the rendered area
+        float cost = 20.0f;
+        for (int i = 0; i < settings.settle_frames; i++)
+        {
+            governor.add_frame_time(cost * governor.get_scale() * governor.get_scale());
+        }
+        REQUIRE(governor.get_change_count() == 1);
+        float scale = governor.get_scale();
+        REQUIRE(scale * scale * cost <= settings.target_frame_ms);
+        REQUIRE(scale >= 0.625f);
+        REQUIRE(governor.get_lod_bias() < 0.0f);
+        int width = 0;
+        int height = 0;
+        governor.get_render_size(640, 480, width, height);
+        REQUIRE(width == (int)(640 * scale + 0.5f));
+        REQUIRE(height == (int)(480 * scale + 0.5f));
+        // the load stays, so does the scale
+        for (int i = 0; i < 4 * settings.settle_frames; i++)
+        {
+            governor.add_frame_time(cost * governor.get_scale() * governor.get_scale());
+        }
+        REQUIRE(governor.get_scale() == scale);
+        cost = 5.0f;
+        for (int i = 0; i < 64 * settings.settle_frames; i++)
+        {
+            governor.add_frame_time(cost * governor.get_scale() * governor.get_scale());
+        }
+        REQUIRE(governor.get_scale() == settings.max_scale);
+        cost = 1000.0f;
+        for (int i = 0; i < 8 * settings.settle_frames; i++)
+        {
+            governor.add_frame_time(cost * governor.get_scale() * governor.get_scale());
+        }
+        REQUIRE(governor.get_scale() == settings.min_scale);
+        REQUIRE(governor.get_lod_bias() == -1.0f);
+    }
+    SECTION("bilinear upscale")
+    {
+        std::vector<uint8_t> src(4 * 3 * 4);
+        std::vector<uint8_t> dst;
+        std::vector<uint8_t> expected;
+        for (size_t i = 0; i < src.size(); i++)
+        {
+            src[i] = (uint8_t)(rand() & 0xff);
+        }
+        dst.resize(src.size());
+        Sisyphus::Render::upscale_frame(src.data(), 4, 3, dst.data(), 4, 3, 4);
+        REQUIRE(dst == src);
+        for (int bytes_per_pixel : {3, 4})
+        {
+            upscale_reference(src, 4, 3, expected, 11, 7, bytes_per_pixel);
+            dst.assign(expected.size(), 0);
+            Sisyphus::Render::upscale_frame(src.data(), 4, 3, dst.data(), 11, 7, bytes_per_pixel);
+            REQUIRE(dst == expected);
+        }
+        // gradient stays monotonic and inside its ends
+        std::vector<uint8_t> gradient = {0, 0, 0, 0, 200, 200, 200, 200};
+        dst.assign(8 * 4, 0);
+        Sisyphus::Render::upscale_frame(gradient.data(), 2, 1, dst.data(), 8, 1, 4);
+        REQUIRE(dst[0] == 0);
+        REQUIRE(dst[7 * 4] == 200);
+        for (int x = 1; x < 8; x++)
+        {
+            REQUIRE(dst[x * 4] >= dst[(x - 1) * 4]);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "scene_bvh.h"
+#include "render_culling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+static std::vector<Sisyphus::Base::BoundingBox>
+create_random_boxes(int count, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float>    position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float>    size(0.1f, 2.0f);
+    std::vector<Sisyphus::Base::BoundingBox> boxes(count);
+    for (Sisyphus::Base::BoundingBox& box : boxes)
+    {
+        box.min = Sisyphus::Base::vec3_t {position(rng), position(rng), position(rng)};
+        box.max = box.min + Sisyphus::Base::vec3_t {size(rng), size(rng), size(rng)};
+    }
+    return boxes;
+}
+
+static std::vector<int>
+query_frustum_linear(const std::vector<Sisyphus::Base::BoundingBox>& boxes, const Sisyphus::Render::Frustum& frustum)
+{
+    std::vector<int> visible;
+    for (int i = 0; i < (int)boxes.size(); i++)
+    {
+        if (Sisyphus::Render::is_box_visible(boxes[i], frustum))
+        {
+            visible.push_back(i);
+        }
+    }
+    return visible;
+}
+
+static float
+query_ray_linear(
+    const std::vector<Sisyphus::Base::BoundingBox>& boxes, const Sisyphus::Base::vec3_t& origin,
+    const Sisyphus::Base::vec3_t& dir)
+{
+    float closest = INFINITY;
+    for (const Sisyphus::Base::BoundingBox& box : boxes)
+    {
+        // linear slab test, a ray parallel to a slab has to start inside it
+        float t_enter = 0.0f;
+        float t_exit = INFINITY;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (dir[axis] == 0.0f)
+            {
+                if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis])
+                {
+                    t_exit = -INFINITY;
+                }
+                continue;
+            }
+            float t0 = (box.min[axis] - origin[axis]) / dir[axis];
+            float t1 = (box.max[axis] - origin[axis]) / dir[axis];
+            t_enter = std::max(t_enter, std::min(t0, t1));
+            t_exit = std::min(t_exit, std::max(t0, t1));
+        }
+        if (t_enter <= t_exit)
+        {
+            closest = std::min(closest, t_enter);
+        }
+    }
+    return closest;
+}
+
+TEST_CASE("Sisyphus::Scene bvh tests", "[Scene::bvh]")
+{
+    std::mt19937                             rng(7);
+    std::vector<Sisyphus::Base::BoundingBox> boxes = create_random_boxes(5000, rng);
+    Sisyphus::Scene::Bvh                     bvh;
+    bvh.build(boxes);
+    // camera in the middle of the boxes, looking along x
+    Sisyphus::Render::Frustum view_frustum = Sisyphus::Render::calculate_frustum(1.5f, 1.0f, 0.5f, 40.0f);
+    Sisyphus::Base::mat4_t    view = Sisyphus::Base::mat4_t::calculate_rotation_matrix_around_y(0.7f);
+    Sisyphus::Render::Frustum frustum = Sisyphus::Render::transform_frustum(view_frustum, view);
+    SECTION("frustum query finds the same instances as the linear test")
+    {
+        std::vector<int> visible;
+        int              count = bvh.query_frustum(frustum, visible);
+        std::sort(visible.begin(), visible.end());
+        REQUIRE(count == (int)visible.size());
+        REQUIRE(visible.size() > 0);
+        REQUIRE(visible.size() < boxes.size());
+        REQUIRE(visible == query_frustum_linear(boxes, frustum));
+    }
+    SECTION("refit follows moved instances")
+    {
+        std::uniform_real_distribution<float> shift(-10.0f, 10.0f);
+        for (int i = 0; i < (int)boxes.size(); i += 3)
+        {
+            Sisyphus::Base::vec3_t offset {shift(rng), shift(rng), shift(rng)};
+            boxes[i].min += offset;
+            boxes[i].max += offset;
+            bvh.set_bounds(i, boxes[i]);
+        }
+        bvh.refit();
+        std::vector<int> visible;
+        bvh.query_frustum(frustum, visible);
+        std::sort(visible.begin(), visible.end());
+        REQUIRE(visible == query_frustum_linear(boxes, frustum));
+    }
+    SECTION("ray query returns the closest box")
+    {
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        for (int r = 0; r < 100; r++)
+        {
+            Sisyphus::Base::vec3_t     origin {0.0f, 0.0f, 0.0f};
+            Sisyphus::Base::vec3_t     dir {direction(rng), direction(rng), direction(rng)};
+            float                      closest = query_ray_linear(boxes, origin, dir);
+            Sisyphus::Scene::BvhRayHit hit;
+            bool                       found = bvh.query_ray(origin, dir, INFINITY, hit);
+            REQUIRE(found == (closest != INFINITY));
+            if (found)
+            {
+                REQUIRE(std::fabs(hit.distance - closest) < 1e-4f);
+            }
+        }
+    }    SECTION("axis aligned rays hit boxes touching their origin")
+    {
+        // origins on box faces give 0 * inf in the slab test of the parallel axes
+        std::vector<Sisyphus::Base::BoundingBox> aligned_boxes = {
+            {{5.0f, 0.0f, -1.0f}, {6.0f, 1.0f, 1.0f}},
+            {{-1.0f, -8.0f, 0.0f}, {0.0f, -7.0f, 2.0f}},
+            {{0.0f, 0.0f, 3.0f}, {0.5f, 0.5f, 4.0f}},
+            {{-4.0f, 2.0f, -4.0f}, {-3.0f, 3.0f, -3.0f}}};
+        Sisyphus::Scene::Bvh aligned_bvh;
+        aligned_bvh.build(aligned_boxes);
+        Sisyphus::Base::vec3_t     origin {0.0f, 0.0f, 0.0f};
+        Sisyphus::Scene::BvhRayHit hit;
+        REQUIRE(aligned_bvh.query_ray(origin, Sisyphus::Base::vec3_t {1.0f, 0.0f, 0.0f}, INFINITY, hit));
+        REQUIRE(hit.instance == 0);
+        REQUIRE(hit.distance == 5.0f);
+        REQUIRE(aligned_bvh.query_ray(origin, Sisyphus::Base::vec3_t {0.0f, -1.0f, 0.0f}, INFINITY, hit));
+        REQUIRE(hit.instance == 1);
+        REQUIRE(hit.distance == 7.0f);
+        REQUIRE(aligned_bvh.query_ray(origin, Sisyphus::Base::vec3_t {0.0f, 0.0f, 2.0f}, INFINITY, hit));
+        REQUIRE(hit.instance == 2);
+        REQUIRE(hit.distance == 1.5f);
+        REQUIRE_FALSE(aligned_bvh.query_ray(origin, Sisyphus::Base::vec3_t {-1.0f, 0.0f, 0.0f}, INFINITY, hit));
+        REQUIRE_FALSE(aligned_bvh.query_ray(origin, Sisyphus::Base::vec3_t {0.0f, 0.0f, -1.0f}, INFINITY, hit));
+        // the same through the random boxes
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (float sign : {-1.0f, 1.0f})
+            {
+                Sisyphus::Base::vec3_t dir {0.0f, 0.0f, 0.0f};
+                dir[axis] = sign;
+                float closest = query_ray_linear(boxes, origin, dir);
+                REQUIRE(bvh.query_ray(origin, dir, INFINITY, hit) == (closest != INFINITY));
+                if (closest != INFINITY)
+                {
+                    REQUIRE(hit.distance == Catch::Approx(closest));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_swapchain.h"
+
+#include <vector>
+
+TEST_CASE("Sisyphus::Render swapchain tests", "[Render::swapchain]")
+{
+    SECTION("presented frames are acquired once and freed on release")
+    {
+        Sisyphus::Render::Swapchain swapchain(2);
+        REQUIRE(swapchain.acquire_frame() == nullptr);
+        Sisyphus::Render::FrameBuffer* back = swapchain.get_back_buffer(8, 8, 4);
+        REQUIRE(back != nullptr);
+        REQUIRE(back->state == Sisyphus::Render::EFrameState::Rendering);
+        REQUIRE(back->get_size() == 8 * 8 * 4);
+        // nothing presented yet
+        REQUIRE(swapchain.acquire_frame() == nullptr);
+        REQUIRE(swapchain.present() == 1);
+        REQUIRE(back->state == Sisyphus::Render::EFrameState::Ready);
+        REQUIRE(swapchain.get_latest_frame() == back);
+        const Sisyphus::Render::FrameBuffer* frame = swapchain.acquire_frame();
+        REQUIRE(frame == back);
+        REQUIRE(frame->frame_index == 1);
+        REQUIRE(frame->state == Sisyphus::Render::EFrameState::Acquired);
+        REQUIRE(swapchain.acquire_frame() == nullptr);
+        swapchain.release_frame(frame);
+        REQUIRE(back->state == Sisyphus::Render::EFrameState::Free);
+        // presents without a back buffer do not make frames
+        REQUIRE(swapchain.present() == 1);
+        REQUIRE(swapchain.acquire_frame() == nullptr);
+        REQUIRE(swapchain.get_frame_counter() == 1);
+    }
+    SECTION("the newest frame is acquired")
+    {
+        Sisyphus::Render::Swapchain swapchain(3);
+        for (int i = 0; i < 3; i++)
+        {
+            swapchain.get_back_buffer(8, 8, 4);
+            swapchain.present();
+        }
+        const Sisyphus::Render::FrameBuffer* frame = swapchain.acquire_frame();
+        REQUIRE(frame != nullptr);
+        REQUIRE(frame->frame_index == 3);
+        // older ready frames are never handed out after a newer one
+        REQUIRE(swapchain.acquire_frame() == nullptr);
+        swapchain.release_frame(frame);
+    }
+    SECTION("frames held by the consumer are not drawn into")
+    {
+        Sisyphus::Render::Swapchain    swapchain(2);
+        Sisyphus::Render::FrameBuffer* first = swapchain.get_back_buffer(8, 8, 4);
+        swapchain.present();
+        const Sisyphus::Render::FrameBuffer* held = swapchain.acquire_frame();
+        REQUIRE(held == first);
+        Sisyphus::Render::FrameBuffer* second = swapchain.get_back_buffer(8, 8, 4);
+        REQUIRE(second != first);
+        swapchain.present();
+        // the only other buffer is ready and not taken, it is reused for the next frame
+        Sisyphus::Render::FrameBuffer* third = swapchain.get_back_buffer(8, 8, 4);
+        REQUIRE(third == second);
+        REQUIRE(held->state == Sisyphus::Render::EFrameState::Acquired);
+        REQUIRE(swapchain.present() == 3);
+        swapchain.release_frame(held);
+        const Sisyphus::Render::FrameBuffer* frame = swapchain.acquire_frame();
+        REQUIRE(frame == second);
+        REQUIRE(frame->frame_index == 3);
+        swapchain.release_frame(frame);
+    }
+    SECTION("context takes a back buffer only when it draws")
+    {
+        // with one buffer an eager bind after present would leave nothing to acquire
+        Sisyphus::Render::Context context(8, 8, 4);
+        context.set_buffer_count(1);
+        context.fill(Sisyphus::Render::col4u_t {255, 0, 0, 255});
+        context.present();
+        context.present();
+        const Sisyphus::Render::FrameBuffer* frame = context.acquire_frame();
+        REQUIRE(frame != nullptr);
+        REQUIRE(frame->frame_index == 1);
+        std::vector<uint8_t> pixels(frame->get_data(), frame->get_data() + frame->get_size());
+        context.release_frame(frame);
+        context.fill(Sisyphus::Render::col4u_t {0, 255, 0, 255});
+        context.present();
+        frame = context.acquire_frame();
+        REQUIRE(frame != nullptr);
+        REQUIRE(frame->frame_index == 2);
+        REQUIRE(std::vector<uint8_t>(frame->get_data(), frame->get_data() + frame->get_size()) != pixels);
+        context.release_frame(frame);
+    }
+    SECTION("pixels put right after present go to the next back buffer")
+    {
+        Sisyphus::Render::Context context(8, 8, 4);
+        context.fill(Sisyphus::Render::col4u_t {0, 0, 0, 255});
+        context.present();
+        context.put_pixel(1, 1, Sisyphus::Base::vec4_t {1.0f, 1.0f, 1.0f, 1.0f});
+        context.present();
+        const Sisyphus::Render::FrameBuffer* frame = context.acquire_frame();
+        REQUIRE(frame != nullptr);
+        REQUIRE(frame->frame_index == 2);
+        REQUIRE(frame->get_data()[(1 * 8 + 1) * 4] == 255);
+        context.release_frame(frame);
+    }
+}
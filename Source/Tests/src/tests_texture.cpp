@@ -0,0 +1,174 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_texture.h"
+#include "tests_render_common.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+struct ShadedPixel {
+    float                  u, v;
+    Sisyphus::Base::vec4_t gradients;
+};
+
+static std::vector<ShadedPixel> s_shaded;
+
+static void
+vertex_shader(
+    const Sisyphus::Base::vec4_t& input, Sisyphus::Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out,
+    const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins, const std::vector<uint8_t>&)
+{
+    output = Sisyphus::Tests::get_view_position(input, builtins);
+    memcpy(per_vertex_out.data(), per_vertex_data, 2 * sizeof(float));
+}
+
+static Sisyphus::Base::vec4_t
+pixel_shader(
+    const Sisyphus::Base::vec4_t&, const uint8_t* per_pixel_data, const std::vector<uint8_t>&,
+    const std::vector<uint8_t>&)
+{
+    const float* uv = reinterpret_cast<const float*>(per_pixel_data);
+    s_shaded.push_back(ShadedPixel {uv[0], uv[1], Sisyphus::Render::get_texture_gradients()});
+    return Sisyphus::Base::vec4_t {1.0f, 1.0f, 1.0f, 1.0f};
+}
+
+static Sisyphus::Render::Texture
+create_checker(uint32_t width, uint32_t height, uint32_t channels)
+{
+    std::vector<uint8_t> data(width * height * channels);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            for (uint32_t c = 0; c < channels; c++)
+            {
+                data[(y * width + x) * channels + c] = ((x + y) & 1) ? 255 : 0;
+            }
+        }
+    }
+    return Sisyphus::Render::Texture(data.data(), width, height, channels);
+}
+
+TEST_CASE("Sisyphus::Render texture tests", "[Render::texture]")
+{
+    SECTION("mip chain")
+    {
+        Sisyphus::Render::Texture texture = create_checker(5, 3, 3);
+        texture.generate_mips();
+        REQUIRE(texture.get_level_count() == 3);
+        REQUIRE(texture.mips[0].width == 2);
+        REQUIRE(texture.mips[0].height == 1);
+        REQUIRE(texture.mips[1].width == 1);
+        REQUIRE(texture.mips[1].height == 1);
+        // every 2x2 block of a checker has two black and two white texels
+        for (uint8_t value : texture.mips[0].data)
+        {
+            REQUIRE(value == 128);
+        }
+        // the simd path for 4 channels matches the scalar one
+        Sisyphus::Render::Texture rgba = create_checker(16, 16, 4);
+        rgba.data[Sisyphus::Render::get_texel_index(0, 0, 16) * 4] = 10;
+        rgba.data[Sisyphus::Render::get_texel_index(1, 0, 16) * 4] = 20;
+        rgba.data[Sisyphus::Render::get_texel_index(0, 1, 16) * 4] = 30;
+        rgba.data[Sisyphus::Render::get_texel_index(1, 1, 16) * 4] = 41;
+        rgba.generate_mips();
+        REQUIRE(rgba.get_level_count() == 5);
+        std::vector<uint8_t> level;
+        rgba.export_linear(level, 1);
+        REQUIRE(level.size() == 8 * 8 * 4);
+        REQUIRE(level[0] == (10 + 20 + 30 + 41 + 2) / 4);
+        REQUIRE(level[1] == 128);
+        REQUIRE(level[7 * 4 + 2] == 128);
+        rgba.export_linear(level, 4);
+        REQUIRE(level.size() == 4);
+        REQUIRE(level[3] == 128);
+        rgba.export_linear(level, 5);
+        REQUIRE(level.empty());
+    }
+    SECTION("tiled storage")
+    {
+        // 4x4 tiles row by row, z-order inside
+        REQUIRE(Sisyphus::Render::get_texel_index(1, 0, 10) == 1);
+        REQUIRE(Sisyphus::Render::get_texel_index(0, 1, 10) == 2);
+        REQUIRE(Sisyphus::Render::get_texel_index(2, 0, 10) == 4);
+        REQUIRE(Sisyphus::Render::get_texel_index(3, 3, 10) == 15);
+        REQUIRE(Sisyphus::Render::get_texel_index(4, 0, 10) == 16);
+        REQUIRE(Sisyphus::Render::get_texel_index(0, 4, 10) == 48);
+        std::vector<uint8_t> pixels(10 * 7 * 3);
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            pixels[i] = (uint8_t)(i * 7);
+        }
+        Sisyphus::Render::Texture texture(pixels.data(), 10, 7, 3);
+        REQUIRE(texture.data.size() == 12 * 8 * 3);
+        std::vector<uint8_t> exported;
+        texture.export_linear(exported);
+        REQUIRE(exported == pixels);
+        // nearest lookups still address the original texels
+        for (uint32_t y = 0; y < 7; y++)
+        {
+            for (uint32_t x = 0; x < 10; x++)
+            {
+                Sisyphus::Base::vec4_t texel = texture.get_pixel_color(x / 9.0f, 1.0f - y / 6.0f);
+                REQUIRE(texel.g == Catch::Approx(pixels[(y * 10 + x) * 3 + 1] / 255.0f));
+            }
+        }
+    }
+    SECTION("bilinear and trilinear sampling")
+    {
+        Sisyphus::Render::Texture texture = create_checker(8, 8, 4);
+        texture.generate_mips();
+        // texel centers return texels, midway between two of them their average
+        Sisyphus::Base::vec4_t texel = texture.sample_bilinear(0.5f / 8.0f, 1.0f - 0.5f / 8.0f, 0);
+        REQUIRE(texel.r == Catch::Approx(0.0f));
+        texel = texture.sample_bilinear(1.0f / 8.0f, 1.0f - 0.5f / 8.0f, 0);
+        REQUIRE(texel.r == Catch::Approx(0.5f));
+        REQUIRE(texel.a == Catch::Approx(0.5f));
+        texel = texture.sample_trilinear(0.3f, 0.7f, 1.5f);
+        REQUIRE(texel.r == Catch::Approx(128.0f / 255.0f));
+        texel = texture.sample_trilinear(0.5f / 8.0f, 1.0f - 0.5f / 8.0f, 0.5f);
+        REQUIRE(texel.r == Catch::Approx(64.0f / 255.0f));
+        // one texel per pixel is the base level, four the second mip
+        Sisyphus::Base::vec4_t one_texel {1.0f / 8.0f, 0.0f, 0.0f, 1.0f / 8.0f};
+        Sisyphus::Base::vec4_t four_texels {0.0f, 4.0f / 8.0f, 1.0f / 8.0f, 0.0f};
+        REQUIRE(texture.calculate_lod(one_texel) == Catch::Approx(0.0f));
+        REQUIRE(texture.calculate_lod(four_texels) == Catch::Approx(2.0f));
+        REQUIRE(texture.calculate_lod(Sisyphus::Base::vec4_t {0.0f, 0.0f, 0.0f, 0.0f}) == 0.0f);
+        texel = texture.sample(0.5f / 8.0f, 1.0f - 0.5f / 8.0f, four_texels, -2.0f);
+        REQUIRE(texel.r == Catch::Approx(0.0f));
+    }
+    SECTION("uv gradients of a tilted quad")
+    {
+        Sisyphus::Render::Context context(64, 64, 4);
+        Sisyphus::Tests::setup_context(context, 64, 64);
+        context.set_vertex_shader(vertex_shader);
+        context.set_pixel_shader(pixel_shader);
+        context.set_texture_gradients(0);
+        Sisyphus::Render::VertexFormat      v_in_format({Sisyphus::Render::EVertexAttribType::VEC2});
+        Sisyphus::Render::VertexFormat      v_out_format({Sisyphus::Render::EVertexAttribType::VEC2});
+        std::vector<int>                    indices = Sisyphus::Tests::get_quad_indices();
+        std::vector<float>                  uvs = {0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f};
+        std::vector<Sisyphus::Base::vec4_t> quad = {
+            {-2.0f, -2.0f, 3.0f, 1.0f},
+            {2.0f, -2.0f, 8.0f, 1.0f},
+            {2.0f, 2.0f, 8.0f, 1.0f},
+            {-2.0f, 2.0f, 3.0f, 1.0f},
+        };
+        s_shaded.clear();
+        context.draw_triangles(quad, indices, reinterpret_cast<const uint8_t*>(uvs.data()), v_in_format, v_out_format);
+        REQUIRE(s_shaded.size() > 200);
+        // x / z = (4u - 2) / (5u + 3) on screen is 32 + 32 * x / z, so du/dx = (5u + 3)^2 / 704;
+        // y / z = (4v - 2) / z is 32 - 32 * y / z along a column, so dv/dy = -z / 128
+        float max_error = 0.0f;
+        for (const ShadedPixel& p : s_shaded)
+        {
+            float z = 5.0f * p.u + 3.0f;
+            max_error = std::max(max_error, fabsf(p.gradients.x / (z * z / 704.0f) - 1.0f));
+            max_error = std::max(max_error, fabsf(p.gradients.w / (-z / 128.0f) - 1.0f));
+            max_error = std::max(max_error, fabsf(p.gradients.z));
+        }
+        REQUIRE(max_error < 1e-3f);
+        context.set_texture_gradients(-1);
+    }
+}
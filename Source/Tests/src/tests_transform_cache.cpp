@@ -0,0 +1,103 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "render_mesh.h"
+#include "render_query.h"
+#include "render_transform_cache.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+static int s_shaded_vertices = 0;
+
+static void
+vertex_shader(
+    const Sisyphus::Base::vec4_t& input, Sisyphus::Base::vec4_t& output, std::vector<uint8_t>& per_vertex_out,
+    const uint8_t* per_vertex_data, const std::vector<uint8_t>& builtins, const std::vector<uint8_t>& descriptor_set)
+{
+    Sisyphus::Tests::vertex_shader(input, output, per_vertex_out, per_vertex_data, builtins, descriptor_set);
+    s_shaded_vertices++;
+}
+
+static uint64_t
+count_samples(
+    Sisyphus::Render::Context& context, Sisyphus::Render::OcclusionQuery& query, bool cached,
+    Sisyphus::Render::TransformCache& cache, const Sisyphus::Render::Mesh& mesh,
+    const Sisyphus::Render::VertexFormat& v_in_format, const Sisyphus::Render::VertexFormat& v_out_format)
+{
+    uint64_t samples = 0;
+    context.clear_depth(0.0f);
+    context.begin_query(&query);
+    if (cached)
+    {
+        context.draw_triangles_cached(cache, mesh, v_in_format, v_out_format);
+    }
+    else
+    {
+        context.draw_triangles(mesh.get_geometry_view(), v_in_format, v_out_format);
+    }
+    context.end_query();
+    query.get_result(samples);
+    return samples;
+}
+
+TEST_CASE("Sisyphus::Render transform cache tests", "[Render::transform_cache]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    context.set_vertex_shader(vertex_shader);
+    Sisyphus::Render::VertexFormat v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat v_out_format = Sisyphus::Tests::get_output_format();
+    // a quad crossing the left plane of the frustum, so the cache keeps clipped triangles
+    std::vector<Sisyphus::Base::vec4_t> quad = {
+        {-8.0f, -1.0f, 5.0f, 1.0f},
+        {1.0f, -2.0f, 5.0f, 1.0f},
+        {2.0f, 2.0f, 5.0f, 1.0f},
+        {-8.0f, 1.0f, 5.0f, 1.0f},
+    };
+    std::vector<int>                        indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>                    vertex_data(quad.size() * sizeof(float));
+    std::shared_ptr<Sisyphus::Render::Mesh> mesh = Sisyphus::Render::create_mesh(
+        quad.data(), (uint32_t)quad.size(), vertex_data.data(), vertex_data.size(), v_in_format, indices.data(),
+        (uint32_t)indices.size());
+    REQUIRE(mesh != nullptr);
+    Sisyphus::Render::TransformCache cache;
+    Sisyphus::Render::OcclusionQuery query;
+    uint64_t                         samples =
+        count_samples(context, query, false, cache, *mesh, v_in_format, v_out_format);
+    REQUIRE(samples > 0);
+    SECTION("unchanged draws only rasterize")
+    {
+        s_shaded_vertices = 0;
+        REQUIRE(count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format) == samples);
+        REQUIRE(s_shaded_vertices > 0);
+        REQUIRE(cache.is_valid());
+        REQUIRE(cache.get_triangle_count() > 2);
+        s_shaded_vertices = 0;
+        REQUIRE(count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format) == samples);
+        REQUIRE(s_shaded_vertices == 0);
+        REQUIRE(cache.get_rebuild_count() == 1);
+    }
+    SECTION("matrices, buffers and state changes rebuild the cache")
+    {
+        count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format);
+        context.set_model_matrix(2.0f * Sisyphus::Base::mat4_t::get_identity_matrix());
+        count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format);
+        REQUIRE(cache.get_rebuild_count() == 2);
+        context.set_model_matrix(Sisyphus::Base::mat4_t::get_identity_matrix());
+        for (Sisyphus::Base::vec4_t& v : quad)
+        {
+            v.z += 1.0f;
+        }
+        REQUIRE(mesh->update_vertices(quad.data(), vertex_data.data(), vertex_data.size()));
+        uint64_t moved_samples = count_samples(context, query, false, cache, *mesh, v_in_format, v_out_format);
+        REQUIRE(count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format) == moved_samples);
+        REQUIRE(cache.get_rebuild_count() == 3);
+        context.set_wireframe(true);
+        uint64_t wire_samples = count_samples(context, query, false, cache, *mesh, v_in_format, v_out_format);
+        REQUIRE(count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format) == wire_samples);
+        REQUIRE(cache.get_rebuild_count() == 4);
+        cache.invalidate();
+        count_samples(context, query, true, cache, *mesh, v_in_format, v_out_format);
+        REQUIRE(cache.get_rebuild_count() == 5);
+    }
+}
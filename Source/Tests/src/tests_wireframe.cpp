@@ -0,0 +1,60 @@
+#include "thirdparty_catch_amalgamated.hpp"
+#include "render_context.h"
+#include "tests_render_common.h"
+
+#include <vector>
+
+TEST_CASE("Sisyphus::Render wireframe tests", "[Render::wireframe]")
+{
+    Sisyphus::Render::Context context(64, 64, 4);
+    Sisyphus::Tests::setup_context(context, 64, 64);
+    Sisyphus::Render::VertexFormat v_in_format = Sisyphus::Tests::get_input_format();
+    Sisyphus::Render::VertexFormat v_out_format = Sisyphus::Tests::get_output_format();
+    // pixels 12.8 to 51.2, the diagonal of the two triangles goes through the middle
+    std::vector<Sisyphus::Base::vec4_t> quad = Sisyphus::Tests::create_wall();
+    std::vector<int>                    indices = Sisyphus::Tests::get_quad_indices();
+    std::vector<uint8_t>                vertex_data(quad.size() * sizeof(float));
+    // three pixels wide, so the wire covers the outermost pixel row of the quad on every side
+    context.set_wireframe_style(Sisyphus::Base::vec4_t {0.0f, 0.0f, 0.0f, 1.0f}, 3.0f);
+    context.fill(Sisyphus::Render::col4u_t {0, 0, 255, 255});
+    SECTION("edge pixels get the wire color, inner ones keep the shaded one")
+    {
+        context.set_wireframe(true);
+        context.draw_triangles(quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        context.present();
+        std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(context);
+        // bgra, the quad is white, the wire is black and the background is blue
+        auto get_blue = [&frame](int x, int y)
+        {
+            return frame[(y * 64 + x) * 4];
+        };
+        for (int i = 16; i < 48; i += 4)
+        {
+            REQUIRE(get_blue(12, i) < 128);
+            REQUIRE(get_blue(50, i) < 128);
+            REQUIRE(get_blue(i, 13) < 128);
+            REQUIRE(get_blue(i, 50) < 128);
+        }
+        // the diagonal between the two triangles is an edge as well
+        REQUIRE(get_blue(32, 32) < 128);
+        REQUIRE(get_blue(24, 32) == 255);
+        REQUIRE(get_blue(40, 32) == 255);
+        REQUIRE(get_blue(32, 20) == 255);
+        REQUIRE(get_blue(32, 44) == 255);
+        REQUIRE(frame[(32 * 64 + 24) * 4 + 1] == 255);
+        // outside of the quad
+        REQUIRE(get_blue(5, 32) == 255);
+        REQUIRE(frame[(32 * 64 + 5) * 4 + 1] == 0);
+    }
+    SECTION("without wireframe edges are shaded like the rest")
+    {
+        context.set_wireframe(true);
+        context.set_wireframe(false);
+        context.draw_triangles(quad, indices, vertex_data.data(), v_in_format, v_out_format);
+        context.present();
+        std::vector<uint8_t> frame = Sisyphus::Tests::read_frame(context);
+        REQUIRE(frame[(32 * 64 + 12) * 4] == 255);
+        REQUIRE(frame[(32 * 64 + 32) * 4] == 255);
+        REQUIRE(frame[(32 * 64 + 12) * 4 + 1] == 255);
+    }
+}
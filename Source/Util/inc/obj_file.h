@@ -1,6 +1,8 @@
 #pragma once
 
+#include "base_bounds.h"
 #include "base_vectors.h"
+#include "render_mesh.h"
 
 #include <vector>
 #include <memory>
@@ -23,8 +25,13 @@ namespace Util
         std::vector<Base::vec2_t> uv;
         std::vector<Base::vec3_t> normal;
         std::vector<ObjFace>      faces;
+        Base::Bounds              bounds; // of coord, calculated once on load
     };
     std::shared_ptr<ObjFile>
     read_obj_model_file(const char* path);
+    // face corners with the same position, uv and normal become one vertex, attributes
+    // are {VEC2 uv, VEC3 normal}, missing ones are zero
+    std::shared_ptr<Render::Mesh>
+    create_mesh(const ObjFile& obj);
 } // namespace Util
 } // namespace Sisyphus
@@ -1,8 +1,11 @@
 #include "obj_file.h"
+#include "base_utils.h"
 
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <memory>
+#include <tuple>
 
 std::shared_ptr<Sisyphus::Util::ObjFile>
 Sisyphus::Util::read_obj_model_file(const char* filename)
@@ -44,7 +47,7 @@ Sisyphus::Util::read_obj_model_file(const char* filename)
         }
         else if (prefix == "f")
         {
-            ObjFace     face;
+            ObjFace     face {};
             std::string vertex;
             int         face_vert_idx = 0;
             while (iss >> vertex)
@@ -76,5 +79,56 @@ Sisyphus::Util::read_obj_model_file(const char* filename)
             obj_ptr->faces.push_back(face);
         }
     }
+    obj_ptr->bounds = Base::calculate_bounds(obj_ptr->coord);
     return obj_ptr;
 }
+
+std::shared_ptr<Sisyphus::Render::Mesh>
+Sisyphus::Util::create_mesh(const ObjFile& obj)
+{
+    Render::VertexFormat format({Render::EVertexAttribType::VEC2, Render::EVertexAttribType::VEC3});
+    std::map<std::tuple<unsigned int, unsigned int, unsigned int>, int> vertex_ids;
+    std::vector<Base::vec4_t>                                           coords;
+    std::vector<uint8_t>                                                data;
+    std::vector<int>                                                    indices;
+    indices.reserve(obj.faces.size() * 3);
+    for (const ObjFace& face : obj.faces)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            // obj indices start from 1, 0 - not set
+            const ObjFaceIndex& corner = face.indices[j];
+            if (corner.position == 0 || corner.position > obj.coord.size())
+            {
+                return nullptr;
+            }
+            auto key = std::make_tuple(corner.position, corner.texture, corner.normal);
+            auto found = vertex_ids.find(key);
+            if (found != vertex_ids.end())
+            {
+                indices.push_back(found->second);
+                continue;
+            }
+            const Base::vec3_t& position = obj.coord[corner.position - 1];
+            Base::vec2_t        uv {0.0f, 0.0f};
+            Base::vec3_t        normal {0.0f, 0.0f, 0.0f};
+            if (corner.texture > 0 && corner.texture <= obj.uv.size())
+            {
+                uv = obj.uv[corner.texture - 1];
+            }
+            if (corner.normal > 0 && corner.normal <= obj.normal.size())
+            {
+                normal = obj.normal[corner.normal - 1];
+            }
+            int id = (int)coords.size();
+            vertex_ids.emplace(key, id);
+            coords.push_back(Base::vec4_t {position.x, position.y, position.z, 1.0f});
+            Base::append_data(data, uv);
+            Base::append_data(data, normal);
+            indices.push_back(id);
+        }
+    }
+    return Render::create_mesh(
+        coords.data(), (uint32_t)coords.size(), data.data(), data.size(), format, indices.data(),
+        (uint32_t)indices.size());
+}
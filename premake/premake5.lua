@@ -38,6 +38,12 @@ local render_proj = create_static_lib(
     { "../Source/Base/inc", "../Source/Thirdparty/inc" }
 )
 
+group "Scene"
+local scene_proj = create_static_lib(
+    "Scene",
+    { "../Source/Base/inc", "../Source/Thirdparty/inc", "../Source/Render/inc" }
+)
+
 group "Util"
 local util_proj = create_static_lib(
     "Util",
@@ -48,8 +54,8 @@ group "Samples"
 local tests_proj = create_binary(
     "Tests",
     "ConsoleApp",
-    { "../Source/Base/inc", "../Source/Thirdparty/inc", "../Source/Render/inc" },
-    { base_proj, thirdparty_proj },
+    { "../Source/Base/inc", "../Source/Thirdparty/inc", "../Source/Render/inc", "../Source/Scene/inc" },
+    { base_proj, thirdparty_proj, render_proj, scene_proj },
     {}
 )
 